@@ -3,6 +3,12 @@
 #include <stdlib.h> // for atoi
 #include "i2c_adapter.h"
 #include "ds3231.h"
+#include "ds3231_cache.h"
+#include "ds3231_irq.h"
+#include "ds3231_alarm.h"
+#include "ds3231_drift.h"
+#include "ds3231_stamp.h"
+#include "ds3231_tz.h"
 #include "optparse.h"
 
 typedef uint8_t arg_buff_t[8];
@@ -14,25 +20,69 @@ static struct optparse_long long_opts[] =
     {"date", 'd', OPTPARSE_OPTIONAL},
     {"clock", 'c', OPTPARSE_OPTIONAL},
     {"alarm", 'a', OPTPARSE_OPTIONAL},
+#ifdef DS3231_USING_ALARM
+    {"remove", 'r', OPTPARSE_REQUIRED},
+    {"bench", 'b', OPTPARSE_OPTIONAL},
+#endif
+#ifdef DS3231_USING_CACHE
+    {"cache", 'C', OPTPARSE_OPTIONAL},
+#endif
+    {"i2c", 'i', OPTPARSE_OPTIONAL},
+    {"temp", 'T', OPTPARSE_NONE},
+    {"aging", 'g', OPTPARSE_OPTIONAL},
+#ifdef DS3231_USING_STAMP
+    {"stamp", 'u', OPTPARSE_NONE},
+#endif
+#ifdef DS3231_USING_DRIFT
+    {"ref", 'R', OPTPARSE_REQUIRED},
+    {"drift", 'D', OPTPARSE_OPTIONAL},
+#endif
+#ifdef DS3231_USING_TZ
+    {"zone", 'z', OPTPARSE_OPTIONAL},
+#endif
     {"help", 'h', OPTPARSE_NONE},
     { NULL,  0,  OPTPARSE_NONE}
 };
 
 void ds3231_show_all(void)
 {
+    DS3231_Snapshot snap;
+    DS3231_MirrorStats stats;
     DS3231_Time time;
-    rt_bool_t a2ie, a1ie;
-    rt_bool_t a2f, a1f;
+    int temp;
 
-    DS3231_GetTime(&time);
+    /* 一次读取全部寄存器 */
+    if (DS3231_ReadAll(&snap) != RT_EOK)
+    {
+        rt_kprintf("error: read ds3231 failed\n");
+        return;
+    }
+
+    /* 芯片保存 UTC, 与 -t/-d 一样显示本地时间; 闹钟寄存器按芯片时间显示 */
+#ifdef DS3231_USING_TZ
+    DS3231_SecondsToTime(DS3231_TzLocal(DS3231_TimeToSeconds(&snap.time)), &time);
+#else
+    time = snap.time;
+#endif
     rt_kprintf("date:   %02u-%02u-%02u\n", time.year, time.month, time.date);
     rt_kprintf("clock:  %02u:%02u:%02u\n", time.hour, time.minute, time.second);
-    a2ie = DS3231_CheckAlarmITEnabled(2);
-    a1ie = DS3231_CheckAlarmITEnabled(1);
-    rt_kprintf("A2IE: %d, A1IE: %d\n", a2ie, a1ie);
-    a2f = DS3231_CheckIfAlarm(2);
-    a1f = DS3231_CheckIfAlarm(1);
-    rt_kprintf("A2F:  %d, A1F:  %d\n", a2f, a1f);
+    rt_kprintf("alarm1: %02u:%02u:%02u utc date %u day %u mask 0x%02x\n",
+               snap.alarm1.hour, snap.alarm1.minute, snap.alarm1.second,
+               snap.alarm1.date, snap.alarm1.day, snap.alarm1_mask);
+    rt_kprintf("alarm2: %02u:%02u utc date %u day %u mask 0x%02x\n",
+               snap.alarm2.hour, snap.alarm2.minute,
+               snap.alarm2.date, snap.alarm2.day, snap.alarm2_mask);
+    rt_kprintf("A2IE: %d, A1IE: %d, INTCN: %d\n",
+               !!(snap.control & 0x02), !!(snap.control & 0x01), !!(snap.control & 0x04));
+    rt_kprintf("A2F:  %d, A1F:  %d, OSF: %d\n", !!(snap.status & DS3231_FLAG_A2F),
+               !!(snap.status & DS3231_FLAG_A1F), !!(snap.status & DS3231_FLAG_OSF));
+    temp = snap.temperature < 0 ? -snap.temperature : snap.temperature;
+    rt_kprintf("aging: %d, temperature: %s%d.%02d\n", snap.aging, snap.temperature < 0 ? "-" : "",
+               temp / DS3231_TEMP_SCALE, temp % DS3231_TEMP_SCALE * 100 / DS3231_TEMP_SCALE);
+
+    DS3231_GetMirrorStats(&stats);
+    rt_kprintf("mirror: %u hits, %u reads, %u writes\n", stats.hits, stats.reads, stats.writes);
+    DS3231_IrqShow();
 }
 
 /*******************************************************************************
@@ -78,6 +128,37 @@ static int arg_parse(char *arg, arg_buff_t buff)
     return j;
 }
 
+#ifdef DS3231_USING_TZ
+/* 芯片保存 UTC, 命令行的时间都是本地时间 */
+static void ds3231_get_local(DS3231_Time *time)
+{
+    DS3231_TzLocalTime(time);
+}
+
+static rt_err_t ds3231_set_local(DS3231_Time *time)
+{
+    DS3231_Time utc;
+
+    if (!DS3231_TimeValid(time))
+        return -RT_EINVAL;
+
+    time->day = DS3231_Weekday(time->year, time->month, time->date);
+    DS3231_SecondsToTime(DS3231_TzUtc(DS3231_TimeToSeconds(time)), &utc);
+
+    return DS3231_SetTime(&utc);
+}
+#else
+static void ds3231_get_local(DS3231_Time *time)
+{
+    DS3231_GetTime(time);
+}
+
+static rt_err_t ds3231_set_local(DS3231_Time *time)
+{
+    return DS3231_SetTime(time);
+}
+#endif
+
 /*
  * 返回值:   0: 成功
  *          -1: 参数为空
@@ -92,8 +173,8 @@ static int ds3231_set_time(char *arg)
 
     if (!arg)
     {
-        DS3231_GetTime(&time);
-        rt_kprintf("date:   %02u-%02u-%02u\n", time.year, time.month, time.date);
+        ds3231_get_local(&time);
+        rt_kprintf("date:   %02u-%02u-%02u, day %u\n", time.year, time.month, time.date, time.day);
         rt_kprintf("clock:  %02u:%02u:%02u\n", time.hour, time.minute, time.second);
         return 0;
     }
@@ -118,7 +199,12 @@ static int ds3231_set_time(char *arg)
 
     rt_kprintf("set time to: %02d-%02d-%02d, %02d:%02d:%02d\n", 
                 time.year, time.month, time.date, time.hour, time.minute, time.second);
-    DS3231_SetTime(&time);
+    if (ds3231_set_local(&time) == -RT_EINVAL)
+    {
+        rt_kprintf("error: invalid time\n");
+        return -2;
+    }
+    rt_kprintf("day of week: %u\n", time.day);
 
     return 0;
 }
@@ -127,12 +213,12 @@ static int ds3231_set_date(char *arg)
 {
     arg_buff_t szbuff;
     int len;
-    DS3231_Date date;
+    DS3231_Time time;
 
+    ds3231_get_local(&time);
     if (!arg)
     {
-        DS3231_GetDate(&date);
-        rt_kprintf("date:   %02u-%02u-%02u\n", date.year, date.month, date.date);
+        rt_kprintf("date:   %02u-%02u-%02u, day %u\n", time.year, time.month, time.date, time.day);
         return 0;
     }
 
@@ -147,12 +233,17 @@ static int ds3231_set_date(char *arg)
         return -2;
     }
 
-    date.year = szbuff[0];
-    date.month = szbuff[1];
-    date.date = szbuff[2];
+    time.year = szbuff[0];
+    time.month = szbuff[1];
+    time.date = szbuff[2];
 
-    rt_kprintf("set date to: %02d-%02d-%02d\n", date.year, date.month, date.date);
-    DS3231_SetDate(&date);
+    rt_kprintf("set date to: %02d-%02d-%02d\n", time.year, time.month, time.date);
+    if (ds3231_set_local(&time) == -RT_EINVAL)
+    {
+        rt_kprintf("error: invalid date\n");
+        return -2;
+    }
+    rt_kprintf("day of week: %u\n", time.day);
 
     return 0;
 }
@@ -161,12 +252,12 @@ static int ds3231_set_clock(char *arg)
 {
     arg_buff_t szbuff;
     int len;
-    DS3231_Clock clock;
+    DS3231_Time time;
 
+    ds3231_get_local(&time);
     if (!arg)
     {
-        DS3231_GetClock(&clock);
-        rt_kprintf("clock:  %02u:%02u:%02u\n", clock.hour, clock.minute, clock.second);
+        rt_kprintf("clock:  %02u:%02u:%02u\n", time.hour, time.minute, time.second);
         return 0;
     }
 
@@ -181,16 +272,71 @@ static int ds3231_set_clock(char *arg)
         return -2;
     }
 
-    clock.hour = szbuff[0];
-    clock.minute = szbuff[1];
-    clock.second = szbuff[2];
+    time.hour = szbuff[0];
+    time.minute = szbuff[1];
+    time.second = szbuff[2];
 
-    rt_kprintf("set clock to: %02d:%02d:%02d\n", clock.hour, clock.minute, clock.second);
-    DS3231_SetClock(&clock);
+    rt_kprintf("set clock to: %02d:%02d:%02d\n", time.hour, time.minute, time.second);
+    if (ds3231_set_local(&time) == -RT_EINVAL)
+    {
+        rt_kprintf("error: invalid clock\n");
+        return -2;
+    }
 
     return 0;
 }
 
+#ifdef DS3231_USING_ALARM
+static void ds3231_alarm_fired(int id, void *param)
+{
+    rt_kprintf("alarm %d\n", id);
+}
+
+/* 支持设置时, 分, 秒, 可选十进制星期掩码 (bit0 为星期一, 31 为工作日, 96 为周末),
+   不带参数列出所有闹钟 */
+static int ds3231_set_alarm(char *arg)
+{
+    arg_buff_t szbuff;
+    int len, id;
+    DS3231_AlarmConfig config;
+
+    if (!arg)
+    {
+        DS3231_AlarmShow();
+        return 0;
+    }
+
+    len = arg_parse(arg, szbuff);
+    if (len < 0)
+    {
+        return -2;
+    }
+    if (len < 2)
+    {
+        rt_kprintf("parsing error: numbers not enough\n");
+        return -2;
+    }
+
+    rt_memset(&config, 0, sizeof(config));
+    config.type = (len > 2) ? DS3231_ALARM_WEEKLY : DS3231_ALARM_DAILY;
+    config.time.hour = szbuff[0];
+    config.time.minute = szbuff[1];
+    config.time.second = szbuff[2];
+    if (config.type == DS3231_ALARM_WEEKLY)
+        config.weekdays = szbuff[3];
+    config.callback = ds3231_alarm_fired;
+
+    id = DS3231_AlarmAdd(&config);
+    if (id < 0)
+    {
+        rt_kprintf("error: add alarm failed (%d)\n", id);
+        return -3;
+    }
+    rt_kprintf("alarm %d set to: %02d:%02d:%02d\n", id, config.time.hour, config.time.minute, config.time.second);
+
+    return 0;
+}
+#else
 /* 支持设置时, 分, 秒 */
 static int ds3231_set_alarm(char *arg)
 {
@@ -226,6 +372,109 @@ static int ds3231_set_alarm(char *arg)
     return 0;
 }
 
+#endif
+
+#ifdef DS3231_USING_CACHE
+static void ds3231_cache(char *arg)
+{
+    if (!arg)
+    {
+        DS3231_CacheShow();
+        return;
+    }
+
+    if (rt_strcmp(arg, "sync") == 0)
+        DS3231_CacheResync();
+    else if (atoi(arg) > 0)
+        DS3231_CacheSetPeriod(atoi(arg));
+    else
+        rt_kprintf("error: need sync or resync period in seconds\n");
+}
+#endif
+
+/* 强制转换一次再读取温度 */
+static void ds3231_temperature(void)
+{
+    rt_int16_t temp;
+
+    if (DS3231_ConvertTemperature() != RT_EOK)
+        rt_kprintf("warning: conversion timeout, showing last value\n");
+
+    temp = DS3231_GetTemperature();
+    rt_kprintf("temperature: %s%d.%02d C\n", temp < 0 ? "-" : "",
+               (temp < 0 ? -temp : temp) / DS3231_TEMP_SCALE,
+               (temp < 0 ? -temp : temp) % DS3231_TEMP_SCALE * 100 / DS3231_TEMP_SCALE);
+}
+
+static void ds3231_aging(char *arg)
+{
+    int aging;
+
+    if (arg)
+    {
+        aging = atoi(arg);
+        if (aging < -128 || aging > 127)
+        {
+            rt_kprintf("error: aging must be -128 ~ 127\n");
+            return;
+        }
+        DS3231_SetAging(aging);
+        DS3231_ConvertTemperature(); // 立即生效
+    }
+    rt_kprintf("aging: %d\n", DS3231_GetAging());
+}
+
+#ifdef DS3231_USING_DRIFT
+/* 参考时间, unix 秒[.毫秒], 由主机在该时刻发送 */
+static void ds3231_drift_ref(char *arg)
+{
+    unsigned long unix_sec;
+    rt_uint16_t ms = 0, scale = 100;
+    char *end;
+
+    unix_sec = strtoul(arg, &end, 10);
+    if (*end == '.')
+    {
+        for (end++; *end >= '0' && *end <= '9' && scale > 0; end++, scale /= 10)
+            ms += (*end - '0') * scale;
+    }
+    if (unix_sec < 946684800UL)
+    {
+        rt_kprintf("error: reference must be unix seconds after 2000\n");
+        return;
+    }
+
+    if (DS3231_DriftSample(unix_sec - 946684800UL, ms) != RT_EOK)
+        rt_kprintf("error: no second edge, time cache is not valid\n");
+}
+
+static void ds3231_drift(char *arg)
+{
+    if (!arg)
+        DS3231_DriftShow();
+    else if (rt_strcmp(arg, "on") == 0)
+        DS3231_DriftLoop(RT_TRUE);
+    else if (rt_strcmp(arg, "off") == 0)
+        DS3231_DriftLoop(RT_FALSE);
+    else if (rt_strcmp(arg, "reset") == 0)
+        DS3231_DriftReset();
+    else if (atoi(arg) > 0)
+        DS3231_DriftSetWindow(atoi(arg));
+    else
+        rt_kprintf("error: need on, off, reset or window in seconds\n");
+}
+#endif
+
+#ifdef DS3231_USING_TZ
+static void ds3231_zone(char *arg)
+{
+    if (!arg)
+        DS3231_TzShow();
+    else if (DS3231_TzSet(arg) != RT_EOK)
+        rt_kprintf("error: invalid TZ, e.g. CST-8 or CET-1CEST,M3.5.0,M10.5.0/3\n");
+}
+#endif
+
 static void ds3231_show_help(void)
 {
     rt_kprintf(
@@ -234,7 +483,33 @@ static void ds3231_show_help(void)
         "-t, --time     setting year, month, date, hour, minute, sencond\n"
         "-d, --date     setting year, month, date\n"
         "-c, --clock    setting hour, minute, sencond\n"
+#ifdef DS3231_USING_ALARM
+        "-a, --alarm    add a daily alarm like hour, minute, sencond,\n"
+        "               append a weekday mask for a weekly one, list alarms if empty\n"
+        "-r, --remove   remove an alarm by id\n"
+        "-b, --bench    benchmark alarm heap operations with n entries\n"
+#else
         "-a, --alarm    setting a clock like hour, minute, sencond\n"
+#endif
+#ifdef DS3231_USING_CACHE
+        "-C, --cache    show cached time and bus savings,\n"
+        "               sync to resync now, or resync period in seconds\n"
+#endif
+        "-i, --i2c      show i2c bus statistics, or compare split and combined\n"
+        "               reads of the time registers n times\n"
+        "-T, --temp     convert and show temperature\n"
+        "-g, --aging    show or set aging offset, -128 ~ 127\n"
+#ifdef DS3231_USING_STAMP
+        "-u, --stamp    show 32kHz timestamp and cpu clock error\n"
+#endif
+#ifdef DS3231_USING_DRIFT
+        "-R, --ref      reference time in unix seconds[.ms], sent by host at that time\n"
+        "-D, --drift    show drift and temperature log, on/off aging loop,\n"
+        "               reset, or measuring window in seconds\n"
+#endif
+#ifdef DS3231_USING_TZ
+        "-z, --zone     show or set POSIX time zone, -t/-d/-c use local time\n"
+#endif
         "-h, --help     show this help\n"
         "\n"
     );
@@ -245,14 +520,6 @@ static int ds3231_clock_example(int argc, char **argv)
     int ch; 
     struct optparse options;
 
-    if (RT_TRUE != i2c_initialized)
-    {
-        if (RT_EOK != I2c_Init("i2c1"))
-        {
-            return -EXIT_FAILURE;
-        }
-    }
-
     optparse_init(&options, argv); 
     while((ch = optparse_long(&options, long_opts, NULL)) != -1)
     {
@@ -273,6 +540,50 @@ static int ds3231_clock_example(int argc, char **argv)
             case 'a':
                 ds3231_set_alarm(options.optarg);
                 break;
+#ifdef DS3231_USING_ALARM
+            case 'r':
+                if (DS3231_AlarmRemove(atoi(options.optarg)) != RT_EOK)
+                    rt_kprintf("error: no such alarm\n");
+                break;
+            case 'b':
+                DS3231_AlarmBench(options.optarg ? atoi(options.optarg) : DS3231_ALARM_MAX);
+                break;
+#endif
+#ifdef DS3231_USING_CACHE
+            case 'C':
+                ds3231_cache(options.optarg);
+                break;
+#endif
+            case 'i':
+                if (options.optarg)
+                    DS3231_BusBench(atoi(options.optarg));
+                else
+                    I2c_Show();
+                break;
+            case 'T':
+                ds3231_temperature();
+                break;
+            case 'g':
+                ds3231_aging(options.optarg);
+                break;
+#ifdef DS3231_USING_STAMP
+            case 'u':
+                DS3231_StampShow();
+                break;
+#endif
+#ifdef DS3231_USING_DRIFT
+            case 'R':
+                ds3231_drift_ref(options.optarg);
+                break;
+            case 'D':
+                ds3231_drift(options.optarg);
+                break;
+#endif
+#ifdef DS3231_USING_TZ
+            case 'z':
+                ds3231_zone(options.optarg);
+                break;
+#endif
             case 'h':
                 ds3231_show_help();
                 break;
@@ -14,7 +14,15 @@
 #include "i2c_adapter.h"
 #include "multi_button.h"
 #include "ds3231.h"
+#include "ds3231_cache.h"
+#include "ds3231_irq.h"
+#include "ds3231_alarm.h"
+#include "ds3231_stamp.h"
+#include "ds3231_rtc.h"
+#include "ds3231_tz.h"
 #include "buzzer.h"
+#include "hv57708_anim.h"
+#include "hv57708_dim.h"
 
 /* Private define ------------------------------------------------------------*/
 #define LED0_PIN    8  /* defined the LED0 pin: PA8 */
@@ -29,7 +37,9 @@
 struct button key0, key1, key2; /* 实例化 3 个按键 */
 static rt_timer_t btn_timer;
 static rt_bool_t beep = RT_FALSE;
+#ifndef DS3231_USING_ALARM
 static int alarm_count = 0;
+#endif
 
 /* Private function prototypes -----------------------------------------------*/
 static rt_uint8_t key0_pin_level(void)
@@ -49,10 +59,52 @@ static void button_timer_handler(void *param)
 
 static void alarm_clock_handler(void *args)
 {
-    if (rt_pin_read(DS3231_SQW_PIN) == PIN_LOW)
+    /* SQW 输出 1Hz 方波时, 下降沿即秒边沿, 锁存预先移入的下一秒画面 */
+    HV57708_FbEdge();
+
+#ifdef DS3231_USING_CACHE
+    /* 推进缓存的时间, 此时闹钟中断不从该引脚输出, 由软件闹钟倒数 */
+    DS3231_CacheEdge();
+#ifdef DS3231_USING_STAMP
+    /* 取出 TIM8 在该边沿锁存的 32kHz 计数 */
+    DS3231_StampEdge();
+#endif
+#ifdef DS3231_USING_ALARM
+    DS3231_AlarmTick();
+#endif
+#else
+    /* 闹钟中断: 只投递事件, 读取和清除标志在 ds_irq 线程中进行 */
+    DS3231_IrqPost(0);
+#endif
+}
+
+#ifndef DS3231_USING_ALARM
+static void alarm_fired_handler(uint8_t flags, void *param)
+{
+    rt_kprintf("alarm %d\n", alarm_count++);
+}
+#endif
+
+/* 打印按键事件的时间, 有 32kHz 时间戳时精确到微秒 */
+static void key_event_print(const char *event)
+{
+#ifdef DS3231_USING_STAMP
+    DS3231_Stamp stamp;
+    DS3231_Time time;
+
+    if (DS3231_StampNow(&stamp) == RT_EOK)
     {
-        rt_kprintf("alarm %d\n", alarm_count++);
+#ifdef DS3231_USING_TZ
+        DS3231_SecondsToTime(DS3231_TzLocal(stamp.seconds), &time);
+#else
+        DS3231_SecondsToTime(stamp.seconds, &time);
+#endif
+        rt_kprintf("%s at %02u:%02u:%02u.%06u\n", event,
+                   time.hour, time.minute, time.second, DS3231_StampToUs(&stamp));
+        return;
     }
+#endif
+    rt_kprintf("%s\n", event);
 }
 
 static void key0_single_clicked_handler(void *key);
@@ -71,6 +123,31 @@ int main(void)
     rt_pin_write(LED1_PIN, PIN_HIGH);
 
     DS3231_Init();
+#ifdef DS3231_USING_CACHE
+    DS3231_CacheInit();
+#endif
+#ifdef DS3231_USING_STAMP
+    DS3231_StampInit();
+#endif
+#ifdef DS3231_USING_RTC
+    DS3231_RtcInit();
+#endif
+#ifdef DS3231_USING_TZ
+    DS3231_TzInit();
+#endif
+    DS3231_IrqInit();
+#ifdef DS3231_USING_ALARM
+    DS3231_AlarmInit();
+#else
+    DS3231_IrqAttach(1, alarm_fired_handler, RT_NULL);
+    DS3231_IrqAttach(2, alarm_fired_handler, RT_NULL);
+#endif
+
+    HV57708_Init();
+    HV57708_AnimInit();
+#ifdef HV57708_USING_DIM
+    HV57708_DimInit();
+#endif
 
     beep_init();
 
@@ -116,7 +193,7 @@ int main(void)
 *******************************************************************************/
 void key0_single_clicked_handler(void *key)
 {
-    rt_kprintf("key0 is clicked.\n");
+    key_event_print("key0 is clicked.");
     beep = RT_TRUE;
 }
 
@@ -125,7 +202,7 @@ void key0_single_clicked_handler(void *key)
 *******************************************************************************/
 void key0_long_pressed_handler(void *key)
 {
-    rt_kprintf("key0 is long pressed\n");
+    key_event_print("key0 is long pressed");
 }
 
 /*******************************************************************************
@@ -133,7 +210,7 @@ void key0_long_pressed_handler(void *key)
 *******************************************************************************/
 void key1_single_clicked_handler(void *key)
 {
-    rt_kprintf("key1 is clicked.\n");
+    key_event_print("key1 is clicked.");
 }
 
 /*******************************************************************************
@@ -141,5 +218,5 @@ void key1_single_clicked_handler(void *key)
 *******************************************************************************/
 void key1_long_pressed_handler(void *key)
 {
-    rt_kprintf("key1 is long pressed.\n");
+    key_event_print("key1 is long pressed.");
 }
@@ -13,7 +13,7 @@ static void sht30_collect_thread_entry(void *parameter)
 {
     sht3x_device_t sht3x_device;
 
-    sht3x_device = sht3x_device_create("i2c1", 0x44, 0, SHT3X_CLOCK_POLLING, SHT3X_REPEATAB_MEDIUM);
+    sht3x_device = sht3x_device_create(SHT3X_I2C_BUS, 0x44, 0, SHT3X_CLOCK_POLLING, SHT3X_REPEATAB_MEDIUM);
 
     while (1)
     {
@@ -0,0 +1,437 @@
+#include <rtthread.h>
+#include <rtdevice.h>
+#include <stdlib.h> // for EXIT_FAILURE, atoi, strtol
+#include <string.h>
+#include "hv57708_anim.h"
+#include "hv57708_dim.h"
+#include "optparse.h"
+
+static HV57708_Effect effect = HV57708_ANIM_NONE;
+static rt_uint8_t digits[HV57708_TUBE_NUM] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+static const char *effect_names[] = {"none", "fade", "roll", "cascade"};
+
+static struct optparse_long long_opts[] =
+{
+    {"digits", 'd', OPTPARSE_REQUIRED},
+    {"anim", 'a', OPTPARSE_OPTIONAL},
+    {"frame", 'f', OPTPARSE_REQUIRED},
+    {"compose", 'x', OPTPARSE_REQUIRED},
+    {"bench", 'b', OPTPARSE_NONE},
+    {"encode", 'e', OPTPARSE_NONE},
+    {"layout", 'y', OPTPARSE_NONE},
+    {"stats", 's', OPTPARSE_NONE},
+    {"reset", 'r', OPTPARSE_NONE},
+    {"latency", 'l', OPTPARSE_NONE},
+    {"usage", 'u', OPTPARSE_NONE},
+    {"protect", 'P', OPTPARSE_OPTIONAL},
+#ifdef HV57708_USING_PWM
+    {"pwm", 'p', OPTPARSE_OPTIONAL},
+    {"intensity", 'i', OPTPARSE_REQUIRED},
+#endif
+#ifdef HV57708_USING_DIM
+    {"dim", 'D', OPTPARSE_OPTIONAL},
+    {"schedule", 'S', OPTPARSE_REQUIRED},
+#endif
+#ifdef HV57708_USING_SIM
+    {"model", 'm', OPTPARSE_NONE},
+    {"trace", 't', OPTPARSE_NONE},
+#endif
+    {"help", 'h', OPTPARSE_NONE},
+    { NULL,  0,  OPTPARSE_NONE}
+};
+
+static int tube_show_digits(char *arg)
+{
+    rt_uint8_t data[HV57708_TUBE_NUM];
+    int i;
+
+    for (i = 0; i < HV57708_TUBE_NUM; i++)
+    {
+        if (arg[i] < '0' || arg[i] > '9')
+        {
+            rt_kprintf("error: need %d digits\n", HV57708_TUBE_NUM);
+            return -2;
+        }
+        data[i] = arg[i] - '0';
+    }
+    rt_memcpy(digits, data, sizeof(digits));
+
+    if (HV57708_AnimDisplay(data, effect) != RT_EOK)
+    {
+        rt_kprintf("animation too long, switched directly\n");
+    }
+
+    return 0;
+}
+
+static int tube_set_anim(char *arg)
+{
+    rt_uint32_t build_ns, tick_max_ns;
+    int i;
+
+    if (!arg)
+    {
+        HV57708_AnimGetCost(&build_ns, &tick_max_ns);
+        rt_kprintf("effect: %s\n", effect_names[effect]);
+        rt_kprintf("build: %u ns, tick max: %u ns\n", build_ns, tick_max_ns);
+        return 0;
+    }
+
+    for (i = 0; i < sizeof(effect_names) / sizeof(effect_names[0]); i++)
+    {
+        if (rt_strcmp(arg, effect_names[i]) == 0)
+        {
+            effect = (HV57708_Effect)i;
+            return 0;
+        }
+    }
+
+    rt_kprintf("error: unknown effect %s\n", arg);
+    return -2;
+}
+
+static int tube_show_frame(char *arg)
+{
+    rt_uint64_t frame = 0;
+    char *p = arg;
+
+    if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X'))
+        p += 2;
+    if (*p == '\0' || rt_strlen(p) > 16)
+    {
+        rt_kprintf("error: need 1 ~ 16 hex digits\n");
+        return -2;
+    }
+
+    for (; *p; p++)
+    {
+        if (*p >= '0' && *p <= '9')
+            frame = (frame << 4) | (*p - '0');
+        else if (*p >= 'a' && *p <= 'f')
+            frame = (frame << 4) | (*p - 'a' + 10);
+        else if (*p >= 'A' && *p <= 'F')
+            frame = (frame << 4) | (*p - 'A' + 10);
+        else
+        {
+            rt_kprintf("error: invalid hex digit %c\n", *p);
+            return -2;
+        }
+    }
+
+    HV57708_DisplayRaw(frame);
+
+    return 0;
+}
+
+/* 在 -d 显示的数字上叠加备用输出, 并熄灭指定的管 */
+static int tube_compose(char *arg)
+{
+    char *comma = strchr(arg, ',');
+    int spare, blank, t;
+    HV57708_Layer layers[3] =
+    {
+        {HV57708_LAYER_DIGITS, digits, 0},
+        {HV57708_LAYER_BITS, RT_NULL, 0},
+        {HV57708_LAYER_BLANK, RT_NULL, 0},
+    };
+
+    spare = strtol(arg, RT_NULL, 0);
+    blank = comma ? strtol(comma + 1, RT_NULL, 0) : 0;
+
+    for (t = 0; t < HV57708_SPARE_NUM; t++)
+    {
+        if (spare & (1 << t))
+            layers[1].bits |= HV57708_SPARE_BIT(t);
+    }
+    for (t = 0; t < HV57708_TUBE_NUM; t++)
+    {
+        if (blank & (1 << t))
+            layers[2].bits |= HV57708_TUBE_MASK(t);
+    }
+
+    HV57708_DisplayLayers(layers, 3);
+
+    return 0;
+}
+
+static void tube_show_usage(void)
+{
+    int t, d;
+
+    rt_kprintf("tube");
+    for (d = 0; d < 10; d++)
+        rt_kprintf("%8d", d);
+    rt_kprintf("\n");
+
+    for (t = 0; t < HV57708_TUBE_NUM; t++)
+    {
+        rt_kprintf("%4d", t);
+        for (d = 0; d < 10; d++)
+            rt_kprintf("%8u", HV57708_GetUsage(t, d));
+        rt_kprintf("\n");
+    }
+}
+
+static void tube_show_stats(void)
+{
+    HV57708_Stats stats;
+
+    HV57708_GetStats(&stats);
+    rt_kprintf("submitted: %u\n", stats.submitted);
+    rt_kprintf("shifted:   %u\n", stats.shifted);
+    rt_kprintf("skipped:   %u", stats.skipped);
+    if (stats.submitted != 0)
+        rt_kprintf(" (%u%%)", stats.skipped * 100 / stats.submitted);
+    rt_kprintf("\n");
+}
+
+#ifdef HV57708_USING_PWM
+static void tube_set_pwm(char *arg)
+{
+    int hz;
+
+    if (!arg)
+    {
+        HV57708_PwmMeasure();
+        return;
+    }
+
+    hz = atoi(arg);
+    if (hz <= 0)
+    {
+        HV57708_PwmStop();
+        return;
+    }
+
+    switch (HV57708_PwmStart(hz))
+    {
+        case RT_EOK:
+            break;
+        case -RT_EINVAL:
+            rt_kprintf("error: refresh must be %d ~ %d Hz\n",
+                       HV57708_PWM_REFRESH_MIN, HV57708_PWM_REFRESH_MAX);
+            break;
+        default:
+            rt_kprintf("error: start pwm failed\n");
+            break;
+    }
+}
+
+static void tube_set_intensity(char *arg)
+{
+    char *comma = strchr(arg, ',');
+    int tube, level;
+
+    if (comma)
+    {
+        tube = atoi(arg);
+        level = atoi(comma + 1);
+        if (tube < 0 || tube >= HV57708_TUBE_NUM)
+        {
+            rt_kprintf("error: tube exceeds %d\n", HV57708_TUBE_NUM - 1);
+            return;
+        }
+        HV57708_SetBrightness(tube, level);
+    }
+    else
+    {
+        level = atoi(arg);
+        for (tube = 0; tube < HV57708_TUBE_NUM; tube++)
+            HV57708_SetBrightness(tube, level);
+    }
+
+    for (tube = 0; tube < HV57708_TUBE_NUM; tube++)
+        rt_kprintf("%d ", HV57708_GetBrightness(tube));
+    rt_kprintf("/ %d\n", HV57708_PWM_LEVELS);
+}
+#endif
+
+#ifdef HV57708_USING_DIM
+static void tube_set_dim(char *arg)
+{
+    if (!arg)
+    {
+        HV57708_DimShow();
+        return;
+    }
+
+    HV57708_DimSetDuty(atoi(arg));
+}
+
+/* on / off, 或 hour,minute,duty,... 每 3 个数为一个日程点 */
+static int tube_set_schedule(char *arg)
+{
+    HV57708_DimPoint points[HV57708_DIM_POINT_MAX];
+    int num = 0, field = 0, value;
+    char *p = arg;
+
+    if (rt_strcmp(arg, "on") == 0 || rt_strcmp(arg, "off") == 0)
+    {
+        HV57708_DimSchedule(arg[1] == 'n');
+        return 0;
+    }
+
+    while (*p != '\0')
+    {
+        value = strtol(p, &p, 10);
+        if (num >= HV57708_DIM_POINT_MAX)
+        {
+            rt_kprintf("error: points exceed %d\n", HV57708_DIM_POINT_MAX);
+            return -2;
+        }
+        if (field == 0)
+            points[num].hour = value;
+        else if (field == 1)
+            points[num].minute = value;
+        else
+            points[num++].duty = value;
+        field = (field + 1) % 3;
+
+        if (*p == ',')
+            p++;
+        else if (*p != '\0')
+        {
+            rt_kprintf("error: invalid character %c\n", *p);
+            return -2;
+        }
+    }
+
+    if (field != 0 || HV57708_DimSetProfile(points, num) != RT_EOK)
+    {
+        rt_kprintf("error: need hour,minute,duty for every point\n");
+        return -2;
+    }
+    HV57708_DimSchedule(RT_TRUE);
+
+    return 0;
+}
+#endif
+
+static void tube_show_help(void)
+{
+    rt_kprintf(
+        "all arguments:\n"
+        "-d, --digits   show six digits with the current effect\n"
+        "-a, --anim     set effect: none, fade, roll, cascade,\n"
+        "               show the animation cost without argument\n"
+        "-f, --frame    show a raw 64-bit frame in hex\n"
+        "-x, --compose  spare[,blank]: light spare outputs 60 ~ 63 by\n"
+        "               bit mask over the digits, blank tubes by bit mask\n"
+        "-b, --bench    measure the cycles of shifting one frame\n"
+        "-e, --encode   verify and measure the digit encoder\n"
+        "-y, --layout   compare the layout table path with the fixed one\n"
+        "-s, --stats    show frames submitted, shifted and skipped\n"
+        "-r, --reset    reset the frame statistics\n"
+        "-l, --latency  show the latency from SQW edge to latch\n"
+        "-u, --usage    show lit seconds of every cathode\n"
+        "-P, --protect  run a cathode protection sweep,\n"
+        "               0/1 to disable/enable the scheduler\n"
+#ifdef HV57708_USING_PWM
+        "-p, --pwm      start dimming at refresh Hz, 0 to stop,\n"
+        "               measure the isr load without argument\n"
+        "-i, --intensity  set level of all tubes, or tube,level\n"
+#endif
+#ifdef HV57708_USING_DIM
+        "-D, --dim      set supply duty 0 ~ 1000 and stop the schedule,\n"
+        "               show duty and schedule without argument\n"
+        "-S, --schedule on, off, or hour,minute,duty,... to set it\n"
+#endif
+#ifdef HV57708_USING_SIM
+        "-m, --model    shift test frames through the software model\n"
+        "-t, --trace    show the last edges and latches of the model\n"
+#endif
+        "-h, --help     show this help\n"
+        "\n"
+    );
+}
+
+static int tube_example(int argc, char **argv)
+{
+    int ch;
+    struct optparse options;
+    rt_uint32_t last, max;
+
+    optparse_init(&options, argv);
+    while((ch = optparse_long(&options, long_opts, NULL)) != -1)
+    {
+        switch (ch)
+        {
+            case 'd':
+                tube_show_digits(options.optarg);
+                break;
+            case 'a':
+                tube_set_anim(options.optarg);
+                break;
+            case 'f':
+                tube_show_frame(options.optarg);
+                break;
+            case 'x':
+                tube_compose(options.optarg);
+                break;
+            case 'b':
+                HV57708_Benchmark();
+                break;
+            case 'e':
+                HV57708_BenchEncode();
+                break;
+            case 'y':
+                HV57708_BenchLayout();
+                break;
+            case 's':
+                tube_show_stats();
+                break;
+            case 'r':
+                HV57708_ResetStats();
+                break;
+            case 'u':
+                tube_show_usage();
+                break;
+            case 'P':
+                if (options.optarg)
+                    HV57708_ProtectionSchedule(atoi(options.optarg) != 0);
+                else
+                    HV57708_Protection();
+                break;
+            case 'l':
+                HV57708_FbGetLatency(&last, &max);
+                rt_kprintf("edge to latch: last %u ns, max %u ns\n", last, max);
+                break;
+#ifdef HV57708_USING_PWM
+            case 'p':
+                tube_set_pwm(options.optarg);
+                break;
+            case 'i':
+                tube_set_intensity(options.optarg);
+                break;
+#endif
+#ifdef HV57708_USING_DIM
+            case 'D':
+                tube_set_dim(options.optarg);
+                break;
+            case 'S':
+                tube_set_schedule(options.optarg);
+                break;
+#endif
+#ifdef HV57708_USING_SIM
+            case 'm':
+                HV57708_SimBench();
+                break;
+            case 't':
+                HV57708_SimDump(16);
+                break;
+#endif
+            case 'h':
+                tube_show_help();
+                break;
+            case '?':
+                rt_kprintf("error: invalid argument\n");
+                return -EXIT_FAILURE;
+        }
+    }
+    rt_kprintf("\n");
+
+    return 0;
+}
+
+MSH_CMD_EXPORT_ALIAS(tube_example, tube, a nixie tube application based hv57708);
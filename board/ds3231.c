@@ -10,6 +10,12 @@
 #include <rtdevice.h>
 #include "ds3231.h"
 #include "i2c_adapter.h"
+#ifdef DS3231_USING_CACHE
+#include "ds3231_cache.h"
+#endif
+#ifdef DS3231_USING_ALARM
+#include "ds3231_alarm.h"
+#endif
 
 /* Private typedef -----------------------------------------------------------*/
 /* Private macro -------------------------------------------------------------*/
@@ -17,7 +23,72 @@
 #define DS3231_I2C_DEVICE       "i2c1"
 #define DS3231_I2C_ADDRESS      0x68 /* DS3231 的 I2C 地址 */
 
+#define DS3231_REG_ALARM1       0x07
+#define DS3231_REG_ALARM2       0x0B
+#define DS3231_REG_CONTROL      0x0E
+#define DS3231_REG_STATUS       0x0F
+#define DS3231_REG_AGING        0x10
+#define DS3231_REG_TEMP         0x11
+
+#define DS3231_CONTROL_CONV     0x20
+#define DS3231_STATUS_EN32KHZ   0x08
+
+#define DS3231_CONV_TIMEOUT     500  /* 温度转换等待上限, ms, 典型 125ms */
+#define DS3231_CONV_POLL        10
+
+#define DS3231_REG_NUM          19   /* 0x00 ~ 0x12 */
+#define DS3231_REG_WORDS        5    /* 按 4 字节一组 */
+
+/* 寄存器镜像: 0x07 ~ 0x12, 写入时同步更新镜像 */
+#define DS3231_MIRROR_FIRST     0x07
+#define DS3231_MIRROR_NUM       12
+
+/* Private typedef -----------------------------------------------------------*/
+/* 按字节读写寄存器, 按字批量转换 BCD */
+typedef union
+{
+    uint8_t b[DS3231_REG_WORDS * 4];
+    rt_uint32_t w[DS3231_REG_WORDS];
+} DS3231_RegBuf;
+
 /* Private variables ---------------------------------------------------------*/
+/* BCD 解码表: 每个寄存器中数值所占的位, 去掉 A1M/DY/世纪等标志位,
+   时寄存器另行处理 12/24 小时制, 非 BCD 寄存器为 0 */
+static const DS3231_RegBuf bcd_mask =
+{{
+    0x7F, 0x7F, 0x3F, 0x07, 0x3F, 0x1F, 0xFF, // 0x00 ~ 0x06 时间
+    0x7F, 0x7F, 0x3F, 0x3F,                   // 0x07 ~ 0x0A 闹钟 1
+    0x7F, 0x3F, 0x3F,                         // 0x0B ~ 0x0D 闹钟 2
+    0x00, 0x00, 0x00, 0x00, 0x00,             // 0x0E ~ 0x12 控制, 状态, 老化, 温度
+}};
+
+/* 各寄存器中由芯片自行改变的位, 读取这些位时必须访问总线 */
+static const uint8_t mirror_volatile[DS3231_MIRROR_NUM] =
+{
+    0x00, 0x00, 0x00, 0x00, // 0x07 ~ 0x0A 闹钟 1
+    0x00, 0x00, 0x00,       // 0x0B ~ 0x0D 闹钟 2
+    0x20,                   // 0x0E 控制: CONV 转换完成后自动清零
+    0x87,                   // 0x0F 状态: OSF, BSY, A2F, A1F
+    0x00,                   // 0x10 老化偏移
+    0xFF, 0xFF,             // 0x11 ~ 0x12 温度
+};
+
+/* 平年每月之前的天数 */
+static const rt_uint16_t days_before_month[12] =
+{
+    0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334
+};
+
+/* 镜像和控制/状态寄存器的读改写由 lock 保护, 可嵌套 */
+static struct
+{
+    uint8_t reg[DS3231_MIRROR_NUM];
+    rt_bool_t loaded;
+    DS3231_MirrorStats stats;
+    struct rt_mutex lock;
+} ds3231_mirror;
+
+static I2c_Device ds3231_i2c;
 
 /* Private function prototypes -----------------------------------------------*/
 /* Private functions ---------------------------------------------------------*/
@@ -30,6 +101,17 @@ static void WriteControlByte(uint8_t data);
 static uint8_t ReadStatusByte(void);
 static void WriteStatusByte(uint8_t data);
 
+static void BcdUnpack(const DS3231_RegBuf *raw, DS3231_RegBuf *dec, uint8_t words);
+static uint8_t DecodeHour(uint8_t reg);
+static uint8_t EncodeHour(uint8_t hour);
+static rt_uint32_t DateToDays(uint8_t year, uint8_t month, uint8_t date);
+static rt_bool_t CheckDate(uint8_t year, uint8_t month, uint8_t date);
+static rt_bool_t CheckClock(uint8_t hour, uint8_t minute, uint8_t second);
+static void DecodeTime(const DS3231_RegBuf *raw, DS3231_Time *time);
+
+static uint8_t MirrorRead(uint8_t reg, uint8_t mask);
+static void MirrorWrite(uint8_t reg, uint8_t len, uint8_t *buf);
+
 /*******************************************************************************
 * @brief    初始化 DS3231
 * @param    None
@@ -37,8 +119,12 @@ static void WriteStatusByte(uint8_t data);
 *******************************************************************************/
 void DS3231_Init(void)
 {
-    /* 初始化 I2C 总线 */
-    rt_base_t ret = I2c_Init(DS3231_I2C_DEVICE);
+    rt_base_t ret;
+
+    rt_mutex_init(&ds3231_mirror.lock, "ds_mir", RT_IPC_FLAG_PRIO);
+
+    /* 打开 I2C 设备, 保持驱动的默认时序 */
+    ret = I2c_Open(&ds3231_i2c, DS3231_I2C_DEVICE, DS3231_I2C_ADDRESS, RT_NULL);
     if (ret != RT_EOK)
     {
         rt_kprintf("[%d]%s(): i2c init fail\n", __LINE__, __func__);
@@ -52,37 +138,84 @@ void DS3231_Init(void)
 *******************************************************************************/
 void DS3231_GetTime(DS3231_Time *time)
 {
-    uint8_t buffer[7];
+    DS3231_RegBuf raw;
 
     if (time == NULL)
         return;
 
     /* 连续读取 7 个字节 */
-    I2c_Read_nByte(DS3231_I2C_ADDRESS, (uint8_t)0x00, 7, buffer);
+    I2c_DevReadReg(&ds3231_i2c, (uint8_t)0x00, 7, raw.b);
+    raw.b[7] = 0;
 
-    time->second = BcdToDec(buffer[0]);
-    time->minute = BcdToDec(buffer[1]);
-    /* 处理 12/24 小时制 */
-    if ((buffer[2] & 0x40) == 0x40) // 12 小时制
-    {
-        time->hour = BcdToDec(buffer[2] & 0x1F);
-        if ((buffer[2] & 0x20) == 0x20) // PM
-        {
-            time->hour += 12;
-        }
-    }
+    DecodeTime(&raw, time);
+}
+
+/*******************************************************************************
+* @brief    一次连续读取全部 19 个寄存器并解码, 同时刷新寄存器镜像
+* @param    snap - 指向存储结果的结构体
+* @retval   RT_EOK: 成功, -RT_ERROR: 失败
+*******************************************************************************/
+rt_err_t DS3231_ReadAll(DS3231_Snapshot *snap)
+{
+    DS3231_RegBuf raw, dec;
+    uint8_t *b = raw.b;
+
+    if (snap == NULL)
+        return -RT_ERROR;
+
+    if (I2c_DevReadReg(&ds3231_i2c, 0x00, DS3231_REG_NUM, raw.b) != RT_EOK)
+        return -RT_ERROR;
+    raw.b[DS3231_REG_NUM] = 0;
+
+    rt_mutex_take(&ds3231_mirror.lock, RT_WAITING_FOREVER);
+    rt_memcpy(ds3231_mirror.reg, &b[DS3231_MIRROR_FIRST], DS3231_MIRROR_NUM);
+    ds3231_mirror.loaded = RT_TRUE;
+    ds3231_mirror.stats.reads++;
+    rt_mutex_release(&ds3231_mirror.lock);
+
+    BcdUnpack(&raw, &dec, DS3231_REG_WORDS);
+
+    snap->time.second = dec.b[0];
+    snap->time.minute = dec.b[1];
+    snap->time.hour   = DecodeHour(b[2]);
+    snap->time.day    = dec.b[3];
+    snap->time.date   = dec.b[4];
+    snap->time.month  = dec.b[5];
+    snap->time.year   = dec.b[6];
+
+    /* 闹钟 1: 屏蔽位格式与 DS3231_SetAlarm1 的 mask 相同 */
+    rt_memset(&snap->alarm1, 0, sizeof(snap->alarm1));
+    snap->alarm1.second = dec.b[7];
+    snap->alarm1.minute = dec.b[8];
+    snap->alarm1.hour   = DecodeHour(b[9]);
+    if (b[10] & 0x40)
+        snap->alarm1.day = dec.b[10] & 0x07;
     else
-    {
-        time->hour = BcdToDec(buffer[2] & 0x3F);
-    }
-    time->day = BcdToDec(buffer[3]);
-    time->date = BcdToDec(buffer[4]);
-    time->month = BcdToDec(buffer[5] & 0x7F);
-    time->year = BcdToDec(buffer[6]);
+        snap->alarm1.date = dec.b[10];
+    snap->alarm1_mask = (b[7] >> 7) | ((b[8] >> 6) & 0x02) | ((b[9] >> 5) & 0x04) |
+                        ((b[10] >> 4) & 0x08) | ((b[10] >> 2) & 0x10);
+
+    /* 闹钟 2: 屏蔽位格式与 DS3231_SetAlarm2 的 mask 相同 */
+    rt_memset(&snap->alarm2, 0, sizeof(snap->alarm2));
+    snap->alarm2.minute = dec.b[11];
+    snap->alarm2.hour   = DecodeHour(b[12]);
+    if (b[13] & 0x40)
+        snap->alarm2.day = dec.b[13] & 0x07;
+    else
+        snap->alarm2.date = dec.b[13];
+    snap->alarm2_mask = (b[11] >> 7) | ((b[12] >> 6) & 0x02) | ((b[13] >> 5) & 0x04) |
+                        ((b[13] >> 3) & 0x08);
+
+    snap->control = b[14];
+    snap->status = b[15];
+    snap->aging = (int8_t)b[16];
+    snap->temperature = (int16_t)(int8_t)b[17] * 4 + (b[18] >> 6);
+
+    return RT_EOK;
 }
 
 /*******************************************************************************
-* @brief    获取当前时钟读数(时, 分, 秒)
+* @brief    获取当前时钟读数(时, 分, 秒), 统一 24 小时制
 * @param    time - 指向存储当前时钟读数的结构体
 * @retval   None
 *******************************************************************************/
@@ -94,11 +227,11 @@ void DS3231_GetClock(DS3231_Clock *clock)
         return;
 
     /* 连续读取存储日期的 3 个字节 */
-    I2c_Read_nByte(DS3231_I2C_ADDRESS, (uint8_t)0x00, 3, buffer);
+    I2c_DevReadReg(&ds3231_i2c, (uint8_t)0x00, 3, buffer);
 
-    clock->second = BcdToDec(buffer[0]);
-    clock->minute = BcdToDec(buffer[1]);
-    clock->hour = BcdToDec(buffer[2]);
+    clock->second = BcdToDec(buffer[0] & 0x7F);
+    clock->minute = BcdToDec(buffer[1] & 0x7F);
+    clock->hour = DecodeHour(buffer[2]);
 }
 
 /*******************************************************************************
@@ -114,7 +247,7 @@ void DS3231_GetDate(DS3231_Date *date)
         return;
 
     /* 连续读取存储日期的 4 个字节 */
-    I2c_Read_nByte(DS3231_I2C_ADDRESS, (uint8_t)0x03, 4, buffer);
+    I2c_DevReadReg(&ds3231_i2c, (uint8_t)0x03, 4, buffer);
 
     date->day   = BcdToDec(buffer[0]);
     date->date  = BcdToDec(buffer[1]);
@@ -123,61 +256,97 @@ void DS3231_GetDate(DS3231_Date *date)
 }
 
 /*******************************************************************************
-* @brief    设置 DS3231 所有计时寄存器
-* @param    time - 指向要设置的时间的指针
-* @retval   None
+* @brief    设置 DS3231 所有计时寄存器, 星期由日期算出, 芯片切换为 24 小时制
+* @param    time - 指向要设置的时间的指针, 24 小时制, day 不需要填写,
+*           返回时为算出的星期
+* @retval   RT_EOK, -RT_EINVAL: 时间无效, 未访问总线, -RT_ERROR: 写入失败
 *******************************************************************************/
-void DS3231_SetTime(DS3231_Time *time)
+rt_err_t DS3231_SetTime(DS3231_Time *time)
 {
     uint8_t buffer[7];
+    rt_err_t ret;
 
     if (time == NULL)
-        return;
+        return -RT_EINVAL;
+    if (!CheckDate(time->year, time->month, time->date) ||
+        !CheckClock(time->hour, time->minute, time->second))
+        return -RT_EINVAL;
+
+    time->day = DS3231_Weekday(time->year, time->month, time->date);
 
     buffer[0] = DecToBcd(time->second);
     buffer[1] = DecToBcd(time->minute);
-    buffer[2] = DecToBcd(time->hour);
+    buffer[2] = EncodeHour(time->hour);
     buffer[3] = DecToBcd(time->day);
     buffer[4] = DecToBcd(time->date);
     buffer[5] = DecToBcd(time->month);
     buffer[6] = DecToBcd(time->year);
 
     /* 连续写入 7 个字节 */
-    I2c_Write_nByte(DS3231_I2C_ADDRESS, 0x00, 7, buffer);
+    ret = I2c_DevWriteReg(&ds3231_i2c, 0x00, 7, buffer);
+    if (ret == RT_EOK)
+    {
+#ifdef DS3231_USING_CACHE
+        DS3231_CacheResync();
+#endif
+#ifdef DS3231_USING_ALARM
+        DS3231_AlarmResync();
+#endif
+    }
+
+    return ret;
 }
 
 /*******************************************************************************
-* @brief    设置时, 分, 秒寄存器
-* @param    clock - 指向要设置的时间的指针
-* @retval   None
+* @brief    设置时, 分, 秒寄存器, 芯片切换为 24 小时制
+* @param    clock - 指向要设置的时间的指针, 24 小时制
+* @retval   RT_EOK, -RT_EINVAL: 时间无效, 未访问总线, -RT_ERROR: 写入失败
 *******************************************************************************/
-void DS3231_SetClock(DS3231_Clock *clock)
+rt_err_t DS3231_SetClock(DS3231_Clock *clock)
 {
     uint8_t buffer[3];
+    rt_err_t ret;
 
     if (clock == NULL)
-        return;
+        return -RT_EINVAL;
+    if (!CheckClock(clock->hour, clock->minute, clock->second))
+        return -RT_EINVAL;
 
     buffer[0] = DecToBcd(clock->second);
     buffer[1] = DecToBcd(clock->minute);
-    buffer[2] = DecToBcd(clock->hour);
+    buffer[2] = EncodeHour(clock->hour);
 
     /* 连续写入 3 个字节 */
-    int ret = I2c_Write_nByte(DS3231_I2C_ADDRESS, 0x00, 3, buffer);
-    rt_kprintf("DS3231_SetClock: ret = %d\n", ret);
+    ret = I2c_DevWriteReg(&ds3231_i2c, 0x00, 3, buffer);
+    if (ret == RT_EOK)
+    {
+#ifdef DS3231_USING_CACHE
+        DS3231_CacheResync();
+#endif
+#ifdef DS3231_USING_ALARM
+        DS3231_AlarmResync();
+#endif
+    }
+
+    return ret;
 }
 
 /*******************************************************************************
-* @brief    设置日期寄存器
-* @param    date - 指向要设置的日期的指针
-* @retval   None
+* @brief    设置日期寄存器, 星期由日期算出
+* @param    date - 指向要设置的日期的指针, day 不需要填写, 返回时为算出的星期
+* @retval   RT_EOK, -RT_EINVAL: 日期无效, 未访问总线, -RT_ERROR: 写入失败
 *******************************************************************************/
-void DS3231_SetDate(DS3231_Date *date)
+rt_err_t DS3231_SetDate(DS3231_Date *date)
 {
     uint8_t buffer[4];
+    rt_err_t ret;
 
     if (date == NULL)
-        return;
+        return -RT_EINVAL;
+    if (!CheckDate(date->year, date->month, date->date))
+        return -RT_EINVAL;
+
+    date->day = DS3231_Weekday(date->year, date->month, date->date);
 
     buffer[0] = DecToBcd(date->day);
     buffer[1] = DecToBcd(date->date);
@@ -185,7 +354,18 @@ void DS3231_SetDate(DS3231_Date *date)
     buffer[3] = DecToBcd(date->year);
 
     /* 连续写入 4 个字节 */
-    I2c_Write_nByte(DS3231_I2C_ADDRESS, 0x03, 4, buffer);
+    ret = I2c_DevWriteReg(&ds3231_i2c, 0x03, 4, buffer);
+    if (ret == RT_EOK)
+    {
+#ifdef DS3231_USING_CACHE
+        DS3231_CacheResync();
+#endif
+#ifdef DS3231_USING_ALARM
+        DS3231_AlarmResync();
+#endif
+    }
+
+    return ret;
 }
 
 /*******************************************************************************
@@ -204,7 +384,7 @@ void DS3231_SetAlarm1(uint8_t mask, DS3231_Time *time)
 
     buffer[0] = DecToBcd(time->second) | ((mask & 0x01) << 7);
     buffer[1] = DecToBcd(time->minute) | ((mask & 0x02) << 6);
-    buffer[2] = DecToBcd(time->hour) | ((mask & 0x04) << 5);
+    buffer[2] = EncodeHour(time->hour) | ((mask & 0x04) << 5);
     /* 按星期重复 or 日期重复 */
     if ((mask & 0x10) == 0x10)
     {
@@ -216,7 +396,7 @@ void DS3231_SetAlarm1(uint8_t mask, DS3231_Time *time)
         buffer[3] = DecToBcd(time->date) | ((mask & 0x08) << 4);
     }
 
-    I2c_Write_nByte(DS3231_I2C_ADDRESS, 0x07, 4, buffer);
+    MirrorWrite(DS3231_REG_ALARM1, 4, buffer);
 }
 
 /*******************************************************************************
@@ -234,7 +414,7 @@ void DS3231_SetAlarm2(uint8_t mask, DS3231_Time *time)
         return;
 
     buffer[0] = DecToBcd(time->minute) | ((mask & 0x01) << 7);
-    buffer[1] = DecToBcd(time->hour) | ((mask & 0x02) << 6);
+    buffer[1] = EncodeHour(time->hour) | ((mask & 0x02) << 6);
     /* 按星期重复 or 日期重复 */
     if ((mask & 0x08) == 0x08)
     {
@@ -246,7 +426,7 @@ void DS3231_SetAlarm2(uint8_t mask, DS3231_Time *time)
         buffer[2] = DecToBcd(time->date) | ((mask & 0x04) << 5);
     }
 
-    I2c_Write_nByte(DS3231_I2C_ADDRESS, 0x0B, 3, buffer);
+    MirrorWrite(DS3231_REG_ALARM2, 3, buffer);
 }
 
 /*******************************************************************************
@@ -256,12 +436,16 @@ void DS3231_SetAlarm2(uint8_t mask, DS3231_Time *time)
 *******************************************************************************/
 void DS3231_EnableAlarmIT(uint8_t alarm)
 {
-    uint8_t temp = ReadControlByte();
+    uint8_t temp;
+
+    rt_mutex_take(&ds3231_mirror.lock, RT_WAITING_FOREVER);
+    temp = ReadControlByte();
     if (alarm == 1)
         temp |= 0x05;
     else
         temp |= 0x06;
     WriteControlByte(temp);
+    rt_mutex_release(&ds3231_mirror.lock);
 }
 
 /*******************************************************************************
@@ -271,12 +455,16 @@ void DS3231_EnableAlarmIT(uint8_t alarm)
 *******************************************************************************/
 void DS3231_DisableAlarmIT(uint8_t alarm)
 {
-    uint8_t temp = ReadControlByte();
+    uint8_t temp;
+
+    rt_mutex_take(&ds3231_mirror.lock, RT_WAITING_FOREVER);
+    temp = ReadControlByte();
     if (alarm == 1)
         temp &= 0xFE;
     else
         temp &= 0xFD;
     WriteControlByte(temp);
+    rt_mutex_release(&ds3231_mirror.lock);
 }
 
 /*******************************************************************************
@@ -307,55 +495,412 @@ rt_bool_t DS3231_CheckAlarmITEnabled(uint8_t alarm)
 *******************************************************************************/
 rt_bool_t DS3231_CheckIfAlarm(uint8_t alarm)
 {
-    uint8_t result = RT_FALSE;
-    uint8_t temp = ReadStatusByte();
-    /* 判断哪个闹钟响 */
-    if (alarm == 1)
+    uint8_t flag = (alarm == 1) ? DS3231_FLAG_A1F : DS3231_FLAG_A2F;
+
+    return !!(DS3231_ReadFlags(flag) & flag);
+}
+
+/*******************************************************************************
+* @brief    一次读取状态寄存器, 并清除其中已置位的指定闹钟标志.
+*           只有需要清除时才写回, 写回时其余标志写 1 保持不变,
+*           不会丢失读取之后才置位的标志
+* @param    clear 要清除的标志, DS3231_FLAG_A1F | DS3231_FLAG_A2F, 0 为只读
+* @retval   读取到的状态寄存器
+*******************************************************************************/
+uint8_t DS3231_ReadFlags(uint8_t clear)
+{
+    uint8_t status;
+
+    rt_mutex_take(&ds3231_mirror.lock, RT_WAITING_FOREVER);
+    status = ReadStatusByte();
+    clear &= status & (DS3231_FLAG_A1F | DS3231_FLAG_A2F);
+    if (clear)
     {
-        result = temp & 0x01;
-        temp &= 0xFE;
+        /* A1F, A2F, OSF 写 1 无效, 写 0 清除 */
+        WriteStatusByte((status | DS3231_FLAG_OSF | DS3231_FLAG_A1F | DS3231_FLAG_A2F) & ~clear);
     }
+    rt_mutex_release(&ds3231_mirror.lock);
+
+    return status;
+}
+
+/*******************************************************************************
+* @brief    丢弃寄存器镜像, 下次访问时重新读取, 芯片掉电或被其他主机修改后调用
+* @param    None
+* @retval   None
+*******************************************************************************/
+void DS3231_InvalidateMirror(void)
+{
+    rt_mutex_take(&ds3231_mirror.lock, RT_WAITING_FOREVER);
+    ds3231_mirror.loaded = RT_FALSE;
+    rt_mutex_release(&ds3231_mirror.lock);
+}
+
+/*******************************************************************************
+* @brief    获取寄存器镜像的统计
+* @param    stats - 输出
+* @retval   None
+*******************************************************************************/
+void DS3231_GetMirrorStats(DS3231_MirrorStats *stats)
+{
+    if (stats == NULL)
+        return;
+
+    rt_mutex_take(&ds3231_mirror.lock, RT_WAITING_FOREVER);
+    *stats = ds3231_mirror.stats;
+    rt_mutex_release(&ds3231_mirror.lock);
+}
+
+/*******************************************************************************
+* @brief    INT/SQW 引脚输出方波, 此时闹钟中断不再从该引脚输出.
+*           1Hz 方波的下降沿与秒寄存器更新对齐
+* @param    rate 方波频率 DS3231_SQW_1Hz ~ DS3231_SQW_8192Hz
+* @retval   None
+*******************************************************************************/
+void DS3231_SetSquareWave(uint8_t rate)
+{
+    uint8_t temp;
+
+    rt_mutex_take(&ds3231_mirror.lock, RT_WAITING_FOREVER);
+    temp = ReadControlByte();
+    temp &= ~0x1C; // 清除 INTCN, RS2, RS1
+    temp |= rate & 0x18;
+    WriteControlByte(temp);
+    rt_mutex_release(&ds3231_mirror.lock);
+}
+
+/*******************************************************************************
+* @brief    开关 32kHz 引脚输出, 上电默认开启
+* @param    enable - RT_TRUE 开启
+* @retval   None
+*******************************************************************************/
+void DS3231_Enable32kHz(rt_bool_t enable)
+{
+    uint8_t status;
+
+    rt_mutex_take(&ds3231_mirror.lock, RT_WAITING_FOREVER);
+    status = ReadStatusByte();
+    /* A1F, A2F, OSF 写 1 保持不变 */
+    status |= DS3231_FLAG_OSF | DS3231_FLAG_A1F | DS3231_FLAG_A2F;
+    if (enable)
+        status |= DS3231_STATUS_EN32KHZ;
     else
+        status &= ~DS3231_STATUS_EN32KHZ;
+    WriteStatusByte(status);
+    rt_mutex_release(&ds3231_mirror.lock);
+}
+
+/*******************************************************************************
+* @brief    读取温度, 不触发转换, 芯片每 64 秒自动转换一次
+* @param    None
+* @retval   温度, 定点数, 单位 0.25 ℃ (DS3231_TEMP_SCALE)
+*******************************************************************************/
+rt_int16_t DS3231_GetTemperature(void)
+{
+    uint8_t buffer[2];
+    uint8_t index = DS3231_REG_TEMP - DS3231_MIRROR_FIRST;
+    rt_int16_t temp;
+
+    rt_mutex_take(&ds3231_mirror.lock, RT_WAITING_FOREVER);
+    if (I2c_DevReadReg(&ds3231_i2c, DS3231_REG_TEMP, 2, buffer) == RT_EOK)
+        rt_memcpy(&ds3231_mirror.reg[index], buffer, 2);
+    ds3231_mirror.stats.reads++;
+
+    /* 高字节为整数部分 (补码), 低字节高 2 位为 0.25 ℃ */
+    temp = (rt_int16_t)(int8_t)ds3231_mirror.reg[index] * 4 + (ds3231_mirror.reg[index + 1] >> 6);
+    rt_mutex_release(&ds3231_mirror.lock);
+
+    return temp;
+}
+
+/*******************************************************************************
+* @brief    强制温度转换: 等待自动转换 (BSY) 结束后置 CONV, 等待 CONV 清零.
+*           转换结束后芯片按新的温度和老化偏移重新调整振荡器
+* @param    None
+* @retval   RT_EOK, -RT_ETIMEOUT: 超时
+*******************************************************************************/
+rt_err_t DS3231_ConvertTemperature(void)
+{
+    rt_int32_t wait;
+
+    for (wait = 0; ReadStatusByte() & DS3231_FLAG_BSY; wait += DS3231_CONV_POLL)
     {
-        result = temp & 0x02;
-        temp &= 0xFD;
+        if (wait >= DS3231_CONV_TIMEOUT)
+            return -RT_ETIMEOUT;
+        rt_thread_mdelay(DS3231_CONV_POLL);
     }
-    /* 清除闹钟标志 */
-    WriteStatusByte(temp);
 
-    return !!result;
+    /* 只在读改写期间持有锁, 轮询 CONV 时不阻塞其他寄存器访问 */
+    rt_mutex_take(&ds3231_mirror.lock, RT_WAITING_FOREVER);
+    WriteControlByte(ReadControlByte() | DS3231_CONTROL_CONV);
+    rt_mutex_release(&ds3231_mirror.lock);
+
+    for (wait = 0; MirrorRead(DS3231_REG_CONTROL, DS3231_CONTROL_CONV) & DS3231_CONTROL_CONV;
+         wait += DS3231_CONV_POLL)
+    {
+        if (wait >= DS3231_CONV_TIMEOUT)
+            return -RT_ETIMEOUT;
+        rt_thread_mdelay(DS3231_CONV_POLL);
+    }
+
+    return RT_EOK;
+}
+
+/*******************************************************************************
+* @brief    读取老化偏移
+* @param    None
+* @retval   老化偏移, 每 LSB 约 0.1 ppm, 正值使振荡器变慢
+*******************************************************************************/
+int8_t DS3231_GetAging(void)
+{
+    return (int8_t)MirrorRead(DS3231_REG_AGING, 0);
+}
+
+/*******************************************************************************
+* @brief    设置老化偏移, 下一次温度转换后生效, 需要立即生效时
+*           再调用 DS3231_ConvertTemperature
+* @param    aging - 老化偏移, -128 ~ 127
+* @retval   None
+*******************************************************************************/
+void DS3231_SetAging(int8_t aging)
+{
+    uint8_t data = (uint8_t)aging;
+
+    MirrorWrite(DS3231_REG_AGING, 1, &data);
+}
+
+/*******************************************************************************
+* @brief    时间转换为 2000-01-01 00:00:00 起的秒数, 不使用 day 字段
+* @param    time - 24 小时制时间
+* @retval   秒数
+*******************************************************************************/
+rt_uint32_t DS3231_TimeToSeconds(const DS3231_Time *time)
+{
+    rt_uint32_t days = DateToDays(time->year, time->month, time->date);
+
+    return days * 86400UL + time->hour * 3600UL + time->minute * 60 + time->second;
+}
+
+/*******************************************************************************
+* @brief    检查时间是否有效, 与 DS3231_SetTime 的检查相同, 不访问总线
+* @param    time - 24 小时制时间, 不检查 day
+* @retval   RT_TRUE 有效
+*******************************************************************************/
+rt_bool_t DS3231_TimeValid(const DS3231_Time *time)
+{
+    return time != NULL && CheckDate(time->year, time->month, time->date) &&
+           CheckClock(time->hour, time->minute, time->second);
+}
+
+/*******************************************************************************
+* @brief    由日期算出星期, 常数时间, 不访问总线
+* @param    year - 0 ~ 99 对应 2000 ~ 2099 年
+* @param    month - 1 ~ 12
+* @param    date - 1 ~ 31
+* @retval   1 ~ 7 对应星期一 ~ 星期日, 与 DS3231_SecondsToTime 一致
+*******************************************************************************/
+uint8_t DS3231_Weekday(uint8_t year, uint8_t month, uint8_t date)
+{
+    return (DateToDays(year, month, date) + 5) % 7 + 1; // 2000-01-01 是星期六
+}
+
+/*******************************************************************************
+* @brief    2000-01-01 00:00:00 起的秒数转换为时间, 同时算出星期
+* @param    seconds - 秒数
+* @param    time - 输出, 24 小时制, day 为 1 ~ 7 对应星期一 ~ 星期日
+* @retval   None
+*******************************************************************************/
+void DS3231_SecondsToTime(rt_uint32_t seconds, DS3231_Time *time)
+{
+    rt_uint32_t days = seconds / 86400;
+    rt_uint32_t rem = seconds % 86400;
+    rt_uint8_t leap, month;
+
+    time->hour = rem / 3600;
+    time->minute = rem % 3600 / 60;
+    time->second = rem % 60;
+    time->day = (days + 5) % 7 + 1; // 2000-01-01 是星期六
+
+    /* 4 年一个周期, 周期的第一年是闰年 */
+    time->year = days / 1461 * 4;
+    days %= 1461;
+    leap = (days < 366);
+    if (!leap)
+    {
+        days -= 366;
+        time->year += 1 + days / 365;
+        days %= 365;
+    }
+
+    /* 每月不超过 31 天, days / 32 最多比实际月份少 1, 查表修正一次 */
+    month = days / 32;
+    if (month < 11 && days >= days_before_month[month + 1] + (month + 1 >= 2 ? leap : 0))
+        month++;
+    time->month = month + 1;
+    time->date = days - days_before_month[month] - (month >= 2 ? leap : 0) + 1;
+}
+
+/*******************************************************************************
+* @brief    对比分两次传输和组合传输读取时间寄存器的耗时
+* @param    count - 每种方式的读取次数
+* @retval   None
+*******************************************************************************/
+void DS3231_BusBench(rt_uint32_t count)
+{
+    I2c_Bench(&ds3231_i2c, 0x00, 7, count);
 }
 
 /*--------------------------------- 内部函数 ---------------------------------*/
 
-// 控制寄存器 0x0E
+// 寄存器镜像, 首次访问时一次读入 0x07 ~ 0x12
+uint8_t MirrorRead(uint8_t reg, uint8_t mask)
+{
+    uint8_t index = reg - DS3231_MIRROR_FIRST;
+    uint8_t value;
+
+    rt_mutex_take(&ds3231_mirror.lock, RT_WAITING_FOREVER);
+    if (!ds3231_mirror.loaded)
+    {
+        if (I2c_DevReadReg(&ds3231_i2c, DS3231_MIRROR_FIRST,
+                           DS3231_MIRROR_NUM, ds3231_mirror.reg) == RT_EOK)
+        {
+            ds3231_mirror.loaded = RT_TRUE;
+        }
+        ds3231_mirror.stats.reads++;
+    }
+    else if (mask & mirror_volatile[index])
+    {
+        I2c_DevReadReg(&ds3231_i2c, reg, 1, &ds3231_mirror.reg[index]);
+        ds3231_mirror.stats.reads++;
+    }
+    else
+    {
+        ds3231_mirror.stats.hits++;
+    }
+    value = ds3231_mirror.reg[index];
+    rt_mutex_release(&ds3231_mirror.lock);
+
+    return value;
+}
+
+// 写穿: 先写芯片, 成功后更新镜像
+void MirrorWrite(uint8_t reg, uint8_t len, uint8_t *buf)
+{
+    rt_mutex_take(&ds3231_mirror.lock, RT_WAITING_FOREVER);
+    if (I2c_DevWriteReg(&ds3231_i2c, reg, len, buf) == RT_EOK)
+        rt_memcpy(&ds3231_mirror.reg[reg - DS3231_MIRROR_FIRST], buf, len);
+    ds3231_mirror.stats.writes++;
+    rt_mutex_release(&ds3231_mirror.lock);
+}
+
+// 控制寄存器 0x0E, 不含易变的 CONV 位, 读改写时不会意外启动温度转换
 uint8_t ReadControlByte(void)
 {
-    uint8_t val;
-    I2c_Read_1Byte(DS3231_I2C_ADDRESS, 0x0E, &val);
-    return val;
+    return MirrorRead(DS3231_REG_CONTROL, 0) & ~DS3231_CONTROL_CONV;
 }
 
 void WriteControlByte(uint8_t data)
 {
-    I2c_Write_1Byte(DS3231_I2C_ADDRESS, 0x0E, data);
+    MirrorWrite(DS3231_REG_CONTROL, 1, &data);
 }
 
-// 状态寄存器 0x0F
+// 状态寄存器 0x0F, 标志位总是从芯片读取
 uint8_t ReadStatusByte(void)
 {
-    uint8_t val;
-    I2c_Read_1Byte(DS3231_I2C_ADDRESS, 0x0F, &val);
-    return val;
+    return MirrorRead(DS3231_REG_STATUS, 0xFF);
 }
 
 void WriteStatusByte(uint8_t data)
 {
-  I2c_Write_1Byte(DS3231_I2C_ADDRESS, 0x0F, data);
+    MirrorWrite(DS3231_REG_STATUS, 1, &data);
 }
 
 // 二十进制转换
 
+/* 每次 4 个字节: 按解码表去掉标志位, 高 4 位乘 10 加低 4 位,
+   每字节结果不超过 99, 字节之间不会进位 */
+void BcdUnpack(const DS3231_RegBuf *raw, DS3231_RegBuf *dec, uint8_t words)
+{
+    rt_uint32_t v;
+    uint8_t i;
+
+    for (i = 0; i < words; i++)
+    {
+        v = raw->w[i] & bcd_mask.w[i];
+        dec->w[i] = (v & 0x0F0F0F0F) + ((v >> 4) & 0x0F0F0F0F) * 10;
+    }
+}
+
+/* 时寄存器, 统一为 24 小时制 */
+uint8_t DecodeHour(uint8_t reg)
+{
+    uint8_t hour;
+
+    if (reg & 0x40) // 12 小时制, 12 AM 为 0 点, 12 PM 为 12 点
+    {
+        hour = BcdToDec(reg & 0x1F) % 12;
+        if (reg & 0x20) // PM
+            hour += 12;
+        return hour;
+    }
+    return BcdToDec(reg & 0x3F);
+}
+
+/* 时寄存器, 与 DecodeHour 对称: 写入一律为 24 小时制 (bit6 = 0),
+   闹钟的时寄存器也用 24 小时制, 与计时寄存器比较时格式一致 */
+uint8_t EncodeHour(uint8_t hour)
+{
+    return DecToBcd(hour) & 0x3F;
+}
+
+/* 2000-01-01 起的天数, 2000 ~ 2099 年每 4 年一闰, year 年之前有 (year + 3) / 4 个闰年 */
+rt_uint32_t DateToDays(uint8_t year, uint8_t month, uint8_t date)
+{
+    rt_uint32_t days;
+
+    days = year * 365UL + (year + 3) / 4 + days_before_month[(month - 1) % 12] + date - 1;
+    if (month > 2 && (year % 4) == 0)
+        days++;
+
+    return days;
+}
+
+/* 日期范围检查, 2000 ~ 2099 年 */
+rt_bool_t CheckDate(uint8_t year, uint8_t month, uint8_t date)
+{
+    uint8_t days;
+
+    if (year > 99 || month < 1 || month > 12 || date < 1)
+        return RT_FALSE;
+
+    days = (month == 12) ? 31 : days_before_month[month] - days_before_month[month - 1];
+    if (month == 2 && (year % 4) == 0)
+        days++;
+
+    return date <= days;
+}
+
+rt_bool_t CheckClock(uint8_t hour, uint8_t minute, uint8_t second)
+{
+    return hour < 24 && minute < 60 && second < 60;
+}
+
+/* 时间寄存器 0x00 ~ 0x06, raw 至少 2 个字 */
+void DecodeTime(const DS3231_RegBuf *raw, DS3231_Time *time)
+{
+    DS3231_RegBuf dec;
+
+    BcdUnpack(raw, &dec, 2);
+
+    time->second = dec.b[0];
+    time->minute = dec.b[1];
+    time->hour   = DecodeHour(raw->b[2]);
+    time->day    = dec.b[3];
+    time->date   = dec.b[4];
+    time->month  = dec.b[5];
+    time->year   = dec.b[6];
+}
+
 uint8_t BcdToDec(uint8_t val)
 {
     return (val >> 4) * 10 + (val & 0x0F);
@@ -37,9 +37,30 @@ typedef struct
     uint8_t year;
     uint8_t month;
     uint8_t date;
-    uint8_t day; // 星期和日期是联动的
+    uint8_t day; // 星期和日期是联动的, 设置时由日期算出
 } DS3231_Date;
 
+/* 全部寄存器的快照 */
+typedef struct
+{
+    DS3231_Time time;
+    DS3231_Time alarm1;     // 秒, 分, 时, 日期或星期
+    uint8_t alarm1_mask;    // 与 DS3231_SetAlarm1 的 mask 格式相同
+    DS3231_Time alarm2;     // 分, 时, 日期或星期
+    uint8_t alarm2_mask;    // 与 DS3231_SetAlarm2 的 mask 格式相同
+    uint8_t control;
+    uint8_t status;
+    int8_t aging;           // 老化偏移
+    int16_t temperature;    // 单位 0.25 ℃
+} DS3231_Snapshot;
+
+typedef struct
+{
+    rt_uint32_t hits;   // 直接由镜像返回的读取
+    rt_uint32_t reads;  // 访问总线的读取
+    rt_uint32_t writes; // 写穿
+} DS3231_MirrorStats;
+
 /* Exported constants --------------------------------------------------------*/
 /* Exported variables --------------------------------------------------------*/
 /* Exported macro ------------------------------------------------------------*/
@@ -60,15 +81,59 @@ typedef struct
 #define  DS3231_A2_DateHourMinute       0x00 // 日期-时-分
 #define  DS3231_A2_DayHourMinute        0x08 // 星期-时-分
 
+/* 状态寄存器标志 */
+#define  DS3231_FLAG_A1F                0x01
+#define  DS3231_FLAG_A2F                0x02
+#define  DS3231_FLAG_BSY                0x04
+#define  DS3231_FLAG_OSF                0x80
+
+/* SQW 方波频率 (控制寄存器 RS2, RS1) */
+#define  DS3231_SQW_1Hz                 0x00
+#define  DS3231_SQW_1024Hz              0x08
+#define  DS3231_SQW_4096Hz              0x10
+#define  DS3231_SQW_8192Hz              0x18
+
+/* 温度定点数: 1 ℃ = DS3231_TEMP_SCALE */
+#define  DS3231_TEMP_SCALE              4
+
+/* 时间缓存服务, 由 SQW 秒边沿在内存中走时, 见 ds3231_cache.c */
+#define  DS3231_USING_CACHE
+#define  DS3231_CACHE_RESYNC            3600 // 定期对时的间隔, 秒
+#define  DS3231_CACHE_TIMEOUT           2000 // 超过此时间(ms)没有秒边沿则缓存失效
+
+/* 软件闹钟, 任意多个闹钟按下次响铃时间排成最小堆, 最近的一个写入闹钟 1, 见 ds3231_alarm.c */
+#define  DS3231_USING_ALARM
+#define  DS3231_ALARM_MAX               16   // 闹钟个数上限
+
+/* 老化偏移校准, 用串口送来的参考时间测量走时误差并调整老化偏移,
+   需要时间缓存提供毫秒相位, 见 ds3231_drift.c */
+#define  DS3231_USING_DRIFT
+#define  DS3231_DRIFT_WINDOW            3600 // 测量窗口, 秒
+
+/* 高分辨率时间戳: 32kHz 输出由 TIM8 外部时钟计数, SQW 秒边沿硬件锁存,
+   分辨率约 30.5us, 需要时间缓存提供秒数, 见 ds3231_stamp.c */
+#define  DS3231_USING_STAMP
+
+/* 时区与夏令时: 芯片保存 UTC, 显示和闹钟使用 POSIX TZ 规则换算的本地时间,
+   见 ds3231_tz.c */
+#define  DS3231_USING_TZ
+#define  DS3231_TZ_DEFAULT              "CST-8"
+
+/* 注册为 RT-Thread rtc 设备, 供 time(), stime() 使用, 见 ds3231_rtc.c */
+#ifdef RT_USING_RTC
+#define  DS3231_USING_RTC
+#endif
+
 /* Exported functions ------------------------------------------------------- */
 void DS3231_Init(void);
 void DS3231_GetTime(DS3231_Time *time);
 void DS3231_GetClock(DS3231_Clock *clock);
 void DS3231_GetDate(DS3231_Date *date);
+rt_err_t DS3231_ReadAll(DS3231_Snapshot *snap);
 
-void DS3231_SetTime(DS3231_Time *time);
-void DS3231_SetClock(DS3231_Clock *clock);
-void DS3231_SetDate(DS3231_Date *date);
+rt_err_t DS3231_SetTime(DS3231_Time *time);
+rt_err_t DS3231_SetClock(DS3231_Clock *clock);
+rt_err_t DS3231_SetDate(DS3231_Date *date);
 
 void DS3231_SetAlarm1(uint8_t mode, DS3231_Time *time);
 void DS3231_SetAlarm2(uint8_t mode, DS3231_Time *time);
@@ -78,7 +143,24 @@ void DS3231_DisableAlarmIT(uint8_t alarm);
 
 rt_bool_t DS3231_CheckAlarmITEnabled(uint8_t alarm);
 rt_bool_t DS3231_CheckIfAlarm(uint8_t alarm);
+uint8_t DS3231_ReadFlags(uint8_t clear);
+
+void DS3231_InvalidateMirror(void);
+void DS3231_GetMirrorStats(DS3231_MirrorStats *stats);
+
+void DS3231_SetSquareWave(uint8_t rate);
+void DS3231_Enable32kHz(rt_bool_t enable);
+
+rt_uint32_t DS3231_TimeToSeconds(const DS3231_Time *time);
+void DS3231_SecondsToTime(rt_uint32_t seconds, DS3231_Time *time);
+uint8_t DS3231_Weekday(uint8_t year, uint8_t month, uint8_t date);
+rt_bool_t DS3231_TimeValid(const DS3231_Time *time);
+
+rt_int16_t DS3231_GetTemperature(void);
+rt_err_t DS3231_ConvertTemperature(void);
+int8_t DS3231_GetAging(void);
+void DS3231_SetAging(int8_t aging);
 
-//float DS3231_GetTemperature(void);
+void DS3231_BusBench(rt_uint32_t count);
 
 #endif /* __DS3231_H */
@@ -0,0 +1,633 @@
+/*******************************************************************************
+* @file     ds3231_alarm.c
+* @version  1.0
+* @brief    DS3231 软件闹钟
+*           芯片只有两个闹钟, 这里用一个最小堆管理任意多个软件闹钟
+*           (单次, 每天, 每周指定几天, 固定间隔), 堆顶是最近要响的一个.
+*           堆顶的时刻以 日期-时-分-秒 匹配写入闹钟 1, 到点前 MCU 不做任何轮询:
+*             - 未使用时间缓存: INT/SQW 引脚输出闹钟中断
+*             - 使用时间缓存: 引脚输出 1Hz 方波, 中断中对剩余秒数倒数, 到 0 投递
+*           两种情况都经 ds3231_irq 清除 A1F 后回调, 唤醒闹钟线程,
+*           闹钟线程按芯片时间执行所有到期的闹钟, 再把新的堆顶写入闹钟 1.
+*           时间单位为 2000-01-01 00:00:00 起的秒数. 使用时区时芯片保存 UTC,
+*           闹钟的设定时间是本地时间, 计算下一次响铃时换算, 堆中保存 UTC
+*******************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include <rtdevice.h>
+#include "ds3231_alarm.h"
+#include "ds3231_irq.h"
+#include "dwt_cycle.h"
+#ifdef DS3231_USING_CACHE
+#include "ds3231_cache.h"
+#endif
+#ifdef DS3231_USING_TZ
+#include "ds3231_tz.h"
+#endif
+
+#ifdef DS3231_USING_ALARM
+
+/* Private define ------------------------------------------------------------*/
+#define ALARM_THREAD_STACK      1024
+#define ALARM_THREAD_PRIORITY   11
+#define ALARM_THREAD_TIMESLICE  5
+#define ALARM_BENCH_MAX         1000
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+    rt_uint32_t when;           /* 下次响铃时刻 */
+    rt_uint16_t slot;           /* 闹钟编号 */
+} alarm_node;
+
+/* 最小堆, pos[slot] 记录每个闹钟在堆中的下标, 用于按编号删除 */
+typedef struct
+{
+    alarm_node *node;
+    rt_uint16_t *pos;
+    rt_uint16_t num;
+} alarm_heap;
+
+/* Private variables ---------------------------------------------------------*/
+static struct
+{
+    DS3231_AlarmConfig config[DS3231_ALARM_MAX];
+    rt_bool_t used[DS3231_ALARM_MAX];
+    alarm_node node[DS3231_ALARM_MAX];
+    rt_uint16_t pos[DS3231_ALARM_MAX];
+    alarm_heap heap;
+    rt_uint32_t programmed;     /* 已写入闹钟 1 的时刻 */
+    rt_bool_t armed;
+    volatile rt_int32_t countdown;
+    volatile rt_bool_t resync;
+    DS3231_AlarmStats stats;
+    struct rt_mutex lock;
+    struct rt_semaphore wake;
+    struct rt_thread thread;
+    rt_bool_t inited;
+} ds3231_alarm;
+
+ALIGN(RT_ALIGN_SIZE)
+static rt_uint8_t alarm_stack[ALARM_THREAD_STACK];
+
+static const char *const alarm_type_name[] =
+{
+    "once", "daily", "weekly", "interval"
+};
+
+/* Private functions ---------------------------------------------------------*/
+
+/*------------------------------------ 堆 ------------------------------------*/
+
+static void heap_set(alarm_heap *heap, rt_uint16_t i, alarm_node node)
+{
+    heap->node[i] = node;
+    heap->pos[node.slot] = i;
+}
+
+static void heap_up(alarm_heap *heap, rt_uint16_t i)
+{
+    alarm_node node = heap->node[i];
+    rt_uint16_t parent;
+
+    while (i > 0)
+    {
+        parent = (i - 1) / 2;
+        if (heap->node[parent].when <= node.when)
+            break;
+        heap_set(heap, i, heap->node[parent]);
+        i = parent;
+    }
+    heap_set(heap, i, node);
+}
+
+static void heap_down(alarm_heap *heap, rt_uint16_t i)
+{
+    alarm_node node = heap->node[i];
+    rt_uint16_t child;
+
+    while ((child = i * 2 + 1) < heap->num)
+    {
+        if (child + 1 < heap->num && heap->node[child + 1].when < heap->node[child].when)
+            child++;
+        if (node.when <= heap->node[child].when)
+            break;
+        heap_set(heap, i, heap->node[child]);
+        i = child;
+    }
+    heap_set(heap, i, node);
+}
+
+static void heap_push(alarm_heap *heap, rt_uint32_t when, rt_uint16_t slot)
+{
+    alarm_node node = { when, slot };
+
+    heap_set(heap, heap->num, node);
+    heap_up(heap, heap->num++);
+}
+
+/* 删除下标 i 处的节点, 删除堆顶时 i 为 0 */
+static void heap_remove(alarm_heap *heap, rt_uint16_t i)
+{
+    rt_uint32_t when = heap->node[i].when;
+
+    if (--heap->num == i)
+        return;
+
+    heap_set(heap, i, heap->node[heap->num]);
+    if (heap->node[i].when < when)
+        heap_up(heap, i);
+    else
+        heap_down(heap, i);
+}
+
+/*---------------------------------- 调度 ------------------------------------*/
+
+static rt_uint32_t alarm_now(void)
+{
+    DS3231_Time time;
+
+#ifdef DS3231_USING_CACHE
+    DS3231_CacheGetTime(&time);
+#else
+    DS3231_GetTime(&time);
+#endif
+    return DS3231_TimeToSeconds(&time);
+}
+
+/* 设定的本地时间换算为芯片时间 */
+static rt_uint32_t alarm_utc(const DS3231_Time *time)
+{
+#ifdef DS3231_USING_TZ
+    return DS3231_TzUtc(DS3231_TimeToSeconds(time));
+#else
+    return DS3231_TimeToSeconds(time);
+#endif
+}
+
+/* 计算 after 之后的下一次响铃时刻, 没有则返回 RT_FALSE */
+static rt_bool_t alarm_next(const DS3231_AlarmConfig *config, rt_uint32_t after, rt_uint32_t *when)
+{
+    rt_uint32_t start, local, t;
+    rt_uint8_t i;
+
+    switch (config->type)
+    {
+    case DS3231_ALARM_ONCE:
+        *when = alarm_utc(&config->time);
+        return *when > after;
+
+    case DS3231_ALARM_DAILY:
+    case DS3231_ALARM_WEEKLY:
+        /* 按本地日期逐日查找, 夏令时切换当天换算后仍可能不晚于 after, 多查一天 */
+#ifdef DS3231_USING_TZ
+        local = DS3231_TzLocal(after);
+#else
+        local = after;
+#endif
+        t = local - local % 86400 +
+            config->time.hour * 3600UL + config->time.minute * 60 + config->time.second;
+        for (i = 0; i < 8; i++, t += 86400)
+        {
+            /* 2000-01-01 是星期六, bit0 为星期一 */
+            if (config->type == DS3231_ALARM_WEEKLY &&
+                !(config->weekdays & (1 << ((t / 86400 + 5) % 7))))
+                continue;
+#ifdef DS3231_USING_TZ
+            *when = DS3231_TzUtc(t);
+#else
+            *when = t;
+#endif
+            if (*when > after)
+                return RT_TRUE;
+        }
+        return RT_FALSE;
+
+    case DS3231_ALARM_INTERVAL:
+        start = alarm_utc(&config->time);
+        if (start > after)
+            *when = start;
+        else
+            *when = start + ((after - start) / config->interval + 1) * config->interval;
+        return RT_TRUE;
+
+    default:
+        return RT_FALSE;
+    }
+}
+
+/* 校时后重新计算所有重复闹钟, 单次闹钟保持原时刻, 已过期的会立即响 */
+static void alarm_rebuild(rt_uint32_t now)
+{
+    rt_uint32_t when;
+    rt_uint16_t slot;
+
+    ds3231_alarm.heap.num = 0;
+    for (slot = 0; slot < DS3231_ALARM_MAX; slot++)
+    {
+        if (!ds3231_alarm.used[slot])
+            continue;
+        if (ds3231_alarm.config[slot].type == DS3231_ALARM_ONCE)
+            when = alarm_utc(&ds3231_alarm.config[slot].time);
+        else if (!alarm_next(&ds3231_alarm.config[slot], now, &when))
+            continue;
+        heap_push(&ds3231_alarm.heap, when, slot);
+    }
+}
+
+/* 执行所有到期的闹钟, 重复闹钟先放回堆中再回调, 回调中可以删除自己 */
+static void alarm_dispatch(rt_uint32_t now)
+{
+    alarm_heap *heap = &ds3231_alarm.heap;
+    DS3231_AlarmConfig *config;
+    rt_uint32_t when;
+    rt_uint16_t slot;
+
+    while (heap->num > 0 && heap->node[0].when <= now)
+    {
+        slot = heap->node[0].slot;
+        config = &ds3231_alarm.config[slot];
+        if (now - heap->node[0].when > ds3231_alarm.stats.late)
+            ds3231_alarm.stats.late = now - heap->node[0].when;
+
+        heap_remove(heap, 0);
+        if (config->type == DS3231_ALARM_ONCE)
+            ds3231_alarm.used[slot] = RT_FALSE;
+        else if (alarm_next(config, now, &when))
+            heap_push(heap, when, slot);
+
+        ds3231_alarm.stats.fired++;
+        if (config->callback != RT_NULL)
+            config->callback(slot, config->param);
+    }
+}
+
+/* 把堆顶写入闹钟 1. 写入时已经到点则返回 RT_TRUE, 需要再执行一轮 */
+static rt_bool_t alarm_program(rt_uint32_t now)
+{
+    DS3231_Time time;
+    rt_uint32_t top;
+
+    if (ds3231_alarm.heap.num == 0)
+    {
+        ds3231_alarm.countdown = 0;
+        if (ds3231_alarm.armed)
+        {
+            DS3231_DisableAlarmIT(1);
+            ds3231_alarm.armed = RT_FALSE;
+        }
+        return RT_FALSE;
+    }
+
+    top = ds3231_alarm.heap.node[0].when;
+    if (top <= now)
+        return RT_TRUE;
+
+    if (!ds3231_alarm.armed || ds3231_alarm.programmed != top)
+    {
+        DS3231_SecondsToTime(top, &time);
+        DS3231_SetAlarm1(DS3231_A1_DateHourMinuteSecond, &time);
+        ds3231_alarm.programmed = top;
+        ds3231_alarm.stats.programs++;
+#ifndef DS3231_USING_CACHE
+        /* 使用时间缓存时引脚输出方波, 只置闹钟 1 不打开 INTCN */
+        if (!ds3231_alarm.armed)
+            DS3231_EnableAlarmIT(1);
+#endif
+        ds3231_alarm.armed = RT_TRUE;
+    }
+    ds3231_alarm.countdown = top - now;
+
+    /* 只剩 1 秒时写入可能已经错过匹配, 重读时间确认 */
+    if (top - now <= 1)
+        return top <= alarm_now();
+
+    return RT_FALSE;
+}
+
+/* 闹钟 1 回调, 在 ds3231_irq 线程中执行, A1F 已清除 */
+static void alarm_irq_callback(uint8_t flags, void *param)
+{
+    rt_sem_release(&ds3231_alarm.wake);
+}
+
+static void alarm_thread_entry(void *parameter)
+{
+    DS3231_Time time;
+    rt_uint32_t now;
+    rt_bool_t again;
+
+    while (1)
+    {
+        rt_sem_take(&ds3231_alarm.wake, RT_WAITING_FOREVER);
+        ds3231_alarm.stats.wakeups++;
+
+        do
+        {
+            DS3231_GetTime(&time);
+            now = DS3231_TimeToSeconds(&time);
+
+            rt_mutex_take(&ds3231_alarm.lock, RT_WAITING_FOREVER);
+            if (ds3231_alarm.resync)
+            {
+                ds3231_alarm.resync = RT_FALSE;
+                alarm_rebuild(now);
+            }
+            alarm_dispatch(now);
+            again = alarm_program(now);
+            rt_mutex_release(&ds3231_alarm.lock);
+        } while (again);
+    }
+}
+
+/*******************************************************************************
+* @brief    启动软件闹钟, 在 DS3231_IrqInit (及 DS3231_CacheInit) 之后调用
+* @param    None
+* @retval   RT_EOK
+*******************************************************************************/
+rt_err_t DS3231_AlarmInit(void)
+{
+    if (ds3231_alarm.inited)
+        return RT_EOK;
+
+    ds3231_alarm.heap.node = ds3231_alarm.node;
+    ds3231_alarm.heap.pos = ds3231_alarm.pos;
+    rt_mutex_init(&ds3231_alarm.lock, "alarm", RT_IPC_FLAG_FIFO);
+    rt_sem_init(&ds3231_alarm.wake, "alarm", 0, RT_IPC_FLAG_FIFO);
+
+    /* 清除上电前遗留的闹钟 1 */
+    DS3231_DisableAlarmIT(1);
+    DS3231_ReadFlags(DS3231_FLAG_A1F);
+
+    DS3231_IrqAttach(1, alarm_irq_callback, RT_NULL);
+
+    rt_thread_init(&ds3231_alarm.thread, "alarm", alarm_thread_entry, RT_NULL,
+                   alarm_stack, sizeof(alarm_stack), ALARM_THREAD_PRIORITY, ALARM_THREAD_TIMESLICE);
+    ds3231_alarm.inited = RT_TRUE;
+    rt_thread_startup(&ds3231_alarm.thread);
+
+    return RT_EOK;
+}
+
+/*******************************************************************************
+* @brief    添加闹钟
+* @param    config - 闹钟设置, 内容被复制
+* @retval   闹钟编号 >= 0, -RT_EINVAL: 设置错误或单次闹钟已过期, -RT_EFULL: 已满
+*******************************************************************************/
+int DS3231_AlarmAdd(const DS3231_AlarmConfig *config)
+{
+    rt_uint32_t when;
+    rt_uint16_t slot;
+
+    if (!ds3231_alarm.inited || config == RT_NULL || config->type > DS3231_ALARM_INTERVAL)
+        return -RT_EINVAL;
+    if (config->time.hour > 23 || config->time.minute > 59 || config->time.second > 59)
+        return -RT_EINVAL;
+    if ((config->type == DS3231_ALARM_WEEKLY && (config->weekdays & 0x7F) == 0) ||
+        (config->type == DS3231_ALARM_INTERVAL && config->interval == 0))
+        return -RT_EINVAL;
+
+    if (!alarm_next(config, alarm_now(), &when))
+        return -RT_EINVAL;
+
+    rt_mutex_take(&ds3231_alarm.lock, RT_WAITING_FOREVER);
+    for (slot = 0; slot < DS3231_ALARM_MAX; slot++)
+    {
+        if (!ds3231_alarm.used[slot])
+            break;
+    }
+    if (slot == DS3231_ALARM_MAX)
+    {
+        rt_mutex_release(&ds3231_alarm.lock);
+        return -RT_EFULL;
+    }
+    ds3231_alarm.config[slot] = *config;
+    ds3231_alarm.used[slot] = RT_TRUE;
+    heap_push(&ds3231_alarm.heap, when, slot);
+    rt_mutex_release(&ds3231_alarm.lock);
+
+    /* 由闹钟线程重新写入闹钟 1 */
+    rt_sem_release(&ds3231_alarm.wake);
+
+    return slot;
+}
+
+/*******************************************************************************
+* @brief    删除闹钟
+* @param    id - DS3231_AlarmAdd 返回的编号
+* @retval   RT_EOK, -RT_EINVAL: 编号不存在
+*******************************************************************************/
+rt_err_t DS3231_AlarmRemove(int id)
+{
+    if (!ds3231_alarm.inited || id < 0 || id >= DS3231_ALARM_MAX)
+        return -RT_EINVAL;
+
+    rt_mutex_take(&ds3231_alarm.lock, RT_WAITING_FOREVER);
+    if (!ds3231_alarm.used[id])
+    {
+        rt_mutex_release(&ds3231_alarm.lock);
+        return -RT_EINVAL;
+    }
+    heap_remove(&ds3231_alarm.heap, ds3231_alarm.pos[id]);
+    ds3231_alarm.used[id] = RT_FALSE;
+    rt_mutex_release(&ds3231_alarm.lock);
+
+    rt_sem_release(&ds3231_alarm.wake);
+
+    return RT_EOK;
+}
+
+/*******************************************************************************
+* @brief    最近要响的闹钟
+* @param    id - 输出闹钟编号, 没有闹钟时为 -1, 可以为 RT_NULL
+* @retval   响铃时刻, 秒, 没有闹钟时为 0
+*******************************************************************************/
+rt_uint32_t DS3231_AlarmNext(int *id)
+{
+    rt_uint32_t when = 0;
+    int slot = -1;
+
+    if (ds3231_alarm.inited)
+    {
+        rt_mutex_take(&ds3231_alarm.lock, RT_WAITING_FOREVER);
+        if (ds3231_alarm.heap.num > 0)
+        {
+            when = ds3231_alarm.heap.node[0].when;
+            slot = ds3231_alarm.heap.node[0].slot;
+        }
+        rt_mutex_release(&ds3231_alarm.lock);
+    }
+
+    if (id != RT_NULL)
+        *id = slot;
+
+    return when;
+}
+
+/*******************************************************************************
+* @brief    使用时间缓存时在 SQW 秒边沿中断中调用, 倒数到 0 时投递闹钟 1 事件.
+*           未使用时间缓存时闹钟 1 由 INT 引脚中断直接投递, 此函数为空
+* @param    None
+* @retval   None
+*******************************************************************************/
+void DS3231_AlarmTick(void)
+{
+#ifdef DS3231_USING_CACHE
+    if (ds3231_alarm.inited && ds3231_alarm.countdown > 0 && --ds3231_alarm.countdown == 0)
+        DS3231_IrqPost(DS3231_FLAG_A1F);
+#endif
+}
+
+/*******************************************************************************
+* @brief    芯片时间被修改后调用, 重新计算所有闹钟
+* @param    None
+* @retval   None
+*******************************************************************************/
+void DS3231_AlarmResync(void)
+{
+    if (!ds3231_alarm.inited)
+        return;
+
+    ds3231_alarm.resync = RT_TRUE;
+    rt_sem_release(&ds3231_alarm.wake);
+}
+
+/*******************************************************************************
+* @brief    获取统计
+* @param    stats - 输出
+* @retval   None
+*******************************************************************************/
+void DS3231_AlarmGetStats(DS3231_AlarmStats *stats)
+{
+    RT_ASSERT(stats != RT_NULL);
+
+    *stats = ds3231_alarm.stats;
+}
+
+/*******************************************************************************
+* @brief    打印所有闹钟和统计
+* @param    None
+* @retval   None
+*******************************************************************************/
+void DS3231_AlarmShow(void)
+{
+    DS3231_Time time;
+    DS3231_AlarmConfig *config;
+    rt_uint16_t slot;
+
+    if (!ds3231_alarm.inited)
+    {
+        rt_kprintf("alarm scheduler is not running\n");
+        return;
+    }
+
+    rt_mutex_take(&ds3231_alarm.lock, RT_WAITING_FOREVER);
+    rt_kprintf("id type     next\n");
+    for (slot = 0; slot < DS3231_ALARM_MAX; slot++)
+    {
+        if (!ds3231_alarm.used[slot])
+            continue;
+        config = &ds3231_alarm.config[slot];
+#ifdef DS3231_USING_TZ
+        DS3231_SecondsToTime(DS3231_TzLocal(ds3231_alarm.node[ds3231_alarm.pos[slot]].when), &time);
+#else
+        DS3231_SecondsToTime(ds3231_alarm.node[ds3231_alarm.pos[slot]].when, &time);
+#endif
+        rt_kprintf("%2u %-8s %02u-%02u-%02u %02u:%02u:%02u", slot, alarm_type_name[config->type],
+                   time.year, time.month, time.date, time.hour, time.minute, time.second);
+        if (config->type == DS3231_ALARM_WEEKLY)
+            rt_kprintf(" days 0x%02x", config->weekdays);
+        else if (config->type == DS3231_ALARM_INTERVAL)
+            rt_kprintf(" every %u s", config->interval);
+        rt_kprintf("%s\n", ds3231_alarm.node[0].slot == slot ? " <- alarm1" : "");
+    }
+    rt_kprintf("%u of %u alarms, wakeups: %u, fired: %u, alarm1 writes: %u, max late: %u s\n",
+               ds3231_alarm.heap.num, DS3231_ALARM_MAX, ds3231_alarm.stats.wakeups,
+               ds3231_alarm.stats.fired, ds3231_alarm.stats.programs, ds3231_alarm.stats.late);
+    rt_mutex_release(&ds3231_alarm.lock);
+}
+
+/*******************************************************************************
+* @brief    堆操作性能测试: 在独立的堆上插入 num 个随机时刻, 再全部弹出,
+*           检查弹出顺序, 并与线性查找最小值对比. 不影响正在运行的闹钟
+* @param    num - 节点数, 1 ~ 1000
+* @retval   None
+*******************************************************************************/
+void DS3231_AlarmBench(rt_uint32_t num)
+{
+    alarm_heap heap;
+    rt_uint32_t seed = 12345, last = 0, start, push, pop, churn, scan, i, j, min;
+    rt_bool_t ok = RT_TRUE;
+
+    if (num == 0 || num > ALARM_BENCH_MAX)
+    {
+        rt_kprintf("error: num must be 1 ~ %u\n", ALARM_BENCH_MAX);
+        return;
+    }
+
+    heap.node = rt_malloc(num * sizeof(alarm_node));
+    heap.pos = rt_malloc(num * sizeof(rt_uint16_t));
+    if (heap.node == RT_NULL || heap.pos == RT_NULL)
+    {
+        rt_kprintf("error: no memory\n");
+        rt_free(heap.node);
+        rt_free(heap.pos);
+        return;
+    }
+    heap.num = 0;
+    DWT_CycleInit();
+
+    /* 插入 */
+    start = DWT_CycleGet();
+    for (i = 0; i < num; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        heap_push(&heap, seed >> 8, i);
+    }
+    push = DWT_CycleGet() - start;
+
+    /* 稳态: 弹出堆顶再放回一个更晚的时刻, 相当于一个重复闹钟响一次 */
+    start = DWT_CycleGet();
+    for (i = 0; i < num; i++)
+    {
+        alarm_node node = heap.node[0];
+        heap_remove(&heap, 0);
+        heap_push(&heap, node.when + 86400, node.slot);
+    }
+    churn = DWT_CycleGet() - start;
+
+    /* 对比: 每次线性查找最小值 */
+    start = DWT_CycleGet();
+    for (i = 0, min = 0; i < num; i++)
+    {
+        for (j = 1, min = 0; j < heap.num; j++)
+        {
+            if (heap.node[j].when < heap.node[min].when)
+                min = j;
+        }
+    }
+    scan = DWT_CycleGet() - start;
+    if (min != 0)
+        ok = RT_FALSE;
+
+    /* 弹出并检查顺序 */
+    start = DWT_CycleGet();
+    for (i = 0; i < num; i++)
+    {
+        if (heap.node[0].when < last || heap.pos[heap.node[0].slot] != 0)
+            ok = RT_FALSE;
+        last = heap.node[0].when;
+        heap_remove(&heap, 0);
+    }
+    pop = DWT_CycleGet() - start;
+
+    rt_free(heap.node);
+    rt_free(heap.pos);
+
+    rt_kprintf("heap of %u: push %u, pop %u, pop+push %u cycles each\n",
+               num, push / num, pop / num, churn / num);
+    rt_kprintf("linear min scan: %u cycles each\n", scan / num);
+    rt_kprintf("order check: %s\n", ok ? "ok" : "FAILED");
+}
+
+#endif /* DS3231_USING_ALARM */
@@ -0,0 +1,60 @@
+/*******************************************************************************
+* @file    ds3231_alarm.h
+* @version 1.0
+* @brief   DS3231 软件闹钟头文件
+*******************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __DS3231_ALARM_H
+#define __DS3231_ALARM_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "ds3231.h"
+
+#ifdef DS3231_USING_ALARM
+
+/* Exported types ------------------------------------------------------------*/
+/* 闹钟回调, 在闹钟线程中执行, 可以访问 I2C, 可以增删闹钟 */
+typedef void (*DS3231_AlarmCallback)(int id, void *param);
+
+typedef struct
+{
+    rt_uint8_t type;                /* DS3231_ALARM_ONCE ~ DS3231_ALARM_INTERVAL */
+    rt_uint8_t weekdays;            /* WEEKLY: bit0 ~ bit6 对应星期一 ~ 星期日 */
+    DS3231_Time time;               /* ONCE/INTERVAL 用年月日时分秒, DAILY/WEEKLY 只用时分秒 */
+    rt_uint32_t interval;           /* INTERVAL: 重复间隔, 秒 */
+    DS3231_AlarmCallback callback;
+    void *param;
+} DS3231_AlarmConfig;
+
+typedef struct
+{
+    rt_uint32_t wakeups;            /* 闹钟线程被唤醒的次数 */
+    rt_uint32_t fired;              /* 执行的回调数 */
+    rt_uint32_t programs;           /* 写入闹钟 1 的次数 */
+    rt_uint32_t late;               /* 唤醒时最早的闹钟已过期的秒数, 最大值 */
+} DS3231_AlarmStats;
+
+/* Exported define -----------------------------------------------------------*/
+#define DS3231_ALARM_ONCE           0   /* 在指定日期时间响一次, 之后删除 */
+#define DS3231_ALARM_DAILY          1   /* 每天 */
+#define DS3231_ALARM_WEEKLY         2   /* 每周中 weekdays 指定的几天 */
+#define DS3231_ALARM_INTERVAL       3   /* 从指定日期时间开始, 每隔 interval 秒 */
+
+#define DS3231_ALARM_WORKDAYS       0x1F
+#define DS3231_ALARM_WEEKEND        0x60
+
+/* Exported functions ------------------------------------------------------- */
+rt_err_t DS3231_AlarmInit(void);
+int DS3231_AlarmAdd(const DS3231_AlarmConfig *config);
+rt_err_t DS3231_AlarmRemove(int id);
+rt_uint32_t DS3231_AlarmNext(int *id);
+void DS3231_AlarmTick(void);
+void DS3231_AlarmResync(void);
+void DS3231_AlarmGetStats(DS3231_AlarmStats *stats);
+void DS3231_AlarmShow(void);
+void DS3231_AlarmBench(rt_uint32_t num);
+
+#endif /* DS3231_USING_ALARM */
+
+#endif /* __DS3231_ALARM_H */
@@ -0,0 +1,421 @@
+/*******************************************************************************
+* @file     ds3231_cache.c
+* @version  1.0
+* @brief    DS3231 时间缓存服务
+*           启动时从芯片读取一次时间, 并把 INT/SQW 设为 1Hz 方波,
+*           之后在 SQW 下降沿 (与秒寄存器更新对齐) 中断中推进内存中的日历.
+*           读取者通过序号 (seqlock) 拷贝快照, 不访问总线, 也不关中断.
+*           对时线程在以下情况重新读取芯片:
+*             - 距上次对时超过设定的周期
+*             - 两个边沿相隔超过 1.5 秒, 说明丢失了边沿
+*             - 设置了芯片时间
+*           超过 DS3231_CACHE_TIMEOUT 没有边沿 (例如闹钟中断占用了该引脚)
+*           则缓存失效, 读取者改为直接读芯片, 边沿恢复后自动对时
+*******************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include <rtdevice.h>
+#include "ds3231_cache.h"
+#include "dwt_cycle.h"
+#include "i2c_adapter.h"
+
+#ifdef DS3231_USING_CACHE
+
+/* Private define ------------------------------------------------------------*/
+#define CACHE_THREAD_STACK      768
+#define CACHE_THREAD_PRIORITY   12
+#define CACHE_THREAD_TIMESLICE  5
+#define CACHE_SYNC_RETRY        3
+
+/* Private variables ---------------------------------------------------------*/
+static const rt_uint8_t days_in_month[12] =
+{
+    31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31
+};
+
+static struct
+{
+    volatile rt_uint32_t seq;   /* 奇数表示正在更新 */
+    DS3231_Time time;
+    volatile rt_uint32_t seconds; /* 与 time 相同, 2000-01-01 起的秒数, 单次读取即可 */
+    volatile rt_bool_t valid;
+    volatile rt_bool_t pending; /* 已请求对时 */
+    volatile rt_uint32_t edge_count;
+    rt_bool_t edge_seen;
+    rt_tick_t last_edge;
+    rt_uint32_t since_sync;     /* 距上次对时的秒数 */
+    rt_uint32_t period;
+    DS3231_CacheStats stats;
+    struct rt_semaphore sync;
+    struct rt_thread thread;
+    rt_bool_t inited;
+} ds3231_cache;
+
+ALIGN(RT_ALIGN_SIZE)
+static rt_uint8_t cache_stack[CACHE_THREAD_STACK];
+
+/* Private functions ---------------------------------------------------------*/
+
+static rt_uint8_t cache_month_days(rt_uint8_t year, rt_uint8_t month)
+{
+    if (month == 2 && (year % 4) == 0) // 2000 ~ 2099 年
+        return 29;
+    return days_in_month[(month - 1) % 12];
+}
+
+/* 推进一秒 */
+static void cache_advance(DS3231_Time *t)
+{
+    if (++t->second < 60)
+        return;
+    t->second = 0;
+    if (++t->minute < 60)
+        return;
+    t->minute = 0;
+    if (++t->hour < 24)
+        return;
+    t->hour = 0;
+    t->day = t->day % 7 + 1;
+    if (++t->date <= cache_month_days(t->year, t->month))
+        return;
+    t->date = 1;
+    if (++t->month <= 12)
+        return;
+    t->month = 1;
+    t->year = (t->year + 1) % 100;
+}
+
+/* 芯片减缓存的秒数, 只比较一天之内的时刻 */
+static rt_int32_t cache_diff(const DS3231_Time *chip, const DS3231_Time *cache)
+{
+    rt_int32_t diff;
+
+    diff = ((rt_int32_t)chip->hour * 3600 + chip->minute * 60 + chip->second) -
+           ((rt_int32_t)cache->hour * 3600 + cache->minute * 60 + cache->second);
+    if (diff > 43200)
+        diff -= 86400;
+    else if (diff < -43200)
+        diff += 86400;
+
+    return diff;
+}
+
+static void cache_request(void)
+{
+    if (!ds3231_cache.pending)
+    {
+        ds3231_cache.pending = RT_TRUE;
+        rt_sem_release(&ds3231_cache.sync);
+    }
+}
+
+/* 读取芯片时间并计时, 统计为一次总线读, 同时记下这次读用了几次 I2C 传输 */
+static void cache_bus_read(DS3231_Time *time)
+{
+    I2c_Stats before, after;
+    rt_uint32_t start;
+
+    I2c_GetStats(RT_NULL, &before);
+    start = DWT_CycleGet();
+    DS3231_GetTime(time);
+    ds3231_cache.stats.bus_us = DWT_CycleToNs(DWT_CycleGet() - start) / 1000;
+    I2c_GetStats(RT_NULL, &after);
+    ds3231_cache.stats.bus_transfers = after.transfers - before.transfers;
+    ds3231_cache.stats.bus_reads++;
+}
+
+/* 对时. 读取期间出现边沿则无法判断读到的是边沿前还是后的值, 重读 */
+static void cache_sync(void)
+{
+    DS3231_Time time;
+    rt_uint32_t count;
+    rt_base_t level;
+    rt_uint8_t retry;
+
+    for (retry = 0; retry < CACHE_SYNC_RETRY; retry++)
+    {
+        count = ds3231_cache.edge_count;
+        cache_bus_read(&time);
+
+        level = rt_hw_interrupt_disable();
+        if (count == ds3231_cache.edge_count)
+        {
+            if (ds3231_cache.valid)
+            {
+                ds3231_cache.stats.last_drift = cache_diff(&time, &ds3231_cache.time);
+                if (ds3231_cache.stats.last_drift != 0)
+                    ds3231_cache.stats.drift_events++;
+            }
+            ds3231_cache.seq++;
+            __DMB();
+            ds3231_cache.time = time;
+            ds3231_cache.seconds = DS3231_TimeToSeconds(&time);
+            __DMB();
+            ds3231_cache.seq++;
+            ds3231_cache.since_sync = 0;
+            ds3231_cache.valid = RT_TRUE;
+            ds3231_cache.pending = RT_FALSE;
+            ds3231_cache.stats.resyncs++;
+            rt_hw_interrupt_enable(level);
+            return;
+        }
+        rt_hw_interrupt_enable(level);
+    }
+
+    ds3231_cache.pending = RT_FALSE; // 下一个边沿再试
+}
+
+static void cache_thread_entry(void *parameter)
+{
+    rt_err_t ret;
+
+    while (1)
+    {
+        ret = rt_sem_take(&ds3231_cache.sync, rt_tick_from_millisecond(DS3231_CACHE_TIMEOUT));
+        if (ret == RT_EOK)
+        {
+            cache_sync();
+        }
+        else if (ds3231_cache.valid &&
+                 rt_tick_get() - ds3231_cache.last_edge > rt_tick_from_millisecond(DS3231_CACHE_TIMEOUT))
+        {
+            ds3231_cache.valid = RT_FALSE;
+            ds3231_cache.stats.lost++;
+        }
+    }
+}
+
+/*******************************************************************************
+* @brief    启动时间缓存服务: 读取一次时间, SQW 设为 1Hz, 启动对时线程.
+*           在 DS3231_Init 之后调用, SQW 引脚的下降沿中断中调用 DS3231_CacheEdge
+* @param    None
+* @retval   RT_EOK
+*******************************************************************************/
+rt_err_t DS3231_CacheInit(void)
+{
+    if (ds3231_cache.inited)
+        return RT_EOK;
+
+    DWT_CycleInit();
+    rt_sem_init(&ds3231_cache.sync, "ds_sync", 0, RT_IPC_FLAG_FIFO);
+    ds3231_cache.period = DS3231_CACHE_RESYNC;
+
+    DS3231_SetSquareWave(DS3231_SQW_1Hz);
+    cache_sync();
+    ds3231_cache.last_edge = rt_tick_get();
+
+    rt_thread_init(&ds3231_cache.thread, "ds_sync", cache_thread_entry, RT_NULL,
+                   cache_stack, sizeof(cache_stack), CACHE_THREAD_PRIORITY, CACHE_THREAD_TIMESLICE);
+    ds3231_cache.inited = RT_TRUE;
+    rt_thread_startup(&ds3231_cache.thread);
+
+    return RT_EOK;
+}
+
+/*******************************************************************************
+* @brief    SQW 下降沿中断中调用, 推进一秒
+* @param    None
+* @retval   None
+*******************************************************************************/
+void DS3231_CacheEdge(void)
+{
+    rt_tick_t now = rt_tick_get();
+    rt_tick_t interval = now - ds3231_cache.last_edge;
+
+    if (!ds3231_cache.inited)
+        return;
+
+    if (ds3231_cache.edge_seen && interval < RT_TICK_PER_SECOND / 2)
+    {
+        ds3231_cache.stats.glitches++;
+        return;
+    }
+
+    ds3231_cache.last_edge = now;
+    ds3231_cache.edge_seen = RT_TRUE;
+    ds3231_cache.edge_count++;
+    ds3231_cache.stats.edges++;
+
+    if (!ds3231_cache.valid)
+    {
+        cache_request();
+        return;
+    }
+
+    ds3231_cache.seq++;
+    __DMB();
+    cache_advance(&ds3231_cache.time);
+    ds3231_cache.seconds++;
+    __DMB();
+    ds3231_cache.seq++;
+
+    ds3231_cache.since_sync++;
+    if (interval > RT_TICK_PER_SECOND * 3 / 2 || ds3231_cache.since_sync >= ds3231_cache.period)
+        cache_request();
+}
+
+/*******************************************************************************
+* @brief    获取当前时间, 统一 24 小时制. 缓存有效时不访问总线.
+*           不要在优先级高于 SQW 引脚中断的中断中调用
+* @param    time - 指向存储当前时间的结构体
+* @retval   None
+*******************************************************************************/
+void DS3231_CacheGetTime(DS3231_Time *time)
+{
+    rt_uint32_t seq;
+
+    if (time == NULL)
+        return;
+
+    if (!ds3231_cache.valid)
+    {
+        cache_bus_read(time);
+        return;
+    }
+
+    do
+    {
+        seq = ds3231_cache.seq;
+        __DMB();
+        *time = ds3231_cache.time;
+        __DMB();
+    } while ((seq & 1) || seq != ds3231_cache.seq);
+
+    ds3231_cache.stats.reads++;
+}
+
+/*******************************************************************************
+* @brief    获取当前时钟读数(时, 分, 秒), 同 DS3231_CacheGetTime
+* @param    clock - 指向存储当前时钟读数的结构体
+* @retval   None
+*******************************************************************************/
+void DS3231_CacheGetClock(DS3231_Clock *clock)
+{
+    DS3231_Time time;
+
+    if (clock == NULL)
+        return;
+
+    DS3231_CacheGetTime(&time);
+    clock->hour = time.hour;
+    clock->minute = time.minute;
+    clock->second = time.second;
+}
+
+/*******************************************************************************
+* @brief    获取当前时间, 2000-01-01 00:00:00 起的秒数. 只读取一个字, 不需要序号,
+*           可以在任何中断中调用
+* @param    seconds - 输出
+* @retval   RT_EOK, -RT_ERROR: 缓存无效, 需要从芯片读取
+*******************************************************************************/
+rt_err_t DS3231_CacheGetSeconds(rt_uint32_t *seconds)
+{
+    if (!ds3231_cache.valid)
+        return -RT_ERROR;
+
+    *seconds = ds3231_cache.seconds;
+    ds3231_cache.stats.epoch_reads++;
+
+    return RT_EOK;
+}
+
+/*******************************************************************************
+* @brief    获取缓存的时间和它开始的秒边沿时刻, 用于毫秒级的时间戳:
+*           某时刻 tick 的芯片时间 = seconds * 1000 + (tick - edge) 毫秒
+* @param    seconds - 输出, 2000-01-01 00:00:00 起的秒数
+* @param    edge - 输出, 该秒开始时的系统节拍
+* @retval   RT_EOK, -RT_ERROR: 缓存无效, 没有秒边沿
+*******************************************************************************/
+rt_err_t DS3231_CacheGetStamp(rt_uint32_t *seconds, rt_tick_t *edge)
+{
+    rt_uint32_t seq;
+
+    if (!ds3231_cache.valid || !ds3231_cache.edge_seen)
+        return -RT_ERROR;
+
+    do
+    {
+        seq = ds3231_cache.seq;
+        __DMB();
+        *seconds = ds3231_cache.seconds;
+        *edge = ds3231_cache.last_edge;
+        __DMB();
+    } while ((seq & 1) || seq != ds3231_cache.seq);
+
+    return RT_EOK;
+}
+
+/*******************************************************************************
+* @brief    请求立即对时, 设置芯片时间后调用
+* @param    None
+* @retval   None
+*******************************************************************************/
+void DS3231_CacheResync(void)
+{
+    if (ds3231_cache.inited)
+        cache_request();
+}
+
+/*******************************************************************************
+* @brief    设置定期对时的间隔
+* @param    seconds - 间隔, 秒, 0 按 1 秒处理
+* @retval   None
+*******************************************************************************/
+void DS3231_CacheSetPeriod(rt_uint32_t seconds)
+{
+    ds3231_cache.period = seconds ? seconds : 1;
+}
+
+/*******************************************************************************
+* @brief    缓存是否有效
+* @param    None
+* @retval   RT_TRUE: 有效, 读取不访问总线
+*******************************************************************************/
+rt_bool_t DS3231_CacheValid(void)
+{
+    return ds3231_cache.valid;
+}
+
+/*******************************************************************************
+* @brief    获取统计
+* @param    stats - 输出
+* @retval   None
+*******************************************************************************/
+void DS3231_CacheGetStats(DS3231_CacheStats *stats)
+{
+    rt_base_t level;
+
+    RT_ASSERT(stats != RT_NULL);
+
+    level = rt_hw_interrupt_disable();
+    *stats = ds3231_cache.stats;
+    rt_hw_interrupt_enable(level);
+}
+
+/*******************************************************************************
+* @brief    打印缓存的时间和统计
+* @param    None
+* @retval   None
+*******************************************************************************/
+void DS3231_CacheShow(void)
+{
+    DS3231_CacheStats stats;
+    DS3231_Time time;
+
+    DS3231_CacheGetTime(&time);
+    DS3231_CacheGetStats(&stats);
+
+    rt_kprintf("cached: %02u-%02u-%02u %02u:%02u:%02u (%s)\n",
+               time.year, time.month, time.date, time.hour, time.minute, time.second,
+               ds3231_cache.valid ? "valid" : "bus");
+    rt_kprintf("edges: %u, glitches: %u, lost: %u\n", stats.edges, stats.glitches, stats.lost);
+    rt_kprintf("resyncs: %u every %u s, drift events: %u, last drift: %d s\n",
+               stats.resyncs, ds3231_cache.period, stats.drift_events, stats.last_drift);
+    rt_kprintf("reads: %u cached, %u seconds only, %u on bus (%u us, %u transfers each)\n",
+               stats.reads, stats.epoch_reads, stats.bus_reads, stats.bus_us, stats.bus_transfers);
+    rt_kprintf("saved: %u transfers, about %u ms of bus time\n",
+               stats.reads * stats.bus_transfers,
+               stats.reads / 1000 * stats.bus_us + stats.reads % 1000 * stats.bus_us / 1000);
+}
+
+#endif /* DS3231_USING_CACHE */
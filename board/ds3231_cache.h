@@ -0,0 +1,47 @@
+/*******************************************************************************
+* @file    ds3231_cache.h
+* @version 1.0
+* @brief   DS3231 时间缓存服务头文件
+*******************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __DS3231_CACHE_H
+#define __DS3231_CACHE_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "ds3231.h"
+
+#ifdef DS3231_USING_CACHE
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+    rt_uint32_t reads;          /* 从缓存读取时间的次数, 每次省去一次 7 字节的总线读 */
+    rt_uint32_t epoch_reads;    /* DS3231_CacheGetSeconds 的次数, 不计入节省的总线读 */
+    rt_uint32_t bus_reads;      /* 实际的总线读次数: 对时和缓存失效时的读取 */
+    rt_uint32_t bus_us;         /* 最近一次总线读的耗时 */
+    rt_uint32_t bus_transfers;  /* 最近一次总线读的 I2C 传输次数 */
+    rt_uint32_t edges;          /* SQW 秒边沿数 */
+    rt_uint32_t glitches;       /* 距上个边沿不足半秒而忽略的边沿 */
+    rt_uint32_t resyncs;        /* 对时次数 */
+    rt_uint32_t drift_events;   /* 对时时缓存与芯片不一致的次数 */
+    rt_int32_t last_drift;      /* 最近一次对时时芯片减缓存的秒数 */
+    rt_uint32_t lost;           /* 秒边沿中断而改为直接读取的次数 */
+} DS3231_CacheStats;
+
+/* Exported functions ------------------------------------------------------- */
+rt_err_t DS3231_CacheInit(void);
+void DS3231_CacheEdge(void);
+void DS3231_CacheGetTime(DS3231_Time *time);
+void DS3231_CacheGetClock(DS3231_Clock *clock);
+rt_err_t DS3231_CacheGetSeconds(rt_uint32_t *seconds);
+rt_err_t DS3231_CacheGetStamp(rt_uint32_t *seconds, rt_tick_t *edge);
+void DS3231_CacheResync(void);
+void DS3231_CacheSetPeriod(rt_uint32_t seconds);
+rt_bool_t DS3231_CacheValid(void);
+void DS3231_CacheGetStats(DS3231_CacheStats *stats);
+void DS3231_CacheShow(void);
+
+#endif /* DS3231_USING_CACHE */
+
+#endif /* __DS3231_CACHE_H */
@@ -0,0 +1,271 @@
+/*******************************************************************************
+* @file     ds3231_drift.c
+* @version  1.0
+* @brief    DS3231 走时误差测量与老化偏移校准
+*           主机脚本在参考时钟 (NTP 同步的电脑) 的整秒通过控制台串口发送
+*               rtc -R <unix 秒>[.毫秒]
+*           收到时用时间缓存的当前秒加上距秒边沿的毫秒数作为芯片时间,
+*           芯片减参考即偏差. 偏差随参考时间的斜率就是频率误差 (ppm).
+*           每个测量窗口结束时记录频率误差, 温度和老化偏移,
+*           开启闭环时按误差调整老化偏移 (每 LSB 约 0.1 ppm, 走快则加大),
+*           并强制一次温度转换使其立即生效, 之后重新开始测量.
+*           串口和命令解析的延迟基本固定, 在斜率中抵消
+*******************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include <rtdevice.h>
+#include "ds3231_drift.h"
+#include "ds3231_cache.h"
+
+#ifdef DS3231_USING_DRIFT
+
+/* Private variables ---------------------------------------------------------*/
+static struct
+{
+    rt_int64_t base_ref;        /* 窗口起点的参考时间, ms */
+    rt_int64_t base_offset;     /* 窗口起点的偏差, ms */
+    rt_int64_t last_offset;
+    rt_bool_t have_base;
+    rt_uint32_t window;
+    DS3231_DriftStatus status;
+    DS3231_DriftRecord log[DS3231_DRIFT_LOG_NUM];
+    rt_uint8_t log_head;
+    rt_uint8_t log_num;
+} ds3231_drift;
+
+/* Private functions ---------------------------------------------------------*/
+
+static void drift_rebase(rt_int64_t ref, rt_int64_t offset)
+{
+    ds3231_drift.base_ref = ref;
+    ds3231_drift.base_offset = offset;
+    ds3231_drift.last_offset = offset;
+    ds3231_drift.have_base = RT_TRUE;
+    ds3231_drift.status.ppm = 0;
+    ds3231_drift.status.elapsed = 0;
+}
+
+/* 窗口结束: 记录, 按需调整老化偏移 */
+static void drift_window_end(rt_uint32_t ref_seconds)
+{
+    DS3231_DriftRecord *record = &ds3231_drift.log[ds3231_drift.log_head];
+    rt_int32_t ppm = ds3231_drift.status.ppm;
+    rt_int32_t aging = DS3231_GetAging();
+    rt_int32_t step = 0;
+
+    record->time = ref_seconds;
+    record->ppm = ppm;
+    record->temperature = DS3231_GetTemperature();
+    record->aging = aging;
+
+    if (ds3231_drift.status.loop && (ppm >= DS3231_DRIFT_DEADBAND || ppm <= -DS3231_DRIFT_DEADBAND))
+    {
+        /* 四舍五入到 LSB, 限制单次调整量, 避免参考时间抖动引起振荡 */
+        step = (ppm + (ppm > 0 ? 1 : -1) * DS3231_DRIFT_PPM_PER_LSB / 2) / DS3231_DRIFT_PPM_PER_LSB;
+        if (step > DS3231_DRIFT_STEP_MAX)
+            step = DS3231_DRIFT_STEP_MAX;
+        else if (step < -DS3231_DRIFT_STEP_MAX)
+            step = -DS3231_DRIFT_STEP_MAX;
+
+        if (aging + step > 127)
+            step = 127 - aging;
+        else if (aging + step < -128)
+            step = -128 - aging;
+
+        if (step != 0)
+        {
+            DS3231_SetAging(aging + step);
+            DS3231_ConvertTemperature();
+            ds3231_drift.status.adjusts++;
+        }
+    }
+    record->step = step;
+
+    ds3231_drift.log_head = (ds3231_drift.log_head + 1) % DS3231_DRIFT_LOG_NUM;
+    if (ds3231_drift.log_num < DS3231_DRIFT_LOG_NUM)
+        ds3231_drift.log_num++;
+}
+
+/* 打印 0.01 单位的定点数 */
+static void drift_print_fixed(rt_int32_t value, rt_int32_t scale)
+{
+    rt_uint32_t mag = value < 0 ? -value : value;
+
+    rt_kprintf("%s%u.%02u", value < 0 ? "-" : "", mag / scale, mag % scale * 100 / scale);
+}
+
+/*******************************************************************************
+* @brief    输入一个参考时间, 应在参考时钟的该时刻调用
+* @param    ref_seconds - 参考时间, 2000-01-01 00:00:00 起的秒数
+* @param    ref_ms - 参考时间的毫秒部分
+* @retval   RT_EOK, -RT_ERROR: 时间缓存无效, 无法得到毫秒相位
+*******************************************************************************/
+rt_err_t DS3231_DriftSample(rt_uint32_t ref_seconds, rt_uint16_t ref_ms)
+{
+    DS3231_DriftStatus *status = &ds3231_drift.status;
+    rt_tick_t now = rt_tick_get();
+    rt_tick_t edge, phase;
+    rt_uint32_t seconds;
+    rt_int64_t chip, ref, offset, elapsed;
+
+    if (DS3231_CacheGetStamp(&seconds, &edge) != RT_EOK)
+        return -RT_ERROR;
+    phase = now - edge;
+    if (phase >= RT_TICK_PER_SECOND * 2)
+        return -RT_ERROR;
+
+    chip = (rt_int64_t)seconds * 1000 + phase * 1000 / RT_TICK_PER_SECOND;
+    ref = (rt_int64_t)ref_seconds * 1000 + ref_ms;
+    offset = chip - ref;
+
+    status->samples++;
+    if (offset > 0x7FFFFFFF)
+        status->offset = 0x7FFFFFFF;
+    else if (offset < -0x7FFFFFFF)
+        status->offset = -0x7FFFFFFF;
+    else
+        status->offset = (rt_int32_t)offset;
+
+    if (ds3231_drift.window == 0)
+        ds3231_drift.window = DS3231_DRIFT_WINDOW;
+
+    /* 第一次, 参考时间倒退, 或芯片时间被修改 */
+    if (!ds3231_drift.have_base || ref <= ds3231_drift.base_ref ||
+        offset - ds3231_drift.last_offset > DS3231_DRIFT_JUMP_MS ||
+        ds3231_drift.last_offset - offset > DS3231_DRIFT_JUMP_MS)
+    {
+        if (ds3231_drift.have_base)
+            status->rebases++;
+        drift_rebase(ref, offset);
+        return RT_EOK;
+    }
+    ds3231_drift.last_offset = offset;
+
+    /* 斜率: 偏差变化 / 参考时间变化, 单位 0.01 ppm */
+    elapsed = ref - ds3231_drift.base_ref;
+    status->elapsed = (rt_uint32_t)(elapsed / 1000);
+    status->ppm = (rt_int32_t)((offset - ds3231_drift.base_offset) * 100000000 / elapsed);
+
+    if (status->elapsed >= ds3231_drift.window)
+    {
+        drift_window_end(ref_seconds);
+        drift_rebase(ref, offset);
+    }
+
+    return RT_EOK;
+}
+
+/*******************************************************************************
+* @brief    开关闭环: 每个窗口结束时按测得的误差调整老化偏移
+* @param    enable - RT_TRUE 开启
+* @retval   None
+*******************************************************************************/
+void DS3231_DriftLoop(rt_bool_t enable)
+{
+    ds3231_drift.status.loop = enable;
+}
+
+/*******************************************************************************
+* @brief    设置测量窗口, 窗口越长 ppm 分辨率越高: 1ms 的抖动在 1 小时内约 0.3 ppm
+* @param    seconds - 窗口, 秒, 0 使用 DS3231_DRIFT_WINDOW
+* @retval   None
+*******************************************************************************/
+void DS3231_DriftSetWindow(rt_uint32_t seconds)
+{
+    ds3231_drift.window = seconds ? seconds : DS3231_DRIFT_WINDOW;
+}
+
+/*******************************************************************************
+* @brief    丢弃当前窗口和记录, 下一个参考时间重新开始测量
+* @param    None
+* @retval   None
+*******************************************************************************/
+void DS3231_DriftReset(void)
+{
+    rt_bool_t loop = ds3231_drift.status.loop;
+
+    ds3231_drift.have_base = RT_FALSE;
+    ds3231_drift.log_head = 0;
+    ds3231_drift.log_num = 0;
+    rt_memset(&ds3231_drift.status, 0, sizeof(ds3231_drift.status));
+    ds3231_drift.status.loop = loop;
+}
+
+/*******************************************************************************
+* @brief    获取当前状态
+* @param    status - 输出
+* @retval   None
+*******************************************************************************/
+void DS3231_DriftGetStatus(DS3231_DriftStatus *status)
+{
+    RT_ASSERT(status != RT_NULL);
+
+    *status = ds3231_drift.status;
+}
+
+/*******************************************************************************
+* @brief    获取窗口记录, 最新的在前
+* @param    records - 输出
+* @param    num - records 的大小
+* @retval   实际的条数
+*******************************************************************************/
+rt_uint8_t DS3231_DriftGetLog(DS3231_DriftRecord records[], rt_uint8_t num)
+{
+    rt_uint8_t i, index;
+
+    if (num > ds3231_drift.log_num)
+        num = ds3231_drift.log_num;
+
+    index = ds3231_drift.log_head;
+    for (i = 0; i < num; i++)
+    {
+        index = (index + DS3231_DRIFT_LOG_NUM - 1) % DS3231_DRIFT_LOG_NUM;
+        records[i] = ds3231_drift.log[index];
+    }
+
+    return num;
+}
+
+/*******************************************************************************
+* @brief    打印当前测量, 温度, 老化偏移和窗口记录
+* @param    None
+* @retval   None
+*******************************************************************************/
+void DS3231_DriftShow(void)
+{
+    DS3231_DriftStatus *status = &ds3231_drift.status;
+    DS3231_DriftRecord *record;
+    DS3231_Time time;
+    rt_uint8_t i, index;
+
+    rt_kprintf("samples: %u, offset: %d ms, window: %u / %u s, error: ",
+               status->samples, status->offset, status->elapsed,
+               ds3231_drift.window ? ds3231_drift.window : DS3231_DRIFT_WINDOW);
+    drift_print_fixed(status->ppm, 100);
+    rt_kprintf(" ppm\n");
+
+    rt_kprintf("aging: %d, temperature: ", DS3231_GetAging());
+    drift_print_fixed(DS3231_GetTemperature(), DS3231_TEMP_SCALE);
+    rt_kprintf(" C, loop: %s, adjusts: %u, rebases: %u\n",
+               status->loop ? "on" : "off", status->adjusts, status->rebases);
+
+    if (ds3231_drift.log_num == 0)
+        return;
+
+    rt_kprintf("reference time      error(ppm)  temp(C)  aging  step\n");
+    index = ds3231_drift.log_head;
+    for (i = 0; i < ds3231_drift.log_num; i++)
+    {
+        index = (index + DS3231_DRIFT_LOG_NUM - 1) % DS3231_DRIFT_LOG_NUM;
+        record = &ds3231_drift.log[index];
+        DS3231_SecondsToTime(record->time, &time);
+        rt_kprintf("%02u-%02u-%02u %02u:%02u:%02u  ", time.year, time.month, time.date,
+                   time.hour, time.minute, time.second);
+        drift_print_fixed(record->ppm, 100);
+        rt_kprintf("  ");
+        drift_print_fixed(record->temperature, DS3231_TEMP_SCALE);
+        rt_kprintf("  %d  %d\n", record->aging, record->step);
+    }
+}
+
+#endif /* DS3231_USING_DRIFT */
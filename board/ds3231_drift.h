@@ -0,0 +1,60 @@
+/*******************************************************************************
+* @file    ds3231_drift.h
+* @version 1.0
+* @brief   DS3231 走时误差测量与老化偏移校准头文件
+*******************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __DS3231_DRIFT_H
+#define __DS3231_DRIFT_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "ds3231.h"
+
+#ifdef DS3231_USING_DRIFT
+
+#ifndef DS3231_USING_CACHE
+#error "DS3231_USING_DRIFT requires DS3231_USING_CACHE"
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+/* 每个测量窗口结束时的一条记录 */
+typedef struct
+{
+    rt_uint32_t time;           /* 参考时间, 2000-01-01 起的秒数 */
+    rt_int32_t ppm;             /* 窗口内的频率误差, 0.01 ppm, 正值为走快 */
+    rt_int16_t temperature;     /* 0.25 ℃ */
+    rt_int8_t aging;            /* 窗口内使用的老化偏移 */
+    rt_int8_t step;             /* 窗口结束时对老化偏移的调整 */
+} DS3231_DriftRecord;
+
+typedef struct
+{
+    rt_uint32_t samples;        /* 收到的参考时间数 */
+    rt_uint32_t rebases;        /* 时间跳变后重新开始测量的次数 */
+    rt_uint32_t adjusts;        /* 调整老化偏移的次数 */
+    rt_int32_t offset;          /* 最近一次芯片减参考时间, ms */
+    rt_int32_t ppm;             /* 当前窗口的频率误差估计, 0.01 ppm */
+    rt_uint32_t elapsed;        /* 当前窗口已经过的秒数 */
+    rt_bool_t loop;             /* 是否自动调整老化偏移 */
+} DS3231_DriftStatus;
+
+/* Exported define -----------------------------------------------------------*/
+#define DS3231_DRIFT_LOG_NUM        24      /* 记录条数 */
+#define DS3231_DRIFT_DEADBAND       10      /* 小于 0.1 ppm 不调整 */
+#define DS3231_DRIFT_STEP_MAX       8       /* 每个窗口老化偏移最多调整的 LSB */
+#define DS3231_DRIFT_PPM_PER_LSB    10      /* 老化偏移每 LSB 约 0.1 ppm */
+#define DS3231_DRIFT_JUMP_MS        1000    /* 偏差跳变超过此值视为时间被修改 */
+
+/* Exported functions ------------------------------------------------------- */
+rt_err_t DS3231_DriftSample(rt_uint32_t ref_seconds, rt_uint16_t ref_ms);
+void DS3231_DriftLoop(rt_bool_t enable);
+void DS3231_DriftSetWindow(rt_uint32_t seconds);
+void DS3231_DriftReset(void);
+void DS3231_DriftGetStatus(DS3231_DriftStatus *status);
+rt_uint8_t DS3231_DriftGetLog(DS3231_DriftRecord records[], rt_uint8_t num);
+void DS3231_DriftShow(void);
+
+#endif /* DS3231_USING_DRIFT */
+
+#endif /* __DS3231_DRIFT_H */
@@ -0,0 +1,254 @@
+/*******************************************************************************
+* @file     ds3231_irq.c
+* @version  1.0
+* @brief    DS3231 闹钟中断延迟处理
+*           引脚中断中只记录时间戳并投递到预先分配的消息队列, 不访问 I2C,
+*           也不打印. 处理线程用一次读-改-写同时清除 A1F 和 A2F,
+*           再调用注册的回调, 并统计中断到处理线程的延迟
+*******************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include <rtdevice.h>
+#include "ds3231_irq.h"
+#include "dwt_cycle.h"
+
+/* Private define ------------------------------------------------------------*/
+#define IRQ_THREAD_STACK        1024
+#define IRQ_THREAD_PRIORITY     9
+#define IRQ_THREAD_TIMESLICE    5
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+    rt_uint32_t stamp;          /* 中断时的 DWT 周期计数 */
+    rt_uint8_t flags;           /* 投递时已知的标志, 引脚中断为 0 */
+} irq_event;
+
+typedef struct
+{
+    DS3231_IrqCallback callback;
+    void *param;
+} irq_handler;
+
+/* Private variables ---------------------------------------------------------*/
+static struct
+{
+    irq_handler handler[2][DS3231_IRQ_CALLBACK_NUM];
+    DS3231_IrqStats stats;
+    struct rt_messagequeue queue;
+    struct rt_mutex lock;
+    struct rt_thread thread;
+    rt_bool_t inited;
+} ds3231_irq;
+
+/* 每条消息另有一个指针的链表头 */
+ALIGN(RT_ALIGN_SIZE)
+static rt_uint8_t irq_pool[DS3231_IRQ_QUEUE_NUM *
+                           (RT_ALIGN(sizeof(irq_event), RT_ALIGN_SIZE) + sizeof(void *))];
+
+ALIGN(RT_ALIGN_SIZE)
+static rt_uint8_t irq_stack[IRQ_THREAD_STACK];
+
+/* Private functions ---------------------------------------------------------*/
+
+static void irq_latency(rt_uint32_t stamp)
+{
+    DS3231_IrqStats *stats = &ds3231_irq.stats;
+    rt_uint32_t us = DWT_CycleToNs(DWT_CycleGet() - stamp) / 1000;
+
+    stats->latency_last = us;
+    if (stats->handled++ == 0 || us < stats->latency_min)
+        stats->latency_min = us;
+    if (us > stats->latency_max)
+        stats->latency_max = us;
+    stats->latency_sum += us;
+}
+
+static void irq_dispatch(uint8_t alarm, uint8_t flags)
+{
+    irq_handler *handler = ds3231_irq.handler[alarm];
+    rt_uint8_t i;
+
+    for (i = 0; i < DS3231_IRQ_CALLBACK_NUM; i++)
+    {
+        if (handler[i].callback != RT_NULL)
+            handler[i].callback(flags, handler[i].param);
+    }
+}
+
+static void irq_thread_entry(void *parameter)
+{
+    irq_event event;
+    uint8_t flags;
+
+    while (1)
+    {
+        if (rt_mq_recv(&ds3231_irq.queue, &event, sizeof(event), RT_WAITING_FOREVER) != RT_EOK)
+            continue;
+
+        irq_latency(event.stamp);
+
+        /* 一次读取状态寄存器, 同时清除两个闹钟标志 */
+        flags = DS3231_ReadFlags(DS3231_FLAG_A1F | DS3231_FLAG_A2F);
+        flags = (flags | event.flags) & (DS3231_FLAG_A1F | DS3231_FLAG_A2F);
+
+        if (flags == 0)
+        {
+            ds3231_irq.stats.spurious++;
+            continue;
+        }
+
+        rt_mutex_take(&ds3231_irq.lock, RT_WAITING_FOREVER);
+        if (flags & DS3231_FLAG_A1F)
+        {
+            ds3231_irq.stats.alarm1++;
+            irq_dispatch(0, flags);
+        }
+        if (flags & DS3231_FLAG_A2F)
+        {
+            ds3231_irq.stats.alarm2++;
+            irq_dispatch(1, flags);
+        }
+        rt_mutex_release(&ds3231_irq.lock);
+    }
+}
+
+/*******************************************************************************
+* @brief    启动闹钟中断处理线程, 在 DS3231_Init 之后, 使能引脚中断之前调用
+* @param    None
+* @retval   RT_EOK
+*******************************************************************************/
+rt_err_t DS3231_IrqInit(void)
+{
+    if (ds3231_irq.inited)
+        return RT_EOK;
+
+    DWT_CycleInit();
+    rt_mutex_init(&ds3231_irq.lock, "ds_irq", RT_IPC_FLAG_FIFO);
+    rt_mq_init(&ds3231_irq.queue, "ds_irq", irq_pool, sizeof(irq_event),
+               sizeof(irq_pool), RT_IPC_FLAG_FIFO);
+
+    rt_thread_init(&ds3231_irq.thread, "ds_irq", irq_thread_entry, RT_NULL,
+                   irq_stack, sizeof(irq_stack), IRQ_THREAD_PRIORITY, IRQ_THREAD_TIMESLICE);
+    ds3231_irq.inited = RT_TRUE;
+    rt_thread_startup(&ds3231_irq.thread);
+
+    return RT_EOK;
+}
+
+/*******************************************************************************
+* @brief    在中断中调用, 投递一个闹钟事件, 不访问 I2C
+* @param    flags - 已知的闹钟标志, 例如软件倒数到期时为 DS3231_FLAG_A1F,
+*           引脚闹钟中断为 0, 由处理线程读取状态寄存器
+* @retval   None
+*******************************************************************************/
+void DS3231_IrqPost(uint8_t flags)
+{
+    irq_event event;
+
+    if (!ds3231_irq.inited)
+        return;
+
+    event.stamp = DWT_CycleGet();
+    event.flags = flags;
+    ds3231_irq.stats.events++;
+    if (rt_mq_send(&ds3231_irq.queue, &event, sizeof(event)) != RT_EOK)
+        ds3231_irq.stats.dropped++;
+}
+
+/*******************************************************************************
+* @brief    注册闹钟回调
+* @param    alarm - 闹钟 1 or 2
+* @param    callback - 回调, 在处理线程中执行, 可以访问 I2C
+* @param    param - 回调参数
+* @retval   RT_EOK, -RT_EINVAL: 参数错误, -RT_EFULL: 回调已满
+*******************************************************************************/
+rt_err_t DS3231_IrqAttach(uint8_t alarm, DS3231_IrqCallback callback, void *param)
+{
+    irq_handler *handler;
+    rt_uint8_t i;
+
+    if ((alarm != 1 && alarm != 2) || callback == RT_NULL || !ds3231_irq.inited)
+        return -RT_EINVAL;
+
+    handler = ds3231_irq.handler[alarm - 1];
+    rt_mutex_take(&ds3231_irq.lock, RT_WAITING_FOREVER);
+    for (i = 0; i < DS3231_IRQ_CALLBACK_NUM; i++)
+    {
+        if (handler[i].callback == RT_NULL)
+        {
+            handler[i].param = param;
+            handler[i].callback = callback;
+            break;
+        }
+    }
+    rt_mutex_release(&ds3231_irq.lock);
+
+    return (i < DS3231_IRQ_CALLBACK_NUM) ? RT_EOK : -RT_EFULL;
+}
+
+/*******************************************************************************
+* @brief    注销闹钟回调
+* @param    alarm - 闹钟 1 or 2
+* @param    callback - 注册时的回调
+* @retval   RT_EOK, -RT_EINVAL: 没有注册
+*******************************************************************************/
+rt_err_t DS3231_IrqDetach(uint8_t alarm, DS3231_IrqCallback callback)
+{
+    irq_handler *handler;
+    rt_uint8_t i;
+
+    if ((alarm != 1 && alarm != 2) || !ds3231_irq.inited)
+        return -RT_EINVAL;
+
+    handler = ds3231_irq.handler[alarm - 1];
+    rt_mutex_take(&ds3231_irq.lock, RT_WAITING_FOREVER);
+    for (i = 0; i < DS3231_IRQ_CALLBACK_NUM; i++)
+    {
+        if (handler[i].callback == callback)
+        {
+            handler[i].callback = RT_NULL;
+            break;
+        }
+    }
+    rt_mutex_release(&ds3231_irq.lock);
+
+    return (i < DS3231_IRQ_CALLBACK_NUM) ? RT_EOK : -RT_EINVAL;
+}
+
+/*******************************************************************************
+* @brief    获取统计
+* @param    stats - 输出
+* @retval   None
+*******************************************************************************/
+void DS3231_IrqGetStats(DS3231_IrqStats *stats)
+{
+    rt_base_t level;
+
+    RT_ASSERT(stats != RT_NULL);
+
+    level = rt_hw_interrupt_disable();
+    *stats = ds3231_irq.stats;
+    rt_hw_interrupt_enable(level);
+}
+
+/*******************************************************************************
+* @brief    打印统计
+* @param    None
+* @retval   None
+*******************************************************************************/
+void DS3231_IrqShow(void)
+{
+    DS3231_IrqStats stats;
+
+    DS3231_IrqGetStats(&stats);
+
+    rt_kprintf("irq events: %u, dropped: %u, alarm1: %u, alarm2: %u, spurious: %u\n",
+               stats.events, stats.dropped, stats.alarm1, stats.alarm2, stats.spurious);
+    if (stats.handled > 0)
+    {
+        rt_kprintf("latency: last %u us, min %u us, max %u us, avg %u us\n",
+                   stats.latency_last, stats.latency_min, stats.latency_max,
+                   stats.latency_sum / stats.handled);
+    }
+}
@@ -0,0 +1,44 @@
+/*******************************************************************************
+* @file    ds3231_irq.h
+* @version 1.0
+* @brief   DS3231 闹钟中断延迟处理头文件
+*******************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __DS3231_IRQ_H
+#define __DS3231_IRQ_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "ds3231.h"
+
+/* Exported types ------------------------------------------------------------*/
+/* 闹钟回调, 在处理线程中执行, flags 为本次清除的 DS3231_FLAG_A1F/A2F */
+typedef void (*DS3231_IrqCallback)(uint8_t flags, void *param);
+
+typedef struct
+{
+    rt_uint32_t events;         /* 中断投递的事件数 */
+    rt_uint32_t dropped;        /* 队列满丢弃的事件数 */
+    rt_uint32_t handled;        /* 处理线程处理的事件数 */
+    rt_uint32_t alarm1;         /* 闹钟 1 次数 */
+    rt_uint32_t alarm2;         /* 闹钟 2 次数 */
+    rt_uint32_t spurious;       /* 没有读到闹钟标志的事件数 */
+    rt_uint32_t latency_last;   /* 中断到处理线程的延迟, us */
+    rt_uint32_t latency_min;
+    rt_uint32_t latency_max;
+    rt_uint32_t latency_sum;
+} DS3231_IrqStats;
+
+/* Exported define -----------------------------------------------------------*/
+#define DS3231_IRQ_QUEUE_NUM        4   /* 事件队列深度 */
+#define DS3231_IRQ_CALLBACK_NUM     4   /* 每个闹钟可注册的回调数 */
+
+/* Exported functions ------------------------------------------------------- */
+rt_err_t DS3231_IrqInit(void);
+void DS3231_IrqPost(uint8_t flags);
+rt_err_t DS3231_IrqAttach(uint8_t alarm, DS3231_IrqCallback callback, void *param);
+rt_err_t DS3231_IrqDetach(uint8_t alarm, DS3231_IrqCallback callback);
+void DS3231_IrqGetStats(DS3231_IrqStats *stats);
+void DS3231_IrqShow(void);
+
+#endif /* __DS3231_IRQ_H */
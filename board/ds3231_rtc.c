@@ -0,0 +1,123 @@
+/*******************************************************************************
+* @file     ds3231_rtc.c
+* @version  1.0
+* @brief    DS3231 注册为 RT-Thread rtc 设备
+*           libc 的 time(), stime() 以及 date, set_date, set_time 命令通过
+*           RT_DEVICE_CTRL_RTC_GET_TIME / SET_TIME 访问本设备.
+*           芯片时间按 UTC 换算为 unix 时间. 时间缓存有效时读取只是一次内存读,
+*           不访问 I2C, 否则读取芯片并用查表的日历换算
+*******************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include <rtdevice.h>
+#include "ds3231_rtc.h"
+#ifdef DS3231_USING_CACHE
+#include "ds3231_cache.h"
+#endif
+
+#ifdef DS3231_USING_RTC
+
+/* Private variables ---------------------------------------------------------*/
+static struct rt_device ds3231_rtc;
+
+/* Private functions ---------------------------------------------------------*/
+
+static rt_err_t ds3231_rtc_control(rt_device_t dev, int cmd, void *args)
+{
+    RT_ASSERT(args != RT_NULL);
+
+    switch (cmd)
+    {
+    case RT_DEVICE_CTRL_RTC_GET_TIME:
+        *(time_t *)args = DS3231_GetEpoch();
+        return RT_EOK;
+
+    case RT_DEVICE_CTRL_RTC_SET_TIME:
+        return DS3231_SetEpoch(*(time_t *)args);
+
+    default:
+        return -RT_ERROR;
+    }
+}
+
+#ifdef RT_USING_DEVICE_OPS
+const static struct rt_device_ops ds3231_rtc_ops =
+{
+    RT_NULL,
+    RT_NULL,
+    RT_NULL,
+    RT_NULL,
+    RT_NULL,
+    ds3231_rtc_control
+};
+#endif
+
+/*******************************************************************************
+* @brief    注册 rtc 设备, 在 DS3231_Init (及 DS3231_CacheInit) 之后调用
+* @param    None
+* @retval   RT_EOK, -RT_ERROR: 注册失败
+*******************************************************************************/
+rt_err_t DS3231_RtcInit(void)
+{
+    rt_err_t ret;
+
+    if (rt_device_find(DS3231_RTC_NAME) != RT_NULL)
+        return RT_EOK;
+
+    ds3231_rtc.type = RT_Device_Class_RTC;
+#ifdef RT_USING_DEVICE_OPS
+    ds3231_rtc.ops = &ds3231_rtc_ops;
+#else
+    ds3231_rtc.init = RT_NULL;
+    ds3231_rtc.open = RT_NULL;
+    ds3231_rtc.close = RT_NULL;
+    ds3231_rtc.read = RT_NULL;
+    ds3231_rtc.write = RT_NULL;
+    ds3231_rtc.control = ds3231_rtc_control;
+#endif
+    ds3231_rtc.user_data = RT_NULL;
+
+    ret = rt_device_register(&ds3231_rtc, DS3231_RTC_NAME, RT_DEVICE_FLAG_RDWR);
+    if (ret != RT_EOK)
+        rt_kprintf("[%d]%s(): can't register device\n", __LINE__, __func__);
+
+    return ret;
+}
+
+/*******************************************************************************
+* @brief    获取 unix 时间
+* @param    None
+* @retval   1970-01-01 00:00:00 起的秒数
+*******************************************************************************/
+time_t DS3231_GetEpoch(void)
+{
+    DS3231_Time time;
+#ifdef DS3231_USING_CACHE
+    rt_uint32_t seconds;
+
+    if (DS3231_CacheGetSeconds(&seconds) == RT_EOK)
+        return (time_t)seconds + DS3231_EPOCH_2000;
+#endif
+
+    DS3231_GetTime(&time);
+    return (time_t)DS3231_TimeToSeconds(&time) + DS3231_EPOCH_2000;
+}
+
+/*******************************************************************************
+* @brief    设置 unix 时间, 同时写入星期
+* @param    epoch - 1970-01-01 00:00:00 起的秒数, 限 2000 ~ 2099 年
+* @retval   RT_EOK, -RT_EINVAL: 超出芯片范围, -RT_ERROR: 写入失败
+*******************************************************************************/
+rt_err_t DS3231_SetEpoch(time_t epoch)
+{
+    DS3231_Time time;
+
+    if (epoch < (time_t)DS3231_EPOCH_2000 || (rt_uint64_t)epoch >= DS3231_EPOCH_2100)
+        return -RT_EINVAL;
+
+    DS3231_SecondsToTime((rt_uint32_t)(epoch - DS3231_EPOCH_2000), &time);
+
+    return DS3231_SetTime(&time);
+}
+
+#endif /* DS3231_USING_RTC */
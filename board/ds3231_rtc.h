@@ -0,0 +1,29 @@
+/*******************************************************************************
+* @file    ds3231_rtc.h
+* @version 1.0
+* @brief   DS3231 注册为 RT-Thread rtc 设备头文件
+*******************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __DS3231_RTC_H
+#define __DS3231_RTC_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <time.h>
+#include "ds3231.h"
+
+#ifdef DS3231_USING_RTC
+
+/* Exported define -----------------------------------------------------------*/
+#define DS3231_RTC_NAME             "rtc"
+#define DS3231_EPOCH_2000           946684800UL     /* 2000-01-01 00:00:00 的 unix 时间 */
+#define DS3231_EPOCH_2100           4102444800ULL   /* 芯片能表示的上限 */
+
+/* Exported functions ------------------------------------------------------- */
+rt_err_t DS3231_RtcInit(void);
+time_t DS3231_GetEpoch(void);
+rt_err_t DS3231_SetEpoch(time_t epoch);
+
+#endif /* DS3231_USING_RTC */
+
+#endif /* __DS3231_RTC_H */
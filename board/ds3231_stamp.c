@@ -0,0 +1,280 @@
+/*******************************************************************************
+* @file     ds3231_stamp.c
+* @version  1.0
+* @brief    DS3231 32kHz 高分辨率时间戳
+*           32kHz 引脚接 PA0 (TIM8_ETR), TIM8 工作在外部时钟模式 2, 对其计数.
+*           SQW (1Hz) 接 PC9, 既是秒边沿的外部中断, 也是 TIM8_CH4 的输入,
+*           下降沿由硬件把计数值锁存到 CCR4, 与中断延迟无关.
+*           时间戳 = 秒边沿对应的秒数 + (当前计数 - 锁存值) / 32768,
+*           分辨率约 30.5us, 以 RTC 晶振为基准, 不受 SysTick 漂移影响.
+*           秒边沿中断同时记录 DWT 周期数, 按窗口统计 CPU (HSE) 时钟的误差
+*******************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include <board.h>
+#include "ds3231_stamp.h"
+#include "ds3231_cache.h"
+#include "ds3231_tz.h"
+#include "dwt_cycle.h"
+
+#ifdef DS3231_USING_STAMP
+
+/* Private variables ---------------------------------------------------------*/
+static TIM_HandleTypeDef htim8;
+
+static struct
+{
+    rt_uint16_t ccr;            /* 最近一个秒边沿锁存的计数 */
+    rt_uint32_t seconds;        /* 该秒边沿开始的秒 */
+    rt_tick_t tick;             /* 该秒边沿的系统节拍 */
+    rt_bool_t valid;
+    rt_uint32_t last_cycles;
+    rt_uint64_t hse_cycles;     /* 当前窗口累计的 CPU 周期 */
+    rt_uint32_t hse_count;      /* 当前窗口累计的秒数 */
+    DS3231_StampStats stats;
+    rt_bool_t inited;
+} ds3231_stamp;
+
+/* Private functions ---------------------------------------------------------*/
+
+/* 窗口内每秒的 CPU 周期数与标称值比较 */
+static void stamp_hse(rt_uint32_t cycles, rt_bool_t good)
+{
+    rt_uint64_t nominal;
+
+    if (!good || !ds3231_stamp.valid)
+    {
+        ds3231_stamp.hse_cycles = 0;
+        ds3231_stamp.hse_count = 0;
+        ds3231_stamp.last_cycles = cycles;
+        return;
+    }
+
+    ds3231_stamp.hse_cycles += cycles - ds3231_stamp.last_cycles;
+    ds3231_stamp.last_cycles = cycles;
+    if (++ds3231_stamp.hse_count < DS3231_STAMP_HSE_WINDOW)
+        return;
+
+    nominal = (rt_uint64_t)SystemCoreClock * DS3231_STAMP_HSE_WINDOW;
+    ds3231_stamp.stats.hse_hz = (rt_uint32_t)(ds3231_stamp.hse_cycles / DS3231_STAMP_HSE_WINDOW);
+    ds3231_stamp.stats.hse_ppm = (rt_int32_t)(((rt_int64_t)ds3231_stamp.hse_cycles - (rt_int64_t)nominal) *
+                                              100000000 / (rt_int64_t)nominal);
+    ds3231_stamp.stats.hse_windows++;
+    ds3231_stamp.hse_cycles = 0;
+    ds3231_stamp.hse_count = 0;
+}
+
+/*******************************************************************************
+* @brief    打开 32kHz 输出, 配置 TIM8 计数并在 SQW 下降沿锁存.
+*           在 DS3231_CacheInit 之后调用
+* @param    None
+* @retval   RT_EOK, -RT_ERROR: 定时器初始化失败
+*******************************************************************************/
+rt_err_t DS3231_StampInit(void)
+{
+    TIM_ClockConfigTypeDef clock = {0};
+    TIM_IC_InitTypeDef capture = {0};
+
+    if (ds3231_stamp.inited)
+        return RT_EOK;
+
+    DS3231_Enable32kHz(RT_TRUE);
+    DWT_CycleInit();
+
+    htim8.Instance = TIM8;
+    htim8.Init.Prescaler = 0;
+    htim8.Init.CounterMode = TIM_COUNTERMODE_UP;
+    htim8.Init.Period = 0xFFFF;
+    htim8.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+    htim8.Init.RepetitionCounter = 0;
+    htim8.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_DISABLE;
+    if (HAL_TIM_Base_Init(&htim8) != HAL_OK)
+        goto _error;
+
+    /* 外部时钟模式 2: ETR 上升沿计数 */
+    clock.ClockSource = TIM_CLOCKSOURCE_ETRMODE2;
+    clock.ClockPolarity = TIM_CLOCKPOLARITY_NONINVERTED;
+    clock.ClockPrescaler = TIM_CLOCKPRESCALER_DIV1;
+    clock.ClockFilter = 0;
+    if (HAL_TIM_ConfigClockSource(&htim8, &clock) != HAL_OK)
+        goto _error;
+
+    /* CH4 在 SQW 下降沿锁存, 与秒寄存器更新对齐 */
+    capture.ICPolarity = TIM_ICPOLARITY_FALLING;
+    capture.ICSelection = TIM_ICSELECTION_DIRECTTI;
+    capture.ICPrescaler = TIM_ICPSC_DIV1;
+    capture.ICFilter = 0x3;
+    if (HAL_TIM_IC_Init(&htim8) != HAL_OK ||
+        HAL_TIM_IC_ConfigChannel(&htim8, &capture, TIM_CHANNEL_4) != HAL_OK)
+        goto _error;
+
+    HAL_TIM_Base_Start(&htim8);
+    HAL_TIM_IC_Start(&htim8, TIM_CHANNEL_4);
+    ds3231_stamp.inited = RT_TRUE;
+
+    return RT_EOK;
+
+_error:
+    rt_kprintf("[%d]%s(): can't init TIM8\n", __LINE__, __func__);
+    return -RT_ERROR;
+}
+
+/*******************************************************************************
+* @brief    SQW 下降沿中断中调用, 在 DS3231_CacheEdge 之后. 取出硬件锁存的计数
+* @param    None
+* @retval   None
+*******************************************************************************/
+void DS3231_StampEdge(void)
+{
+    rt_uint32_t cycles = DWT_CycleGet();
+    rt_uint32_t seconds;
+    rt_uint16_t ccr, count;
+    rt_tick_t tick;
+    rt_bool_t good;
+
+    if (!ds3231_stamp.inited)
+        return;
+
+    if (!(TIM8->SR & TIM_SR_CC4IF))
+    {
+        ds3231_stamp.stats.missed++;
+        ds3231_stamp.valid = RT_FALSE;
+        return;
+    }
+    ccr = TIM8->CCR4; // 读取同时清除 CC4IF
+    TIM8->SR = ~TIM_SR_CC4OF;
+
+    /* 两次锁存之间应为 32768 个计数, 同一晶振, 只有同步误差 */
+    count = ccr - ds3231_stamp.ccr;
+    good = count >= DS3231_STAMP_HZ - DS3231_STAMP_TOLERANCE &&
+           count <= DS3231_STAMP_HZ + DS3231_STAMP_TOLERANCE;
+    if (ds3231_stamp.valid && !good)
+        ds3231_stamp.stats.bad++;
+
+    stamp_hse(cycles, good);
+
+    ds3231_stamp.ccr = ccr;
+    ds3231_stamp.valid = (DS3231_CacheGetStamp(&seconds, &tick) == RT_EOK);
+    ds3231_stamp.seconds = seconds;
+    ds3231_stamp.tick = tick;
+    ds3231_stamp.stats.edges++;
+}
+
+/*******************************************************************************
+* @brief    获取当前时间戳, 可以在中断中调用
+* @param    stamp - 输出
+* @retval   RT_EOK, -RT_ERROR: 没有有效的秒边沿
+*******************************************************************************/
+rt_err_t DS3231_StampNow(DS3231_Stamp *stamp)
+{
+    rt_base_t level;
+    rt_uint16_t count, ccr;
+    rt_uint32_t seconds;
+    rt_tick_t tick;
+    rt_bool_t valid;
+
+    level = rt_hw_interrupt_disable();
+    count = TIM8->CNT;
+    ccr = ds3231_stamp.ccr;
+    seconds = ds3231_stamp.seconds;
+    tick = ds3231_stamp.tick;
+    valid = ds3231_stamp.valid;
+    rt_hw_interrupt_enable(level);
+
+    /* 16 位计数器 2 秒回绕, 超过 1.5 秒没有秒边沿则无法确定 */
+    if (!valid || rt_tick_get() - tick > RT_TICK_PER_SECOND * 3 / 2)
+        return -RT_ERROR;
+
+    /* 秒边沿已到但中断尚未处理时计数超过 32768, 进位到秒 */
+    count -= ccr;
+    stamp->seconds = seconds + count / DS3231_STAMP_HZ;
+    stamp->sub = count % DS3231_STAMP_HZ;
+
+    return RT_EOK;
+}
+
+/*******************************************************************************
+* @brief    时间戳的秒内部分换算为微秒
+* @param    stamp - 时间戳
+* @retval   0 ~ 999969 us
+*******************************************************************************/
+rt_uint32_t DS3231_StampToUs(const DS3231_Stamp *stamp)
+{
+    /* 1000000 / 32768 = 15625 / 512 */
+    return (rt_uint32_t)stamp->sub * 15625 / 512;
+}
+
+/*******************************************************************************
+* @brief    两个时间戳之差
+* @param    a, b - 时间戳
+* @retval   a - b, 微秒, 超出 rt_int32_t 时饱和
+*******************************************************************************/
+rt_int32_t DS3231_StampDiffUs(const DS3231_Stamp *a, const DS3231_Stamp *b)
+{
+    rt_int64_t diff;
+
+    diff = ((rt_int64_t)a->seconds - b->seconds) * 1000000 +
+           (rt_int32_t)DS3231_StampToUs(a) - (rt_int32_t)DS3231_StampToUs(b);
+    if (diff > 0x7FFFFFFF)
+        return 0x7FFFFFFF;
+    if (diff < -0x7FFFFFFF)
+        return -0x7FFFFFFF;
+
+    return (rt_int32_t)diff;
+}
+
+/*******************************************************************************
+* @brief    获取统计
+* @param    stats - 输出
+* @retval   None
+*******************************************************************************/
+void DS3231_StampGetStats(DS3231_StampStats *stats)
+{
+    rt_base_t level;
+
+    RT_ASSERT(stats != RT_NULL);
+
+    level = rt_hw_interrupt_disable();
+    *stats = ds3231_stamp.stats;
+    rt_hw_interrupt_enable(level);
+}
+
+/*******************************************************************************
+* @brief    打印当前时间戳和 CPU 时钟误差
+* @param    None
+* @retval   None
+*******************************************************************************/
+void DS3231_StampShow(void)
+{
+    DS3231_StampStats stats;
+    DS3231_Stamp stamp;
+    DS3231_Time time;
+    rt_uint32_t ppm;
+
+    if (DS3231_StampNow(&stamp) == RT_EOK)
+    {
+#ifdef DS3231_USING_TZ
+        DS3231_SecondsToTime(DS3231_TzLocal(stamp.seconds), &time);
+#else
+        DS3231_SecondsToTime(stamp.seconds, &time);
+#endif
+        rt_kprintf("stamp: %02u-%02u-%02u %02u:%02u:%02u.%06u\n", time.year, time.month, time.date,
+                   time.hour, time.minute, time.second, DS3231_StampToUs(&stamp));
+    }
+    else
+    {
+        rt_kprintf("stamp: no valid second edge\n");
+    }
+
+    DS3231_StampGetStats(&stats);
+    rt_kprintf("edges: %u, missed: %u, bad counts: %u\n", stats.edges, stats.missed, stats.bad);
+    if (stats.hse_windows > 0)
+    {
+        ppm = stats.hse_ppm < 0 ? -stats.hse_ppm : stats.hse_ppm;
+        rt_kprintf("cpu clock: %u Hz, error: %s%u.%02u ppm over %u s (%u windows)\n",
+                   stats.hse_hz, stats.hse_ppm < 0 ? "-" : "", ppm / 100, ppm % 100,
+                   DS3231_STAMP_HSE_WINDOW, stats.hse_windows);
+    }
+}
+
+#endif /* DS3231_USING_STAMP */
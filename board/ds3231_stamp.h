@@ -0,0 +1,54 @@
+/*******************************************************************************
+* @file    ds3231_stamp.h
+* @version 1.0
+* @brief   DS3231 32kHz 高分辨率时间戳头文件
+*******************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __DS3231_STAMP_H
+#define __DS3231_STAMP_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "ds3231.h"
+
+#ifdef DS3231_USING_STAMP
+
+#ifndef DS3231_USING_CACHE
+#error "DS3231_USING_STAMP requires DS3231_USING_CACHE"
+#endif
+
+/* Exported types ------------------------------------------------------------*/
+/* 以 RTC 为基准的时间戳 */
+typedef struct
+{
+    rt_uint32_t seconds;        /* 2000-01-01 00:00:00 起的秒数 */
+    rt_uint16_t sub;            /* 秒内的 32kHz 计数, 0 ~ 32767 */
+} DS3231_Stamp;
+
+typedef struct
+{
+    rt_uint32_t edges;          /* 锁存到的秒边沿 */
+    rt_uint32_t missed;         /* 秒边沿中断时没有锁存值, 32kHz 或 SQW 未接 */
+    rt_uint32_t bad;            /* 两次锁存之间不是 32768 个计数 */
+    rt_uint32_t hse_hz;         /* 最近一个窗口测得的 CPU 时钟频率 */
+    rt_int32_t hse_ppm;         /* CPU 时钟相对标称值的误差, 0.01 ppm, 正值为偏快 */
+    rt_uint32_t hse_windows;    /* 完成的测量窗口数 */
+} DS3231_StampStats;
+
+/* Exported define -----------------------------------------------------------*/
+#define DS3231_STAMP_HZ             32768
+#define DS3231_STAMP_TOLERANCE      2       /* 每秒计数允许的偏差 */
+#define DS3231_STAMP_HSE_WINDOW     60      /* CPU 时钟测量窗口, 秒 */
+
+/* Exported functions ------------------------------------------------------- */
+rt_err_t DS3231_StampInit(void);
+void DS3231_StampEdge(void);
+rt_err_t DS3231_StampNow(DS3231_Stamp *stamp);
+rt_uint32_t DS3231_StampToUs(const DS3231_Stamp *stamp);
+rt_int32_t DS3231_StampDiffUs(const DS3231_Stamp *a, const DS3231_Stamp *b);
+void DS3231_StampGetStats(DS3231_StampStats *stats);
+void DS3231_StampShow(void);
+
+#endif /* DS3231_USING_STAMP */
+
+#endif /* __DS3231_STAMP_H */
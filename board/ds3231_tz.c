@@ -0,0 +1,565 @@
+/*******************************************************************************
+* @file     ds3231_tz.c
+* @version  1.0
+* @brief    DS3231 时区与夏令时
+*           芯片保存 UTC, 本地时间由 POSIX TZ 规则换算, 例如
+*               CST-8                               中国标准时间, 无夏令时
+*               CET-1CEST,M3.5.0,M10.5.0/3          中欧
+*               EST5EDT,M3.2.0,M11.1.0              美国东部
+*               AEST-10AEDT,M10.1.0,M4.1.0/3        澳大利亚东部, 夏令时跨年
+*           解析后的规则按年份算出当年两个切换时刻 (UTC), 只在跨年时重算.
+*           上一次查到的区间 [from, from + span) 及其偏移单独保存,
+*           显示等频繁的调用只需一次比较和一次加法, 跨过切换时刻才重新查表.
+*           时间单位为 2000-01-01 00:00:00 起的秒数
+*******************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include <rtdevice.h>
+#include "ds3231_tz.h"
+#ifdef DS3231_USING_CACHE
+#include "ds3231_cache.h"
+#endif
+
+#ifdef DS3231_USING_TZ
+
+/* Private define ------------------------------------------------------------*/
+#define TZ_RULE_JULIAN          0       /* Jn: 1 ~ 365, 不计 2 月 29 日 */
+#define TZ_RULE_DAY             1       /* n: 0 ~ 365 */
+#define TZ_RULE_MONTH           2       /* Mm.w.d: m 月第 w 个星期 d, w = 5 为最后一个 */
+
+#define TZ_RULE_TIME            7200    /* 切换时刻缺省为当地 02:00 */
+#define TZ_OFFSET_HOUR_MAX      24
+#define TZ_TIME_HOUR_MAX        167
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+    rt_uint8_t type;
+    rt_uint8_t month;
+    rt_uint8_t week;
+    rt_uint8_t wday;            /* 0 为星期日 */
+    rt_uint16_t day;
+    rt_int32_t time;            /* 当地时间, 秒, 可以为负或超过 24 小时 */
+} tz_rule;
+
+typedef struct
+{
+    char spec[DS3231_TZ_SPEC_MAX];
+    char std_name[DS3231_TZ_NAME_MAX];
+    char dst_name[DS3231_TZ_NAME_MAX];
+    rt_int32_t std_offset;      /* 本地时间 - UTC, 秒, 与 TZ 字符串中的符号相反 */
+    rt_int32_t dst_offset;
+    rt_bool_t has_dst;
+    tz_rule start;              /* 进入夏令时, 时刻按标准时间 */
+    tz_rule end;                /* 退出夏令时, 时刻按夏令时 */
+} tz_zone;
+
+/* Private variables ---------------------------------------------------------*/
+static struct
+{
+    /* 快速路径: utc - from < span 时 local = utc + offset */
+    rt_uint32_t from;
+    rt_uint32_t span;
+    rt_int32_t offset;
+
+    /* 年度切换表, [begin, end) 为一年, [t1, t2) 使用 offset_in, 其余 offset_out */
+    rt_uint8_t year;
+    rt_bool_t built;
+    rt_uint32_t begin;
+    rt_uint32_t end;
+    rt_uint32_t t1;
+    rt_uint32_t t2;
+    rt_int32_t offset_in;
+    rt_int32_t offset_out;
+
+    tz_zone zone;
+    DS3231_TzStats stats;
+} ds3231_tz;
+
+/* Private functions ---------------------------------------------------------*/
+
+/* 名称为至少 3 个字母, 或 <...> 括起来的任意字符, 如 <+08> */
+static const char *tz_parse_name(const char *p, char *name)
+{
+    const char *begin;
+    rt_size_t len;
+
+    if (*p == '<')
+    {
+        begin = ++p;
+        while (*p != '\0' && *p != '>')
+            p++;
+        if (*p != '>')
+            return RT_NULL;
+        len = p++ - begin;
+    }
+    else
+    {
+        begin = p;
+        while ((*p >= 'A' && *p <= 'Z') || (*p >= 'a' && *p <= 'z'))
+            p++;
+        len = p - begin;
+    }
+
+    if (len < 3 || len >= DS3231_TZ_NAME_MAX)
+        return RT_NULL;
+    rt_memcpy(name, begin, len);
+    name[len] = '\0';
+
+    return p;
+}
+
+static const char *tz_parse_num(const char *p, int *value, int max)
+{
+    int i;
+
+    for (i = 0, *value = 0; i < 3 && *p >= '0' && *p <= '9'; i++, p++)
+        *value = *value * 10 + (*p - '0');
+
+    return (i > 0 && *value <= max) ? p : RT_NULL;
+}
+
+/* [+|-]hh[:mm[:ss]] */
+static const char *tz_parse_time(const char *p, rt_int32_t *seconds, int hour_max)
+{
+    int sign = 1, hour, minute = 0, second = 0;
+
+    if (*p == '+' || *p == '-')
+    {
+        if (*p == '-')
+            sign = -1;
+        p++;
+    }
+
+    if ((p = tz_parse_num(p, &hour, hour_max)) == RT_NULL)
+        return RT_NULL;
+    if (*p == ':')
+    {
+        if ((p = tz_parse_num(p + 1, &minute, 59)) == RT_NULL)
+            return RT_NULL;
+        if (*p == ':' && (p = tz_parse_num(p + 1, &second, 59)) == RT_NULL)
+            return RT_NULL;
+    }
+
+    *seconds = sign * (hour * 3600 + minute * 60 + second);
+    return p;
+}
+
+/* Jn, n 或 Mm.w.d, 可带 /time */
+static const char *tz_parse_rule(const char *p, tz_rule *rule)
+{
+    int month, week, wday, day;
+
+    if (*p == 'M')
+    {
+        if ((p = tz_parse_num(p + 1, &month, 12)) == RT_NULL || *p != '.' ||
+            (p = tz_parse_num(p + 1, &week, 5)) == RT_NULL || *p != '.' ||
+            (p = tz_parse_num(p + 1, &wday, 6)) == RT_NULL || month < 1 || week < 1)
+            return RT_NULL;
+        rule->type = TZ_RULE_MONTH;
+        rule->month = month;
+        rule->week = week;
+        rule->wday = wday;
+    }
+    else if (*p == 'J')
+    {
+        if ((p = tz_parse_num(p + 1, &day, 365)) == RT_NULL || day < 1)
+            return RT_NULL;
+        rule->type = TZ_RULE_JULIAN;
+        rule->day = day;
+    }
+    else
+    {
+        if ((p = tz_parse_num(p, &day, 365)) == RT_NULL)
+            return RT_NULL;
+        rule->type = TZ_RULE_DAY;
+        rule->day = day;
+    }
+
+    rule->time = TZ_RULE_TIME;
+    if (*p == '/')
+        p = tz_parse_time(p + 1, &rule->time, TZ_TIME_HOUR_MAX);
+
+    return p;
+}
+
+static rt_err_t tz_parse(const char *spec, tz_zone *zone)
+{
+    const char *p = spec;
+    rt_int32_t offset;
+
+    rt_memset(zone, 0, sizeof(*zone));
+    if (rt_strlen(spec) >= DS3231_TZ_SPEC_MAX)
+        return -RT_EINVAL;
+    rt_strncpy(zone->spec, spec, DS3231_TZ_SPEC_MAX - 1);
+
+    if ((p = tz_parse_name(p, zone->std_name)) == RT_NULL ||
+        (p = tz_parse_time(p, &offset, TZ_OFFSET_HOUR_MAX)) == RT_NULL)
+        return -RT_EINVAL;
+    zone->std_offset = -offset;
+    if (*p == '\0')
+        return RT_EOK;
+
+    if ((p = tz_parse_name(p, zone->dst_name)) == RT_NULL)
+        return -RT_EINVAL;
+    zone->has_dst = RT_TRUE;
+    zone->dst_offset = zone->std_offset + 3600;
+    if (*p != '\0' && *p != ',')
+    {
+        if ((p = tz_parse_time(p, &offset, TZ_OFFSET_HOUR_MAX)) == RT_NULL)
+            return -RT_EINVAL;
+        zone->dst_offset = -offset;
+    }
+
+    if (*p == '\0')
+    {
+        /* 没有规则时与 glibc 相同, 使用美国的规则 */
+        p = tz_parse_rule("M3.2.0", &zone->start);
+        p = tz_parse_rule("M11.1.0", &zone->end);
+    }
+    else if (*p++ != ',' || (p = tz_parse_rule(p, &zone->start)) == RT_NULL ||
+             *p++ != ',' || (p = tz_parse_rule(p, &zone->end)) == RT_NULL)
+    {
+        return -RT_EINVAL;
+    }
+
+    return (*p == '\0') ? RT_EOK : -RT_EINVAL;
+}
+
+/* 2000-01-01 起的天数, month 为 13 时是下一年的 1 月 */
+static rt_uint32_t tz_days(rt_uint8_t year, rt_uint8_t month, rt_uint8_t date)
+{
+    DS3231_Time time = {0};
+
+    if (month > 12)
+    {
+        year++;
+        month = 1;
+    }
+    time.year = year;
+    time.month = month;
+    time.date = date;
+
+    return DS3231_TimeToSeconds(&time) / 86400;
+}
+
+/* 规则在 year 年对应的日期, 2000-01-01 起的天数 */
+static rt_uint32_t tz_rule_day(const tz_rule *rule, rt_uint8_t year)
+{
+    rt_uint32_t first, len, day;
+
+    switch (rule->type)
+    {
+    case TZ_RULE_JULIAN:
+        day = rule->day - 1;
+        if ((year % 4) == 0 && rule->day >= 60)
+            day++;
+        return tz_days(year, 1, 1) + day;
+
+    case TZ_RULE_DAY:
+        return tz_days(year, 1, 1) + rule->day;
+
+    default:
+        /* 2000-01-01 是星期六, 第 w 个星期 d, 超出本月则退回一周 */
+        first = tz_days(year, rule->month, 1);
+        len = tz_days(year, rule->month + 1, 1) - first;
+        day = (rule->wday + 7 - (first + 6) % 7) % 7 + (rule->week - 1) * 7;
+        if (day >= len)
+            day -= 7;
+        return first + day;
+    }
+}
+
+/* 切换时刻换算为 UTC, 限制在 [begin, end] 之内, 不影响年内的查表结果 */
+static rt_uint32_t tz_instant(const tz_rule *rule, rt_uint8_t year, rt_int32_t offset)
+{
+    rt_int64_t t = (rt_int64_t)tz_rule_day(rule, year) * 86400 + rule->time - offset;
+
+    if (t < ds3231_tz.begin)
+        return ds3231_tz.begin;
+    if (t > ds3231_tz.end)
+        return ds3231_tz.end;
+
+    return (rt_uint32_t)t;
+}
+
+static void tz_build(rt_uint8_t year)
+{
+    const tz_zone *zone = &ds3231_tz.zone;
+    rt_uint32_t start, end;
+
+    ds3231_tz.year = year;
+    ds3231_tz.begin = tz_days(year, 1, 1) * 86400UL;
+    ds3231_tz.end = tz_days(year, 13, 1) * 86400UL;
+    ds3231_tz.built = RT_TRUE;
+    ds3231_tz.stats.builds++;
+
+    if (!zone->has_dst)
+    {
+        ds3231_tz.t1 = ds3231_tz.t2 = ds3231_tz.begin;
+        ds3231_tz.offset_in = ds3231_tz.offset_out = zone->std_offset;
+        return;
+    }
+
+    start = tz_instant(&zone->start, year, zone->std_offset);
+    end = tz_instant(&zone->end, year, zone->dst_offset);
+    if (start <= end)
+    {
+        /* 北半球: 年中为夏令时 */
+        ds3231_tz.t1 = start;
+        ds3231_tz.t2 = end;
+        ds3231_tz.offset_in = zone->dst_offset;
+        ds3231_tz.offset_out = zone->std_offset;
+    }
+    else
+    {
+        /* 南半球: 年初和年末为夏令时 */
+        ds3231_tz.t1 = end;
+        ds3231_tz.t2 = start;
+        ds3231_tz.offset_in = zone->std_offset;
+        ds3231_tz.offset_out = zone->dst_offset;
+    }
+}
+
+/* 慢速路径: 需要时重算年度表, 更新快速路径的区间. 关中断调用 */
+static rt_uint32_t tz_lookup(rt_uint32_t utc)
+{
+    DS3231_Time time;
+    rt_uint32_t from, until;
+    rt_int32_t offset;
+
+    ds3231_tz.stats.lookups++;
+
+    if (!ds3231_tz.built || utc < ds3231_tz.begin || utc >= ds3231_tz.end)
+    {
+        DS3231_SecondsToTime(utc, &time);
+        tz_build(time.year > 99 ? 99 : time.year);
+    }
+
+    if (utc < ds3231_tz.t1)
+    {
+        from = ds3231_tz.begin;
+        until = ds3231_tz.t1;
+        offset = ds3231_tz.offset_out;
+    }
+    else if (utc < ds3231_tz.t2)
+    {
+        from = ds3231_tz.t1;
+        until = ds3231_tz.t2;
+        offset = ds3231_tz.offset_in;
+    }
+    else
+    {
+        from = ds3231_tz.t2;
+        until = ds3231_tz.end;
+        offset = ds3231_tz.offset_out;
+    }
+
+    ds3231_tz.from = from;
+    ds3231_tz.span = (until > from) ? until - from : 0;
+    ds3231_tz.offset = offset;
+
+    return utc + offset;
+}
+
+static void tz_print_offset(rt_int32_t offset)
+{
+    rt_uint32_t mag = offset < 0 ? -offset : offset;
+
+    rt_kprintf("%s%02u:%02u", offset < 0 ? "-" : "+", mag / 3600, mag % 3600 / 60);
+}
+
+static void tz_print_instant(const char *label, rt_uint32_t utc, rt_int32_t offset)
+{
+    DS3231_Time time;
+
+    DS3231_SecondsToTime(utc + offset, &time);
+    rt_kprintf("%s %02u-%02u-%02u %02u:%02u:%02u local\n", label,
+               time.year, time.month, time.date, time.hour, time.minute, time.second);
+}
+
+/*******************************************************************************
+* @brief    使用 DS3231_TZ_DEFAULT 初始化时区
+* @param    None
+* @retval   RT_EOK, -RT_EINVAL: DS3231_TZ_DEFAULT 格式错误, 使用 UTC
+*******************************************************************************/
+rt_err_t DS3231_TzInit(void)
+{
+    rt_err_t ret = DS3231_TzSet(DS3231_TZ_DEFAULT);
+
+    if (ret != RT_EOK)
+    {
+        rt_kprintf("[%d]%s(): invalid time zone %s\n", __LINE__, __func__, DS3231_TZ_DEFAULT);
+        DS3231_TzSet("UTC0");
+    }
+
+    return ret;
+}
+
+/*******************************************************************************
+* @brief    设置时区
+* @param    spec - POSIX TZ 字符串: std offset [dst [offset] [,start[/time],end[/time]]]
+* @retval   RT_EOK, -RT_EINVAL: 格式错误, 保持原来的时区
+*******************************************************************************/
+rt_err_t DS3231_TzSet(const char *spec)
+{
+    tz_zone zone;
+    rt_base_t level;
+
+    if (spec == RT_NULL || tz_parse(spec, &zone) != RT_EOK)
+        return -RT_EINVAL;
+
+    level = rt_hw_interrupt_disable();
+    ds3231_tz.zone = zone;
+    ds3231_tz.built = RT_FALSE;
+    ds3231_tz.span = 0;
+    rt_hw_interrupt_enable(level);
+
+    return RT_EOK;
+}
+
+/*******************************************************************************
+* @brief    获取当前时区的 POSIX TZ 字符串
+* @param    None
+* @retval   TZ 字符串
+*******************************************************************************/
+const char *DS3231_TzGet(void)
+{
+    return ds3231_tz.zone.spec;
+}
+
+/*******************************************************************************
+* @brief    UTC 转换为本地时间. 与上一次同在一个区间时只做一次比较和加法
+* @param    utc - 2000-01-01 00:00:00 起的秒数
+* @retval   本地时间, 2000-01-01 00:00:00 起的秒数
+*******************************************************************************/
+rt_uint32_t DS3231_TzLocal(rt_uint32_t utc)
+{
+    rt_base_t level;
+    rt_uint32_t local;
+
+    level = rt_hw_interrupt_disable();
+    if (utc - ds3231_tz.from < ds3231_tz.span)
+        local = utc + ds3231_tz.offset;
+    else
+        local = tz_lookup(utc);
+    rt_hw_interrupt_enable(level);
+
+    return local;
+}
+
+/*******************************************************************************
+* @brief    本地时间转换为 UTC.
+*           夏令时结束时重复的一小时取较早的时刻 (夏令时),
+*           夏令时开始时跳过的一小时按切换前的偏移换算, 落在切换之后
+* @param    local - 本地时间, 2000-01-01 00:00:00 起的秒数
+* @retval   UTC, 2000-01-01 00:00:00 起的秒数
+*******************************************************************************/
+rt_uint32_t DS3231_TzUtc(rt_uint32_t local)
+{
+    rt_uint32_t a, b;
+    rt_bool_t ok_a, ok_b;
+
+    a = local - ds3231_tz.zone.std_offset;
+    if (!ds3231_tz.zone.has_dst)
+        return a;
+    b = local - ds3231_tz.zone.dst_offset;
+
+    ok_a = (DS3231_TzLocal(a) == local);
+    ok_b = (DS3231_TzLocal(b) == local);
+    if (ok_a && ok_b)
+        return a < b ? a : b;
+    if (ok_a)
+        return a;
+    if (ok_b)
+        return b;
+
+    return a > b ? a : b;
+}
+
+/*******************************************************************************
+* @brief    获取当前本地时间, 时间缓存有效时不访问总线
+* @param    time - 输出, 24 小时制, day 为 1 ~ 7 对应星期一 ~ 星期日
+* @retval   None
+*******************************************************************************/
+void DS3231_TzLocalTime(DS3231_Time *time)
+{
+    rt_uint32_t utc;
+
+    if (time == RT_NULL)
+        return;
+
+#ifdef DS3231_USING_CACHE
+    if (DS3231_CacheGetSeconds(&utc) == RT_EOK)
+    {
+        DS3231_SecondsToTime(DS3231_TzLocal(utc), time);
+        return;
+    }
+#endif
+
+    DS3231_GetTime(time);
+    utc = DS3231_TimeToSeconds(time);
+    DS3231_SecondsToTime(DS3231_TzLocal(utc), time);
+}
+
+/*******************************************************************************
+* @brief    获取统计
+* @param    stats - 输出
+* @retval   None
+*******************************************************************************/
+void DS3231_TzGetStats(DS3231_TzStats *stats)
+{
+    rt_base_t level;
+
+    RT_ASSERT(stats != RT_NULL);
+
+    level = rt_hw_interrupt_disable();
+    *stats = ds3231_tz.stats;
+    rt_hw_interrupt_enable(level);
+}
+
+/*******************************************************************************
+* @brief    打印时区, 当年的夏令时切换时刻和本地时间
+* @param    None
+* @retval   None
+*******************************************************************************/
+void DS3231_TzShow(void)
+{
+    const tz_zone *zone = &ds3231_tz.zone;
+    DS3231_TzStats stats;
+    DS3231_Time time;
+    rt_base_t level;
+    rt_uint32_t t1, t2;
+    rt_int32_t offset_in, offset_out;
+
+    DS3231_TzLocalTime(&time);
+    rt_kprintf("zone: %s\n", zone->spec);
+    rt_kprintf("local: %02u-%02u-%02u %02u:%02u:%02u, day %u\n", time.year, time.month, time.date,
+               time.hour, time.minute, time.second, time.day);
+
+    rt_kprintf("standard: %s UTC", zone->std_name);
+    tz_print_offset(zone->std_offset);
+    rt_kprintf("\n");
+    if (zone->has_dst)
+    {
+        rt_kprintf("daylight: %s UTC", zone->dst_name);
+        tz_print_offset(zone->dst_offset);
+        rt_kprintf("\n");
+
+        /* 上面已按当前时间查过表, 表即为今年 */
+        level = rt_hw_interrupt_disable();
+        t1 = ds3231_tz.t1;
+        t2 = ds3231_tz.t2;
+        offset_in = ds3231_tz.offset_in;
+        offset_out = ds3231_tz.offset_out;
+        rt_hw_interrupt_enable(level);
+
+        tz_print_instant(offset_in == zone->dst_offset ? "dst starts:" : "dst ends:  ", t1, offset_out);
+        tz_print_instant(offset_in == zone->dst_offset ? "dst ends:  " : "dst starts:", t2, offset_in);
+    }
+
+    DS3231_TzGetStats(&stats);
+    rt_kprintf("lookups: %u, table builds: %u\n", stats.lookups, stats.builds);
+}
+
+#endif /* DS3231_USING_TZ */
@@ -0,0 +1,39 @@
+/*******************************************************************************
+* @file    ds3231_tz.h
+* @version 1.0
+* @brief   DS3231 时区与夏令时头文件
+*******************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __DS3231_TZ_H
+#define __DS3231_TZ_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "ds3231.h"
+
+#ifdef DS3231_USING_TZ
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+    rt_uint32_t lookups;        /* 快速路径未命中, 重新查表的次数 */
+    rt_uint32_t builds;         /* 计算年度切换表的次数 */
+} DS3231_TzStats;
+
+/* Exported define -----------------------------------------------------------*/
+#define DS3231_TZ_NAME_MAX          8       /* 时区缩写, 含结尾 0 */
+#define DS3231_TZ_SPEC_MAX          48      /* POSIX TZ 字符串, 含结尾 0 */
+
+/* Exported functions ------------------------------------------------------- */
+rt_err_t DS3231_TzInit(void);
+rt_err_t DS3231_TzSet(const char *spec);
+const char *DS3231_TzGet(void);
+rt_uint32_t DS3231_TzLocal(rt_uint32_t utc);
+rt_uint32_t DS3231_TzUtc(rt_uint32_t local);
+void DS3231_TzLocalTime(DS3231_Time *time);
+void DS3231_TzGetStats(DS3231_TzStats *stats);
+void DS3231_TzShow(void);
+
+#endif /* DS3231_USING_TZ */
+
+#endif /* __DS3231_TZ_H */
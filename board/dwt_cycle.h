@@ -0,0 +1,35 @@
+/*******************************************************************************
+* @file     dwt_cycle.h
+* @version  1.0
+* @brief    Cortex-M3 DWT 周期计数器, 用于测量代码执行的时钟周期数
+*******************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __DWT_CYCLE_H
+#define __DWT_CYCLE_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <board.h>
+
+/* Exported functions ------------------------------------------------------- */
+
+/* 使能 DWT 周期计数器, 可重复调用 */
+rt_inline void DWT_CycleInit(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/* 读取当前周期计数, 32 位回绕, 两次读数相减即为经过的周期数 */
+rt_inline rt_uint32_t DWT_CycleGet(void)
+{
+    return DWT->CYCCNT;
+}
+
+/* 周期数转换为纳秒 */
+rt_inline rt_uint32_t DWT_CycleToNs(rt_uint32_t cycles)
+{
+    return (rt_uint32_t)((rt_uint64_t)cycles * 1000 / (SystemCoreClock / 1000000));
+}
+
+#endif /* __DWT_CYCLE_H */
@@ -10,7 +10,171 @@
 *******************************************************************************/
 
 /* Includes ------------------------------------------------------------------*/
+#include <rtdevice.h>
 #include "hv57708.h"
+#include "dwt_cycle.h"
+#ifdef HV57708_USING_DIM
+#include "hv57708_dim.h"
+#endif
+
+/* Private define ------------------------------------------------------------*/
+/* 开漏输出经上拉电阻到 5V, 上升沿较缓, 每个边沿之后留出等待时间 */
+#ifndef HV57708_USING_SIM
+#define HV57708_EDGE_DELAY()    do { __nop(); __nop(); __nop(); \
+                                     __nop(); __nop(); __nop(); } while (0)
+#define HV57708_LE_DELAY()      do { __nop(); __nop(); __nop(); } while (0)
+#else
+/* 仿真时只把等待的周期数计入模型的时间 */
+#define HV57708_EDGE_DELAY()    HV57708_SimDelay(6)
+#define HV57708_LE_DELAY()      HV57708_SimDelay(3)
+#endif
+
+/* 4 位数据对应的 DIN 引脚电平, 数据位 3 ~ 0 依次送往 DIN4(PB12) ~ DIN1(PB15) */
+#define HV57708_DIN_BITS(n)     (((((n) >> 3) & 1) << 12) | ((((n) >> 2) & 1) << 13) | \
+                                 ((((n) >> 1) & 1) << 14) | (((n) & 1) << 15))
+/* BSRR 低半字置位, 高半字复位, 一次写入同时设置 4 个数据引脚 */
+#define HV57708_NIBBLE_BSRR(n)  (HV57708_DIN_BITS(n) | \
+                                 ((HV57708_DIN_BITS(n) ^ HV57708_DIN_MASK) << 16))
+
+#define HV57708_BENCH_FRAMES    64
+
+/* 编码表: 每个管 10 个数字各对应一个已移到位的 64 位掩码 */
+#define HV57708_LUT_ENTRY(t, d) HV57708_CATHODE_MASK(t, d)
+#define HV57708_LUT_TUBE(t)     { HV57708_LUT_ENTRY(t, 0), HV57708_LUT_ENTRY(t, 1), \
+                                  HV57708_LUT_ENTRY(t, 2), HV57708_LUT_ENTRY(t, 3), \
+                                  HV57708_LUT_ENTRY(t, 4), HV57708_LUT_ENTRY(t, 5), \
+                                  HV57708_LUT_ENTRY(t, 6), HV57708_LUT_ENTRY(t, 7), \
+                                  HV57708_LUT_ENTRY(t, 8), HV57708_LUT_ENTRY(t, 9) }
+
+/* Private variables ---------------------------------------------------------*/
+static const rt_uint32_t nibble_bsrr[16] =
+{
+    HV57708_NIBBLE_BSRR(0x0), HV57708_NIBBLE_BSRR(0x1),
+    HV57708_NIBBLE_BSRR(0x2), HV57708_NIBBLE_BSRR(0x3),
+    HV57708_NIBBLE_BSRR(0x4), HV57708_NIBBLE_BSRR(0x5),
+    HV57708_NIBBLE_BSRR(0x6), HV57708_NIBBLE_BSRR(0x7),
+    HV57708_NIBBLE_BSRR(0x8), HV57708_NIBBLE_BSRR(0x9),
+    HV57708_NIBBLE_BSRR(0xA), HV57708_NIBBLE_BSRR(0xB),
+    HV57708_NIBBLE_BSRR(0xC), HV57708_NIBBLE_BSRR(0xD),
+    HV57708_NIBBLE_BSRR(0xE), HV57708_NIBBLE_BSRR(0xF),
+};
+
+static const rt_uint64_t digit_lut[HV57708_TUBE_NUM][10] =
+{
+    HV57708_LUT_TUBE(0), HV57708_LUT_TUBE(1), HV57708_LUT_TUBE(2),
+    HV57708_LUT_TUBE(3), HV57708_LUT_TUBE(4), HV57708_LUT_TUBE(5),
+};
+
+#ifdef HV57708_USING_ASYNC
+/* 异步移位状态, 由定时器中断逐拍推进 */
+static struct
+{
+    rt_device_t timer;
+    struct rt_semaphore done;       /* 引擎转为空闲时释放 */
+    rt_uint64_t shifting;           /* 正在移出的帧, 每拍左移 4 位 */
+    rt_uint64_t pending;            /* 移位过程中提交的最新一帧 */
+    rt_uint8_t beat;                /* 0 ~ 15 移位, 16 锁存 */
+    volatile rt_bool_t busy;
+    rt_bool_t has_pending;
+} hv_async;
+#endif
+
+/* 最近一次送出锁存的帧, 相同的帧不再移位 */
+static struct
+{
+    rt_uint64_t latched;
+    rt_bool_t valid;
+    HV57708_Stats stats;
+} hv_shadow;
+
+/* 应用显示的内容, 动画等临时画面 (overlay) 结束后恢复 */
+static rt_uint64_t hv_content;
+static rt_uint8_t hv_overlay;
+
+#if HV57708_CHIP_NUM > 1
+/* 级联时最近一次锁存的 N x 64 位帧 */
+static rt_uint64_t hv_chain_latched[HV57708_CHIP_NUM];
+static rt_bool_t hv_chain_valid;
+#endif
+
+/* 每个输出的累计点亮时间 (tick), 在锁存新的帧时结算上一帧 */
+static struct
+{
+    rt_uint64_t lit[64];
+    rt_uint64_t frame;
+    rt_tick_t since;
+} hv_usage;
+
+/* 阴极保护, 由单次软件定时器逐步推进, 不阻塞调用者 */
+static struct
+{
+    struct rt_timer timer;
+    rt_tick_t last;             /* 上次保护的时间 */
+    rt_uint8_t step;            /* 全数字扫描时为当前数字 */
+    rt_bool_t sweep;            /* RT_TRUE: 全数字扫描, RT_FALSE: 单次点亮 */
+    rt_bool_t enable;
+    volatile rt_bool_t busy;
+} hv_protect;
+
+/* 移位线的所有权: 线程之间用互斥量串行化, 线程移位期间 busy 为真,
+   秒边沿中断只记录不移位. 异步引擎和调光定时器运行时由它们独占,
+   线程不再移位 */
+static struct
+{
+    struct rt_mutex lock;
+    rt_uint8_t depth;               /* BusTake 嵌套层数 */
+    volatile rt_bool_t busy;
+} hv_bus;
+
+/* 双缓冲, front 为正在显示的帧, back 为等待下一个秒边沿锁存的帧 */
+static struct
+{
+    rt_uint64_t front;
+    rt_uint64_t back;
+    rt_bool_t ready;                /* back 已渲染, 等待锁存 */
+    rt_bool_t preshifted;           /* back 已在移位寄存器中 */
+    rt_bool_t latch_pending;        /* 移位期间到来的边沿, 总线空闲后立即锁存 */
+    rt_uint32_t edge_cycle;         /* 边沿中断入口的周期计数 */
+    rt_uint32_t latency_last;       /* 边沿到锁存的延迟, ns */
+    rt_uint32_t latency_max;
+    void (*hook)(rt_uint32_t ns);
+} hv_fb;
+
+#ifdef HV57708_USING_PWM
+/* 软件 PWM 调光, 第 k 个时隙显示 content & mask[active][k].
+   掩码只取决于亮度, 内容变化时不需要重建, 中断中只做一次与运算 */
+static struct
+{
+    rt_device_t timer;
+    rt_uint64_t mask[2][HV57708_PWM_LEVELS];
+    rt_uint64_t tube_mask[HV57708_TUBE_NUM];    /* 每个管全部阴极 */
+    rt_uint64_t tubes_mask;                     /* 所有管的阴极 */
+    rt_uint64_t content;                        /* 全亮时的帧 */
+    rt_uint64_t output;                         /* 已锁存的帧 */
+    rt_uint32_t refresh;
+    rt_uint32_t isr_cycles;                     /* 中断累计耗时 */
+    rt_uint8_t level[HV57708_TUBE_NUM];
+    volatile rt_uint8_t active;
+    rt_uint8_t slot;
+    volatile rt_bool_t running;
+} hv_pwm;
+#endif
+
+/* Private function prototypes -----------------------------------------------*/
+#ifdef HV57708_USING_ASYNC
+static void HV57708_AsyncInit(void);
+#endif
+#ifdef HV57708_USING_PWM
+static void HV57708_PwmInit(void);
+static void HV57708_PwmBuild(void);
+#endif
+static void HV57708_BusTake(void);
+static void HV57708_BusRelease(void);
+static void HV57708_FbFlushPending(void);
+static void HV57708_Account(rt_uint64_t frame);
+static void HV57708_ProtectTimeout(void *parameter);
+static void HV57708_ProtectPoll(void);
+static void HV57708_SetContent(rt_uint64_t frame);
 
 /*******************************************************************************
   * @brief  HV57708 初始化
@@ -22,6 +186,9 @@ void HV57708_Init(void)
     /* 需要注意的是, HV57708 引脚的驱动电压为 5V, 而 STM32 推挽输出高电平
     仅为 3.3V, 为了匹配电平, STM32 引脚应使用开漏输出并上拉到 5V */
 
+#ifdef HV57708_USING_SIM
+    HV57708_SimReset();
+#else
     /* CLK, LE, POL */
     rt_pin_mode(HV57708_CLK, PIN_MODE_OUTPUT_OD);
     rt_pin_mode(HV57708_LE, PIN_MODE_OUTPUT_OD);
@@ -34,6 +201,7 @@ void HV57708_Init(void)
 
     /* 辉光管电源开关 */
     rt_pin_mode(HV57708_SW, PIN_MODE_OUTPUT);
+#endif
 
     /******************************************************************************/
 
@@ -46,6 +214,22 @@ void HV57708_Init(void)
     HV57708_DIN4_L;
 
     HV57708_SendData(0, 0); // 所有引脚输出低电平
+
+    rt_mutex_init(&hv_bus.lock, "hv_bus", RT_IPC_FLAG_PRIO);
+    DWT_CycleInit();
+
+#ifdef HV57708_USING_ASYNC
+    HV57708_AsyncInit();
+#endif
+#ifdef HV57708_USING_PWM
+    HV57708_PwmInit();
+#endif
+
+    hv_usage.since = rt_tick_get();
+    rt_timer_init(&hv_protect.timer, "hv_prot", HV57708_ProtectTimeout, RT_NULL,
+                  HV57708_PROTECT_TICKS, RT_TIMER_FLAG_ONE_SHOT | RT_TIMER_FLAG_SOFT_TIMER);
+    hv_protect.last = rt_tick_get();
+    hv_protect.enable = RT_TRUE;
 }
 
 /*******************************************************************************
@@ -55,7 +239,11 @@ void HV57708_Init(void)
 *******************************************************************************/
 void HV57708_TubePower(rt_base_t NewState)
 {
-    rt_pin_write(HV57708_SW, NewState);
+#ifdef HV57708_USING_DIM
+    HV57708_DimPower(NewState);
+#else
+    HV57708_SW_WRITE(NewState);
+#endif
 }
 
 /*******************************************************************************
@@ -66,16 +254,20 @@ void HV57708_TubePower(rt_base_t NewState)
 *******************************************************************************/
 rt_base_t HV57708_TubePowerStatus(void)
 {
-    return rt_pin_read(HV57708_SW);
+#ifdef HV57708_USING_DIM
+    return HV57708_DimPowerStatus();
+#else
+    return HV57708_SW_READ();
+#endif
 }
 
 /*******************************************************************************
-  * @brief  向 HV57708 发送 64 位数据
+  * @brief  向 HV57708 发送 64 位数据, 逐位调用 rt_pin_write 的实现
   * @param  datapart1 - 第一部分数据, 32 位
   *         datapart2 - 第二部分数据, 32 位
   * @retval None
 *******************************************************************************/
-void HV57708_SendData(rt_uint32_t datapart2, rt_uint32_t datapart1)
+static void HV57708_SendData_Pin(rt_uint32_t datapart2, rt_uint32_t datapart1)
 {
     rt_uint8_t i;
     rt_uint32_t tmp;
@@ -163,6 +355,54 @@ void HV57708_SendData(rt_uint32_t datapart2, rt_uint32_t datapart1)
     }
 }
 
+/*******************************************************************************
+  * @brief  通过端口寄存器移入 4 位数据, 写一次 DIN 端口的 BSRR,
+  *         再写两次控制端口产生 CLK 脉冲
+  * @param  nibble - 4 位数据, 位 3 送往 DIN4
+  * @retval None
+*******************************************************************************/
+rt_inline void HV57708_ShiftNibble(rt_uint32_t nibble)
+{
+    HV57708_DIN_WRITE(nibble_bsrr[nibble]);
+    HV57708_EDGE_DELAY(); /* 数据建立时间 */
+    HV57708_CTRL_SET(HV57708_CLK_MASK);
+    HV57708_EDGE_DELAY(); /* 至少 62 ns */
+    HV57708_CTRL_RESET(HV57708_CLK_MASK);
+}
+
+/*******************************************************************************
+  * @brief  通过端口寄存器移入 32 位数据
+  * @param  data - 32 位数据, 高位在前
+  * @retval None
+*******************************************************************************/
+static void HV57708_ShiftWord(rt_uint32_t data)
+{
+    rt_uint8_t i;
+
+    for (i = 0; i < 8; i++)
+    {
+        HV57708_ShiftNibble(data >> 28);
+        data <<= 4;
+    }
+}
+
+/*******************************************************************************
+  * @brief  向 HV57708 发送 64 位数据, 调用者需持有总线 (HV57708_BusTake)
+  *         或已关中断
+  * @param  datapart1 - 第一部分数据, 32 位
+  *         datapart2 - 第二部分数据, 32 位
+  * @retval None
+*******************************************************************************/
+void HV57708_SendData(rt_uint32_t datapart2, rt_uint32_t datapart1)
+{
+#ifdef HV57708_USING_PIN_API
+    HV57708_SendData_Pin(datapart2, datapart1);
+#else
+    HV57708_ShiftWord(datapart2); // 高位在前
+    HV57708_ShiftWord(datapart1);
+#endif
+}
+
 /*******************************************************************************
   * @brief  将 HV57708 寄存器中的数据发送到引脚, 即锁存使能脉冲
   * @param  None
@@ -170,30 +410,320 @@ void HV57708_SendData(rt_uint32_t datapart2, rt_uint32_t datapart1)
 *******************************************************************************/
 void HV57708_OutputData(void)
 {
-    HV57708_LE_L;
-    __nop();
-    __nop();
-    __nop();
-    HV57708_LE_H;
+    HV57708_CTRL_RESET(HV57708_LE_MASK);
+    HV57708_LE_DELAY();
+    HV57708_CTRL_SET(HV57708_LE_MASK);
     /* 至少 25ns */
-    __nop();
-    __nop();
-    __nop();
-    HV57708_LE_L;
+    HV57708_EDGE_DELAY();
+    HV57708_CTRL_RESET(HV57708_LE_MASK);
 }
 
+#ifdef HV57708_USING_ASYNC
+
 /*******************************************************************************
-  * @brief  将 HV57708 寄存器中的数据发送到引脚, 即锁存使能脉冲
-  * @param  data: data0 ~ data5 表示辉光管从左到右
+  * @brief  定时器中断回调, 每拍移入 4 位, 第 16 拍之后锁存
+  * @param  dev - 定时器设备
+  * @param  size - 未使用
+  * @retval RT_EOK
+*******************************************************************************/
+static rt_err_t HV57708_AsyncTimeout(rt_device_t dev, rt_size_t size)
+{
+    rt_base_t level;
+
+    if (hv_async.beat < 16)
+    {
+        HV57708_ShiftNibble((rt_uint32_t)(hv_async.shifting >> 60));
+        hv_async.shifting <<= 4;
+        hv_async.beat++;
+        return RT_EOK;
+    }
+
+    HV57708_OutputData();
+
+    if (hv_async.has_pending)
+    {
+        /* 接着移出移位期间提交的帧 */
+        hv_async.shifting = hv_async.pending;
+        hv_async.has_pending = RT_FALSE;
+        hv_async.beat = 0;
+        return RT_EOK;
+    }
+
+    rt_device_control(dev, HWTIMER_CTRL_STOP, RT_NULL);
+    hv_async.busy = RT_FALSE;
+
+    level = rt_hw_interrupt_disable();
+    if (!hv_bus.busy)
+        HV57708_FbFlushPending();
+    rt_hw_interrupt_enable(level);
+    rt_sem_release(&hv_async.done);
+
+    return RT_EOK;
+}
+
+/*******************************************************************************
+  * @brief  打开异步移位使用的硬件定时器, 找不到定时器时退回同步移位
+  * @param  None
   * @retval None
 *******************************************************************************/
-void HV57708_Display(rt_uint8_t data[])
+static void HV57708_AsyncInit(void)
 {
-    RT_ASSERT(data != NULL);
+    rt_uint32_t freq = 1000000; /* 1MHz 计数, 定时单位 1us */
+    rt_hwtimer_mode_t mode = HWTIMER_MODE_PERIOD;
 
-    if (HV57708_TubePowerStatus() == 0)
+    if (hv_async.timer != RT_NULL)
+        return;
+
+    rt_sem_init(&hv_async.done, "hv_done", 0, RT_IPC_FLAG_FIFO);
+
+    hv_async.timer = rt_device_find(HV57708_ASYNC_TIMER);
+    if (hv_async.timer == RT_NULL)
+    {
+        rt_kprintf("[%d]%s(): can't find device %s!\n", __LINE__, __func__, HV57708_ASYNC_TIMER);
+        return;
+    }
+
+    if (rt_device_open(hv_async.timer, RT_DEVICE_OFLAG_RDWR) != RT_EOK)
+    {
+        rt_kprintf("[%d]%s(): open %s failed!\n", __LINE__, __func__, HV57708_ASYNC_TIMER);
+        hv_async.timer = RT_NULL;
+        return;
+    }
+
+    rt_device_set_rx_indicate(hv_async.timer, HV57708_AsyncTimeout);
+    rt_device_control(hv_async.timer, HWTIMER_CTRL_FREQ_SET, &freq);
+    rt_device_control(hv_async.timer, HWTIMER_CTRL_MODE_SET, &mode);
+}
+
+/*******************************************************************************
+  * @brief  提交一帧数据, 由定时器中断移出并锁存, 函数立即返回.
+  *         正在移位时只保留最新提交的一帧, 当前帧锁存后接着移出.
+  *         只在线程中调用, 持有总线锁提交, 不与预移位交错
+  * @param  datapart1 - 第一部分数据, 32 位
+  *         datapart2 - 第二部分数据, 32 位
+  * @retval RT_EOK: 成功, -RT_ERROR: 启动定时器失败
+*******************************************************************************/
+rt_err_t HV57708_SendFrameAsync(rt_uint32_t datapart2, rt_uint32_t datapart1)
+{
+    rt_uint64_t frame = ((rt_uint64_t)datapart2 << 32) | datapart1;
+    rt_hwtimerval_t tv;
+    rt_base_t level;
+    rt_err_t ret = RT_EOK;
+
+    if (hv_async.timer == RT_NULL)
+    {
+        HV57708_BusTake();
+        HV57708_SendData(datapart2, datapart1);
+        HV57708_OutputData();
+        HV57708_BusRelease();
+        return RT_EOK;
+    }
+
+    rt_mutex_take(&hv_bus.lock, RT_WAITING_FOREVER);
+    level = rt_hw_interrupt_disable();
+    if (hv_async.busy)
+    {
+        hv_async.pending = frame;
+        hv_async.has_pending = RT_TRUE;
+        rt_hw_interrupt_enable(level);
+        rt_mutex_release(&hv_bus.lock);
+        return RT_EOK;
+    }
+    hv_async.shifting = frame;
+    hv_async.beat = 0;
+    hv_async.busy = RT_TRUE;
+    rt_hw_interrupt_enable(level);
+
+    tv.sec = 0;
+    tv.usec = HV57708_ASYNC_TICK_US;
+    if (rt_device_write(hv_async.timer, 0, &tv, sizeof(tv)) != sizeof(tv))
+    {
+        hv_async.busy = RT_FALSE;
+        ret = -RT_ERROR;
+    }
+    rt_mutex_release(&hv_bus.lock);
+
+    return ret;
+}
+
+/*******************************************************************************
+  * @brief  等待已提交的帧全部移出并锁存
+  * @param  timeout - 等待时间(tick), RT_WAITING_FOREVER 为一直等待
+  * @retval RT_EOK: 已空闲, -RT_ETIMEOUT: 超时
+*******************************************************************************/
+rt_err_t HV57708_WaitFrame(rt_int32_t timeout)
+{
+    rt_err_t ret;
+
+    while (hv_async.busy)
+    {
+        ret = rt_sem_take(&hv_async.done, timeout);
+        if (ret != RT_EOK)
+            return ret;
+    }
+
+    return RT_EOK;
+}
+
+#endif /* HV57708_USING_ASYNC */
+
+/*******************************************************************************
+  * @brief  取得移位线, 等待异步引擎空闲. 之后到来的秒边沿推迟到释放时锁存.
+  *         可嵌套, 只在线程中调用
+  * @param  None
+  * @retval None
+*******************************************************************************/
+static void HV57708_BusTake(void)
+{
+    rt_base_t level;
+
+    RT_DEBUG_NOT_IN_INTERRUPT;
+
+    rt_mutex_take(&hv_bus.lock, RT_WAITING_FOREVER);
+    if (hv_bus.depth++ > 0)
+        return;
+
+#ifdef HV57708_USING_ASYNC
+    HV57708_WaitFrame(RT_WAITING_FOREVER);
+#endif
+    level = rt_hw_interrupt_disable();
+    hv_bus.busy = RT_TRUE;
+    rt_hw_interrupt_enable(level);
+}
+
+/*******************************************************************************
+  * @brief  释放移位线, 补做期间被推迟的锁存
+  * @param  None
+  * @retval None
+*******************************************************************************/
+static void HV57708_BusRelease(void)
+{
+    rt_base_t level;
+
+    if (--hv_bus.depth == 0)
+    {
+        level = rt_hw_interrupt_disable();
+        hv_bus.busy = RT_FALSE;
+        HV57708_FbFlushPending();
+        rt_hw_interrupt_enable(level);
+    }
+    rt_mutex_release(&hv_bus.lock);
+}
+
+/*******************************************************************************
+  * @brief  移出一帧并锁存, 使能异步移位时只提交不等待.
+  *         与已锁存的帧相同时既不移位也不产生锁存脉冲. 调光时只更新内容,
+  *         由调光中断移出. 只在线程中调用
+  * @param  frame - 64 位帧, 高 32 位即 datapart2
+  * @retval None
+*******************************************************************************/
+static void HV57708_ShowFrame(rt_uint64_t frame)
+{
+    rt_base_t level;
+
+    RT_DEBUG_NOT_IN_INTERRUPT;
+
+    rt_mutex_take(&hv_bus.lock, RT_WAITING_FOREVER);
+    level = rt_hw_interrupt_disable();
+    hv_shadow.stats.submitted++;
+    if (hv_shadow.valid && hv_shadow.latched == frame)
+    {
+        hv_shadow.stats.skipped++;
+        rt_hw_interrupt_enable(level);
+        rt_mutex_release(&hv_bus.lock);
+        return;
+    }
+    hv_shadow.latched = frame;
+    hv_shadow.valid = RT_TRUE;
+    hv_shadow.stats.shifted++;
+    hv_fb.preshifted = RT_FALSE; // 后缓冲被覆盖, 锁存时需重新移位
+    rt_hw_interrupt_enable(level);
+
+    HV57708_Account(frame);
+
+#ifdef HV57708_USING_PWM
+    if (hv_pwm.running)
+    {
+        level = rt_hw_interrupt_disable();
+        hv_pwm.content = frame;
+        rt_hw_interrupt_enable(level);
+        rt_mutex_release(&hv_bus.lock);
         return;
+    }
+#endif
+
+#ifdef HV57708_USING_ASYNC
+    HV57708_SendFrameAsync((rt_uint32_t)(frame >> 32), (rt_uint32_t)frame);
+#else
+    HV57708_BusTake();
+    HV57708_SendData((rt_uint32_t)(frame >> 32), (rt_uint32_t)frame);
+    HV57708_OutputData();
+    HV57708_BusRelease();
+#endif
+    rt_mutex_release(&hv_bus.lock);
+}
+
+/*******************************************************************************
+  * @brief  查表将 6 个数字编码为一帧, 大于 9 的数字不点亮
+  * @param  data: data0 ~ data5 表示辉光管从左到右
+  * @retval 64 位帧
+*******************************************************************************/
+rt_uint64_t HV57708_Encode(const rt_uint8_t data[])
+{
+    rt_uint64_t frame = 0;
+    rt_uint8_t i;
+
+    for (i = 0; i < HV57708_TUBE_NUM; i++)
+    {
+        if (data[i] < 10)
+            frame |= digit_lut[i][data[i]];
+    }
+
+    return frame;
+}
+
+/*******************************************************************************
+  * @brief  按层合成一帧: 点亮位相或, 熄灭位相或, 最后一次清除
+  * @param  layers - 合成层, 顺序不影响结果
+  * @param  num - 层数
+  * @retval 64 位帧
+*******************************************************************************/
+rt_uint64_t HV57708_Compose(const HV57708_Layer layers[], rt_uint8_t num)
+{
+    rt_uint64_t lit = 0, blank = 0;
+    rt_uint8_t i;
+
+    RT_ASSERT(layers != RT_NULL || num == 0);
+
+    for (i = 0; i < num; i++)
+    {
+        switch (layers[i].type)
+        {
+            case HV57708_LAYER_DIGITS:
+                if (layers[i].digits != RT_NULL)
+                    lit |= HV57708_Encode(layers[i].digits);
+                break;
+            case HV57708_LAYER_BITS:
+                lit |= layers[i].bits;
+                break;
+            case HV57708_LAYER_BLANK:
+                blank |= layers[i].bits;
+                break;
+            default:
+                break;
+        }
+    }
+
+    return lit & ~blank;
+}
 
+/*******************************************************************************
+  * @brief  逐位拼接的编码实现, 仅用于校验编码表
+  * @param  data: data0 ~ data5 表示辉光管从左到右
+  * @retval 64 位帧
+*******************************************************************************/
+static rt_uint64_t HV57708_EncodeRef(const rt_uint8_t data[])
+{
     rt_uint32_t part2 = 0, part1 = 0;
     rt_uint32_t pos[6];
     rt_uint8_t  i;
@@ -209,86 +739,1065 @@ void HV57708_Display(rt_uint8_t data[])
     part1 = pos[0] | pos[1]<<10 | pos[2]<<20 | pos[3]<<30;
     part2 = pos[3]>>2 | pos[4]<<8 | pos[5]<<18;
 
-    HV57708_SendData(part2, part1);
-    HV57708_OutputData();
+    return ((rt_uint64_t)part2 << 32) | part1;
+}
+
+#ifdef HV57708_USING_PWM
+
+/*******************************************************************************
+  * @brief  调光定时器中断回调, 切换到下一个时隙, 帧有变化时才移位锁存
+  * @param  dev - 定时器设备
+  * @param  size - 未使用
+  * @retval RT_EOK
+*******************************************************************************/
+static rt_err_t HV57708_PwmTimeout(rt_device_t dev, rt_size_t size)
+{
+    rt_uint32_t start = DWT_CycleGet();
+    rt_uint64_t frame;
+
+    hv_pwm.slot = (hv_pwm.slot + 1) & (HV57708_PWM_LEVELS - 1);
+    frame = hv_pwm.content & hv_pwm.mask[hv_pwm.active][hv_pwm.slot];
+    if (frame != hv_pwm.output)
+    {
+        HV57708_ShiftWord((rt_uint32_t)(frame >> 32));
+        HV57708_ShiftWord((rt_uint32_t)frame);
+        HV57708_OutputData();
+        hv_pwm.output = frame;
+    }
+
+    hv_pwm.isr_cycles += DWT_CycleGet() - start;
+    return RT_EOK;
 }
 
 /*******************************************************************************
-  * @brief  阴极保护, 顺序输出一遍所有数字
+  * @brief  打开调光定时器, 计算每个管的阴极掩码, 亮度默认最亮
   * @param  None
   * @retval None
 *******************************************************************************/
-void HV57708_Protection(void)
+static void HV57708_PwmInit(void)
 {
-    if (HV57708_TubePowerStatus() == 0)
+    rt_uint32_t freq = 1000000;
+    rt_hwtimer_mode_t mode = HWTIMER_MODE_PERIOD;
+    rt_uint8_t t, d;
+
+    if (hv_pwm.timer != RT_NULL)
         return;
 
-    for (rt_uint8_t i = 0; i < 10; i++)
+    hv_pwm.tubes_mask = 0;
+    for (t = 0; t < HV57708_TUBE_NUM; t++)
     {
-        rt_uint8_t data[6] = {i, i, i, i, i, i};
-        HV57708_Display(data);
-        rt_thread_mdelay(75);
+        hv_pwm.tube_mask[t] = 0;
+        for (d = 0; d < 10; d++)
+            hv_pwm.tube_mask[t] |= digit_lut[t][d];
+        hv_pwm.tubes_mask |= hv_pwm.tube_mask[t];
+        hv_pwm.level[t] = HV57708_PWM_LEVELS;
     }
-    HV57708_SendData(0, 0);
-    HV57708_OutputData();
+    HV57708_PwmBuild();
+
+    hv_pwm.timer = rt_device_find(HV57708_PWM_TIMER);
+    if (hv_pwm.timer == RT_NULL)
+    {
+        rt_kprintf("[%d]%s(): can't find device %s!\n", __LINE__, __func__, HV57708_PWM_TIMER);
+        return;
+    }
+
+    if (rt_device_open(hv_pwm.timer, RT_DEVICE_OFLAG_RDWR) != RT_EOK)
+    {
+        rt_kprintf("[%d]%s(): open %s failed!\n", __LINE__, __func__, HV57708_PWM_TIMER);
+        hv_pwm.timer = RT_NULL;
+        return;
+    }
+
+    rt_device_set_rx_indicate(hv_pwm.timer, HV57708_PwmTimeout);
+    rt_device_control(hv_pwm.timer, HWTIMER_CTRL_FREQ_SET, &freq);
+    rt_device_control(hv_pwm.timer, HWTIMER_CTRL_MODE_SET, &mode);
 }
 
 /*******************************************************************************
-  * @brief  依次设置 1 ~ 64 引脚输出高电平
+  * @brief  按当前亮度生成每个时隙的掩码, 写入未使用的一半后关中断切换.
+  *         亮度为 k 的管只在前 k 个时隙点亮, 不属于任何管的输出始终点亮.
+  *         只在线程中调用, 关调度串行化多个线程, 中断从不重建
   * @param  None
   * @retval None
 *******************************************************************************/
-void HV57708_Scan(void)
+static void HV57708_PwmBuild(void)
 {
-    rt_uint32_t part1=0x00000000, part2=0x00000000;
-    for (int i = 0; i < 32; i++)
+    rt_uint64_t *table;
+    rt_uint64_t mask;
+    rt_base_t level;
+    rt_uint8_t k, t;
+
+    RT_DEBUG_NOT_IN_INTERRUPT;
+
+    rt_enter_critical();
+    table = hv_pwm.mask[hv_pwm.active ^ 1];
+    for (k = 0; k < HV57708_PWM_LEVELS; k++)
     {
-        part1=0x00000000;
-        part2=0x00000000;
-        part1 |= (1 << i);
-        HV57708_SendData(part2, part1);
-        HV57708_OutputData();
+        mask = ~hv_pwm.tubes_mask;
+        for (t = 0; t < HV57708_TUBE_NUM; t++)
+        {
+            if (hv_pwm.level[t] > k)
+                mask |= hv_pwm.tube_mask[t];
+        }
+        table[k] = mask;
     }
-    for (int i = 0; i < 32; i++)
+
+    level = rt_hw_interrupt_disable();
+    hv_pwm.active ^= 1;
+    rt_hw_interrupt_enable(level);
+    rt_exit_critical();
+}
+
+/*******************************************************************************
+  * @brief  开始调光, 之后由定时器中断独占总线. 已在调光时可用于修改刷新率
+  * @param  refresh_hz - 每秒刷新周期数, 中断频率为其 HV57708_PWM_LEVELS 倍,
+  *         HV57708_PWM_REFRESH_MIN ~ HV57708_PWM_REFRESH_MAX
+  * @retval RT_EOK: 成功, -RT_ERROR: 定时器不可用, -RT_EINVAL: 刷新率超出范围
+*******************************************************************************/
+rt_err_t HV57708_PwmStart(rt_uint32_t refresh_hz)
+{
+    rt_hwtimerval_t tv;
+    rt_base_t level;
+
+    if (hv_pwm.timer == RT_NULL)
+        return -RT_ERROR;
+    if (refresh_hz < HV57708_PWM_REFRESH_MIN || refresh_hz > HV57708_PWM_REFRESH_MAX)
+        return -RT_EINVAL;
+
+    /* 持有总线时交给定时器中断, 之后线程不再移位 */
+    HV57708_BusTake();
+    if (!hv_pwm.running)
     {
-        part1=0x00000000;
-        part2=0x00000000;
-        part1 |= (1 << i);
-        HV57708_SendData(part2, part1);
-        HV57708_OutputData();
-        rt_thread_mdelay(500);
+        level = rt_hw_interrupt_disable();
+        hv_pwm.content = hv_shadow.valid ? hv_shadow.latched : 0;
+        hv_pwm.output = ~hv_pwm.content; // 第一个时隙必定移位
+        hv_pwm.running = RT_TRUE;
+        hv_fb.preshifted = RT_FALSE;
+        rt_hw_interrupt_enable(level);
     }
-    for (int i = 0; i < 32; i++)
+
+    hv_pwm.refresh = refresh_hz;
+    tv.sec = 0;
+    tv.usec = 1000000 / (refresh_hz * HV57708_PWM_LEVELS);
+    if (rt_device_write(hv_pwm.timer, 0, &tv, sizeof(tv)) != sizeof(tv))
     {
-        part1=0x00000000;
-        part2=0x00000000;
-        part2 |= (1 << i);
-        HV57708_SendData(part2, part1);
-        HV57708_OutputData();
-        rt_thread_mdelay(500);
+        hv_pwm.running = RT_FALSE;
+        HV57708_BusRelease();
+        return -RT_ERROR;
     }
+    HV57708_BusRelease();
+
+    return RT_EOK;
 }
 
 /*******************************************************************************
-  * @brief  设置某个引脚输出高电平
-  * @param  pin - 要输出高电平的引脚(1 ~ 64)
+  * @brief  停止调光, 所有管恢复全亮
+  * @param  None
   * @retval None
 *******************************************************************************/
-void HV57708_SetPin(rt_uint8_t pin)
+void HV57708_PwmStop(void)
 {
-    rt_uint32_t temp = 0x00000000;
-    if (pin > 64)
-        return;
-    if (pin <= 32)
+    rt_mutex_take(&hv_bus.lock, RT_WAITING_FOREVER);
+    if (!hv_pwm.running)
     {
-        temp |= (1 << (pin-1));
-        HV57708_SendData(0, temp);
-        HV57708_OutputData();
+        rt_mutex_release(&hv_bus.lock);
+        return;
     }
-    else
-    {
-        temp |= (1 << (pin-33));
-        HV57708_SendData(temp, 0);
+
+    rt_device_control(hv_pwm.timer, HWTIMER_CTRL_STOP, RT_NULL);
+    hv_pwm.running = RT_FALSE;
+
+    hv_shadow.valid = RT_FALSE;
+    HV57708_ShowFrame(hv_pwm.content);
+    rt_mutex_release(&hv_bus.lock);
+}
+
+/*******************************************************************************
+  * @brief  设置某个管的亮度
+  * @param  tube - 0 ~ 5 表示辉光管从左到右
+  * @param  level - 0(熄灭) ~ HV57708_PWM_LEVELS(全亮)
+  * @retval None
+*******************************************************************************/
+void HV57708_SetBrightness(rt_uint8_t tube, rt_uint8_t level)
+{
+    if (tube >= HV57708_TUBE_NUM)
+        return;
+
+    if (level > HV57708_PWM_LEVELS)
+        level = HV57708_PWM_LEVELS;
+
+    hv_pwm.level[tube] = level;
+    HV57708_PwmBuild();
+}
+
+/*******************************************************************************
+  * @brief  获取某个管的亮度
+  * @param  tube - 0 ~ 5 表示辉光管从左到右
+  * @retval 0 ~ HV57708_PWM_LEVELS
+*******************************************************************************/
+rt_uint8_t HV57708_GetBrightness(rt_uint8_t tube)
+{
+    if (tube >= HV57708_TUBE_NUM)
+        return 0;
+
+    return hv_pwm.level[tube];
+}
+
+/*******************************************************************************
+  * @brief  依次以不同刷新率运行调光, 测量中断占用的 CPU 比例
+  * @param  None
+  * @retval None
+*******************************************************************************/
+void HV57708_PwmMeasure(void)
+{
+    static const rt_uint16_t rates[] = {50, 100, 200, 400};
+    rt_bool_t running = hv_pwm.running;
+    rt_uint32_t refresh = hv_pwm.refresh;
+    rt_uint32_t start, elapsed, permille;
+    rt_uint8_t i;
+
+    for (i = 0; i < sizeof(rates) / sizeof(rates[0]); i++)
+    {
+        if (HV57708_PwmStart(rates[i]) != RT_EOK)
+        {
+            rt_kprintf("pwm timer not available\n");
+            return;
+        }
+        rt_thread_mdelay(20);
+
+        hv_pwm.isr_cycles = 0;
+        start = DWT_CycleGet();
+        rt_thread_mdelay(500);
+        elapsed = DWT_CycleGet() - start;
+        permille = (rt_uint32_t)((rt_uint64_t)hv_pwm.isr_cycles * 1000 / elapsed);
+
+        rt_kprintf("refresh %3u Hz, isr %5u Hz, load %u.%u%%\n", rates[i],
+                   rates[i] * HV57708_PWM_LEVELS, permille / 10, permille % 10);
+    }
+
+    if (running)
+        HV57708_PwmStart(refresh);
+    else
+        HV57708_PwmStop();
+}
+
+#endif /* HV57708_USING_PWM */
+
+/*******************************************************************************
+  * @brief  锁存后缓冲, 调用前中断已关闭且后缓冲已在移位寄存器中.
+  *         调光时改为更新调光内容, 由下一个时隙移出
+  * @param  None
+  * @retval None
+*******************************************************************************/
+static void HV57708_FbLatch(void)
+{
+    rt_uint32_t ns;
+
+#ifdef HV57708_USING_PWM
+    if (hv_pwm.running)
+        hv_pwm.content = hv_fb.back;
+    else
+#endif
         HV57708_OutputData();
+    ns = DWT_CycleToNs(DWT_CycleGet() - hv_fb.edge_cycle);
+
+    hv_fb.front = hv_fb.back;
+    hv_fb.ready = RT_FALSE;
+    hv_fb.preshifted = RT_FALSE;
+    hv_fb.latch_pending = RT_FALSE;
+    hv_shadow.latched = hv_fb.front;
+    hv_shadow.valid = RT_TRUE;
+    HV57708_Account(hv_fb.front);
+
+    hv_fb.latency_last = ns;
+    if (ns > hv_fb.latency_max)
+        hv_fb.latency_max = ns;
+    if (hv_fb.hook != RT_NULL)
+        hv_fb.hook(ns);
+}
+
+/*******************************************************************************
+  * @brief  总线空闲后处理被推迟的边沿, 在关中断或定时器中断中调用
+  * @param  None
+  * @retval None
+*******************************************************************************/
+static void HV57708_FbFlushPending(void)
+{
+    if (!hv_fb.latch_pending)
+        return;
+
+#ifdef HV57708_USING_PWM
+    if (!hv_fb.preshifted && !hv_pwm.running)
+#else
+    if (!hv_fb.preshifted)
+#endif
+        HV57708_SendData((rt_uint32_t)(hv_fb.back >> 32), (rt_uint32_t)hv_fb.back);
+    HV57708_FbLatch();
+}
+
+/*******************************************************************************
+  * @brief  渲染到后缓冲并预先移入 HV57708, 不锁存, 下一个秒边沿才显示.
+  *         在下一个边沿之前重复渲染时以最后一次为准. 调光时不移位,
+  *         边沿到来时更新调光内容
+  * @param  data: data0 ~ data5 表示辉光管从左到右
+  * @retval None
+*******************************************************************************/
+void HV57708_FbRender(rt_uint8_t data[])
+{
+    rt_uint64_t frame;
+    rt_base_t level;
+
+    RT_ASSERT(data != NULL);
+
+    frame = HV57708_Encode(data);
+
+    HV57708_BusTake();
+
+    level = rt_hw_interrupt_disable();
+    hv_fb.back = frame;
+    hv_fb.ready = RT_TRUE;
+    hv_fb.preshifted = RT_FALSE;
+    rt_hw_interrupt_enable(level);
+
+#ifdef HV57708_USING_PWM
+    if (!hv_pwm.running)
+#endif
+    {
+        /* 移位期间保持中断开启, 此时到来的边沿在释放总线时补做锁存 */
+        HV57708_SendData((rt_uint32_t)(frame >> 32), (rt_uint32_t)frame);
+        hv_fb.preshifted = RT_TRUE;
+    }
+
+    HV57708_BusRelease();
+}
+
+/*******************************************************************************
+  * @brief  DS3231 SQW 下降沿中断中调用, 后缓冲已预移位时只产生锁存脉冲.
+  *         线程或异步引擎正在移位时推迟到总线空闲, 调光时只更新调光内容
+  * @param  None
+  * @retval None
+*******************************************************************************/
+void HV57708_FbEdge(void)
+{
+    rt_uint32_t edge = DWT_CycleGet();
+    rt_base_t level;
+
+    level = rt_hw_interrupt_disable();
+    if (!hv_fb.ready)
+    {
+        rt_hw_interrupt_enable(level);
+        return;
+    }
+
+    hv_fb.edge_cycle = edge;
+    hv_fb.latch_pending = RT_TRUE;
+#ifdef HV57708_USING_ASYNC
+    if (!hv_bus.busy && !hv_async.busy)
+#else
+    if (!hv_bus.busy)
+#endif
+    {
+        HV57708_FbFlushPending();
+    }
+    rt_hw_interrupt_enable(level);
+}
+
+/*******************************************************************************
+  * @brief  设置锁存回调, 每次秒边沿锁存后在中断中调用
+  * @param  hook - 回调, 参数为边沿到锁存完成的延迟(ns), RT_NULL 取消
+  * @retval None
+*******************************************************************************/
+void HV57708_FbSetLatchHook(void (*hook)(rt_uint32_t ns))
+{
+    hv_fb.hook = hook;
+}
+
+/*******************************************************************************
+  * @brief  获取边沿到锁存的延迟
+  * @param  last_ns - 最近一次, 可为 RT_NULL
+  * @param  max_ns - 最大值, 可为 RT_NULL
+  * @retval None
+*******************************************************************************/
+void HV57708_FbGetLatency(rt_uint32_t *last_ns, rt_uint32_t *max_ns)
+{
+    if (last_ns != RT_NULL)
+        *last_ns = hv_fb.latency_last;
+    if (max_ns != RT_NULL)
+        *max_ns = hv_fb.latency_max;
+}
+
+/*******************************************************************************
+  * @brief  显示 6 个数字, 正在显示临时画面时只记录, 结束后再显示
+  * @param  data: data0 ~ data5 表示辉光管从左到右
+  * @retval None
+*******************************************************************************/
+void HV57708_Display(rt_uint8_t data[])
+{
+    RT_ASSERT(data != NULL);
+
+    if (HV57708_TubePowerStatus() == 0)
+        return;
+
+    HV57708_SetContent(HV57708_Encode(data));
+}
+
+/*******************************************************************************
+  * @brief  直接显示一帧, 可点亮任意输出, 包括备用输出 60 ~ 63.
+  *         与 HV57708_Display 共用显示流程, 正在显示临时画面时只记录
+  * @param  frame - 64 位帧, 位 i 为 1 则点亮输出 i
+  * @retval None
+*******************************************************************************/
+void HV57708_DisplayRaw(rt_uint64_t frame)
+{
+    if (HV57708_TubePowerStatus() == 0)
+        return;
+
+    HV57708_SetContent(frame);
+}
+
+/*******************************************************************************
+  * @brief  合成各层后只移位锁存一次
+  * @param  layers - 合成层
+  * @param  num - 层数
+  * @retval None
+*******************************************************************************/
+void HV57708_DisplayLayers(const HV57708_Layer layers[], rt_uint8_t num)
+{
+    HV57708_DisplayRaw(HV57708_Compose(layers, num));
+}
+
+/*******************************************************************************
+  * @brief  更新应用显示的内容, 正在显示临时画面时只记录
+  * @param  frame - 64 位帧
+  * @retval None
+*******************************************************************************/
+static void HV57708_SetContent(rt_uint64_t frame)
+{
+    if (frame != hv_content)
+        HV57708_ProtectPoll();
+    hv_content = frame;
+    if (hv_overlay == 0)
+        HV57708_ShowFrame(hv_content);
+}
+
+/*******************************************************************************
+  * @brief  按布局表把每个元件的数值编码为 N x 64 位帧
+  * @param  values - 每个元件一个数值, 顺序与 hv57708_layout 相同
+  * @param  frame - HV57708_CHIP_NUM 个 64 位帧, frame[k] 对应第 k 片
+  * @retval None
+*******************************************************************************/
+void HV57708_LayoutEncode(const rt_uint8_t values[], rt_uint64_t frame[])
+{
+    const HV57708_Element *elem;
+    const HV57708_Pin *pin;
+    rt_uint8_t i, b;
+
+    rt_memset(frame, 0, sizeof(rt_uint64_t) * HV57708_CHIP_NUM);
+
+    for (i = 0; i < hv57708_layout_num; i++)
+    {
+        elem = &hv57708_layout[i];
+        if (elem->type == HV57708_ELEM_DIGIT)
+        {
+            if (values[i] < elem->count)
+            {
+                pin = &elem->pins[values[i]];
+                frame[pin->chip] |= (rt_uint64_t)1 << pin->channel;
+            }
+        }
+        else
+        {
+            for (b = 0; b < elem->count; b++)
+            {
+                if (values[i] & (1 << b))
+                {
+                    pin = &elem->pins[b];
+                    frame[pin->chip] |= (rt_uint64_t)1 << pin->channel;
+                }
+            }
+        }
+    }
+}
+
+/*******************************************************************************
+  * @brief  一次移出整条链的数据, 不锁存. 最远的一片先移
+  * @param  frame - HV57708_CHIP_NUM 个 64 位帧
+  * @retval None
+*******************************************************************************/
+void HV57708_ChainSend(const rt_uint64_t frame[])
+{
+    rt_int8_t k;
+
+    for (k = HV57708_CHIP_NUM - 1; k >= 0; k--)
+    {
+        HV57708_ShiftWord((rt_uint32_t)(frame[k] >> 32));
+        HV57708_ShiftWord((rt_uint32_t)frame[k]);
+    }
+}
+
+/*******************************************************************************
+  * @brief  按布局表显示. 只有一片时与 HV57708_Display 共用显示流程,
+  *         级联时同步移出整条链, 与上次锁存的相同则跳过
+  * @param  values - 每个元件一个数值, 顺序与 hv57708_layout 相同
+  * @retval None
+*******************************************************************************/
+void HV57708_DisplayLayout(const rt_uint8_t values[])
+{
+    rt_uint64_t frame[HV57708_CHIP_NUM];
+
+    RT_ASSERT(values != NULL);
+
+    if (HV57708_TubePowerStatus() == 0)
+        return;
+
+    HV57708_LayoutEncode(values, frame);
+
+#if HV57708_CHIP_NUM > 1
+    hv_shadow.stats.submitted++;
+    if (hv_chain_valid && rt_memcmp(frame, hv_chain_latched, sizeof(frame)) == 0)
+    {
+        hv_shadow.stats.skipped++;
+        return;
     }
+    rt_memcpy(hv_chain_latched, frame, sizeof(frame));
+    hv_chain_valid = RT_TRUE;
+    hv_shadow.stats.shifted++;
+
+    HV57708_BusTake();
+    HV57708_ChainSend(frame);
+    HV57708_OutputData();
+    hv_fb.preshifted = RT_FALSE;
+    HV57708_BusRelease();
+#else
+    HV57708_SetContent(frame[0]);
+#endif
+}
+
+/*******************************************************************************
+  * @brief  开始显示临时画面, 期间 HV57708_Display 只记录内容. 可嵌套
+  * @param  None
+  * @retval None
+*******************************************************************************/
+void HV57708_OverlayBegin(void)
+{
+    rt_base_t level;
+
+    level = rt_hw_interrupt_disable();
+    hv_overlay++;
+    rt_hw_interrupt_enable(level);
+}
+
+/*******************************************************************************
+  * @brief  显示一帧临时画面, 只在线程中调用 (包括软件定时器回调)
+  * @param  frame - 64 位帧
+  * @retval None
+*******************************************************************************/
+void HV57708_OverlayFrame(rt_uint64_t frame)
+{
+    if (HV57708_TubePowerStatus() == 0)
+        return;
+
+    HV57708_ShowFrame(frame);
+}
+
+/*******************************************************************************
+  * @brief  结束临时画面, 最外层结束时恢复应用显示的内容. 只在线程中调用
+  * @param  None
+  * @retval None
+*******************************************************************************/
+void HV57708_OverlayEnd(void)
+{
+    rt_base_t level;
+    rt_uint8_t depth;
+
+    level = rt_hw_interrupt_disable();
+    if (hv_overlay > 0)
+        hv_overlay--;
+    depth = hv_overlay;
+    rt_hw_interrupt_enable(level);
+
+    if (depth == 0)
+        HV57708_OverlayFrame(hv_content);
+}
+
+/*******************************************************************************
+  * @brief  不等待总线的 HV57708_OverlayFrame, 供软件定时器回调使用.
+  *         其他线程占用移位线时 (例如 HV57708_Scan) 立即返回, 不阻塞定时器线程
+  * @param  frame - 64 位帧
+  * @retval RT_EOK: 已提交, -RT_EBUSY: 总线被占用, 未显示
+*******************************************************************************/
+rt_err_t HV57708_OverlayTryFrame(rt_uint64_t frame)
+{
+    if (rt_mutex_take(&hv_bus.lock, 0) != RT_EOK)
+        return -RT_EBUSY;
+
+    HV57708_OverlayFrame(frame);
+    rt_mutex_release(&hv_bus.lock);
+
+    return RT_EOK;
+}
+
+/*******************************************************************************
+  * @brief  不等待总线的 HV57708_OverlayEnd, 总线被占用时不结束临时画面,
+  *         由调用者稍后重试
+  * @param  None
+  * @retval RT_EOK: 已结束, -RT_EBUSY: 总线被占用
+*******************************************************************************/
+rt_err_t HV57708_OverlayTryEnd(void)
+{
+    if (rt_mutex_take(&hv_bus.lock, 0) != RT_EOK)
+        return -RT_EBUSY;
+
+    HV57708_OverlayEnd();
+    rt_mutex_release(&hv_bus.lock);
+
+    return RT_EOK;
+}
+
+/*******************************************************************************
+  * @brief  结算上一帧的点亮时间并记录新锁存的帧
+  * @param  frame - 新锁存的帧
+  * @retval None
+*******************************************************************************/
+static void HV57708_Account(rt_uint64_t frame)
+{
+    rt_uint32_t half;
+    rt_tick_t now, elapsed;
+    rt_base_t level;
+    int bit;
+
+    level = rt_hw_interrupt_disable();
+    now = rt_tick_get();
+    elapsed = now - hv_usage.since;
+
+    /* 每帧点亮的输出很少, 只遍历置位的位 */
+    half = (rt_uint32_t)hv_usage.frame;
+    while ((bit = __rt_ffs(half)) != 0)
+    {
+        hv_usage.lit[bit - 1] += elapsed;
+        half &= half - 1;
+    }
+    half = (rt_uint32_t)(hv_usage.frame >> 32);
+    while ((bit = __rt_ffs(half)) != 0)
+    {
+        hv_usage.lit[bit + 31] += elapsed;
+        half &= half - 1;
+    }
+
+    hv_usage.frame = frame;
+    hv_usage.since = now;
+    rt_hw_interrupt_enable(level);
+}
+
+/*******************************************************************************
+  * @brief  每个管选出累计点亮时间最短的阴极组成一帧
+  * @param  None
+  * @retval 64 位帧
+*******************************************************************************/
+static rt_uint64_t HV57708_LeastUsedFrame(void)
+{
+    rt_uint64_t frame = 0;
+    rt_uint8_t t, d, min;
+
+    for (t = 0; t < HV57708_TUBE_NUM; t++)
+    {
+        min = 0;
+        for (d = 1; d < 10; d++)
+        {
+            if (hv_usage.lit[HV57708_CATHODE_BIT(t, d)] < hv_usage.lit[HV57708_CATHODE_BIT(t, min)])
+                min = d;
+        }
+        frame |= digit_lut[t][min];
+    }
+
+    return frame;
+}
+
+/*******************************************************************************
+  * @brief  开始一次阴极保护, 以临时画面显示, 由定时器回调推进和结束
+  * @param  sweep - RT_TRUE: 依次显示全部数字, RT_FALSE: 点亮最少使用的阴极
+  * @retval None
+*******************************************************************************/
+static void HV57708_ProtectStart(rt_bool_t sweep)
+{
+    rt_uint8_t data[HV57708_TUBE_NUM];
+    rt_tick_t ticks;
+    rt_base_t level;
+
+    level = rt_hw_interrupt_disable();
+    if (hv_protect.busy)
+    {
+        rt_hw_interrupt_enable(level);
+        return;
+    }
+    hv_protect.busy = RT_TRUE;
+    hv_protect.last = rt_tick_get();
+    rt_hw_interrupt_enable(level);
+
+    hv_protect.sweep = sweep;
+    hv_protect.step = 0;
+
+    HV57708_OverlayBegin();
+    if (sweep)
+    {
+        rt_memset(data, 0, sizeof(data));
+        HV57708_OverlayFrame(HV57708_Encode(data));
+        ticks = HV57708_PROTECT_SWEEP_TICKS;
+    }
+    else
+    {
+        HV57708_OverlayFrame(HV57708_LeastUsedFrame());
+        ticks = HV57708_PROTECT_TICKS;
+    }
+
+    rt_timer_control(&hv_protect.timer, RT_TIMER_CTRL_SET_TIME, &ticks);
+    rt_timer_start(&hv_protect.timer);
+}
+
+/*******************************************************************************
+  * @brief  阴极保护定时器回调, 扫描时切换到下一个数字, 结束时恢复显示.
+  *         在定时器线程中运行, 不等待总线: 移位线被占用时跳过这个数字,
+  *         恢复显示推迟到下一个周期
+  * @param  parameter - 未使用
+  * @retval None
+*******************************************************************************/
+static void HV57708_ProtectTimeout(void *parameter)
+{
+    rt_uint8_t data[HV57708_TUBE_NUM];
+
+    if (hv_protect.sweep && hv_protect.step < 9)
+    {
+        hv_protect.step++;
+        rt_memset(data, hv_protect.step, sizeof(data));
+        HV57708_OverlayTryFrame(HV57708_Encode(data));
+        rt_timer_start(&hv_protect.timer);
+        return;
+    }
+
+    if (HV57708_OverlayTryEnd() != RT_EOK)
+    {
+        rt_timer_start(&hv_protect.timer);
+        return;
+    }
+    hv_protect.busy = RT_FALSE;
+}
+
+/*******************************************************************************
+  * @brief  数字变化时检查是否到了保护时间, 此时画面本来就在变化, 短暂点亮
+  *         其他阴极不易察觉
+  * @param  None
+  * @retval None
+*******************************************************************************/
+static void HV57708_ProtectPoll(void)
+{
+    if (!hv_protect.enable || hv_overlay != 0)
+        return;
+
+    if (rt_tick_get() - hv_protect.last < HV57708_PROTECT_PERIOD)
+        return;
+
+    HV57708_ProtectStart(RT_FALSE);
+}
+
+/*******************************************************************************
+  * @brief  阴极保护, 顺序输出一遍所有数字后恢复原来的显示.
+  *         由定时器推进, 函数立即返回
+  * @param  None
+  * @retval None
+*******************************************************************************/
+void HV57708_Protection(void)
+{
+    if (HV57708_TubePowerStatus() == 0)
+        return;
+
+    HV57708_ProtectStart(RT_TRUE);
+}
+
+/*******************************************************************************
+  * @brief  开关自动阴极保护
+  * @param  enable - RT_TRUE 开启
+  * @retval None
+*******************************************************************************/
+void HV57708_ProtectionSchedule(rt_bool_t enable)
+{
+    hv_protect.enable = enable;
+}
+
+/*******************************************************************************
+  * @brief  获取某个阴极的累计点亮时间
+  * @param  tube - 0 ~ 5 表示辉光管从左到右
+  * @param  digit - 0 ~ 9
+  * @retval 秒
+*******************************************************************************/
+rt_uint32_t HV57708_GetUsage(rt_uint8_t tube, rt_uint8_t digit)
+{
+    rt_uint64_t lit;
+    rt_uint8_t bit;
+    rt_base_t level;
+
+    if (tube >= HV57708_TUBE_NUM || digit > 9)
+        return 0;
+
+    bit = HV57708_CATHODE_BIT(tube, digit);
+    level = rt_hw_interrupt_disable();
+    lit = hv_usage.lit[bit];
+    if (hv_usage.frame & ((rt_uint64_t)1 << bit))
+        lit += rt_tick_get() - hv_usage.since;
+    rt_hw_interrupt_enable(level);
+
+    return (rt_uint32_t)(lit / RT_TICK_PER_SECOND);
+}
+
+/*******************************************************************************
+  * @brief  获取帧统计
+  * @param  stats - 指向存放统计的结构体
+  * @retval None
+*******************************************************************************/
+void HV57708_GetStats(HV57708_Stats *stats)
+{
+    rt_base_t level;
+
+    if (stats == NULL)
+        return;
+
+    level = rt_hw_interrupt_disable();
+    *stats = hv_shadow.stats;
+    rt_hw_interrupt_enable(level);
+}
+
+/*******************************************************************************
+  * @brief  清零帧统计
+  * @param  None
+  * @retval None
+*******************************************************************************/
+void HV57708_ResetStats(void)
+{
+    rt_base_t level;
+
+    level = rt_hw_interrupt_disable();
+    rt_memset(&hv_shadow.stats, 0, sizeof(hv_shadow.stats));
+    rt_hw_interrupt_enable(level);
+}
+
+/*******************************************************************************
+  * @brief  依次设置 1 ~ 64 引脚输出高电平
+  * @param  None
+  * @retval None
+*******************************************************************************/
+void HV57708_Scan(void)
+{
+    rt_uint32_t part1=0x00000000, part2=0x00000000;
+#ifdef HV57708_USING_PWM
+    if (hv_pwm.running)
+    {
+        rt_kprintf("stop dimming before scanning\n");
+        return;
+    }
+#endif
+    HV57708_BusTake();
+    for (int i = 0; i < 32; i++)
+    {
+        part1=0x00000000;
+        part2=0x00000000;
+        part1 |= (1 << i);
+        HV57708_SendData(part2, part1);
+        HV57708_OutputData();
+    }
+    for (int i = 0; i < 32; i++)
+    {
+        part1=0x00000000;
+        part2=0x00000000;
+        part1 |= (1 << i);
+        HV57708_SendData(part2, part1);
+        HV57708_OutputData();
+        rt_thread_mdelay(500);
+    }
+    for (int i = 0; i < 32; i++)
+    {
+        part1=0x00000000;
+        part2=0x00000000;
+        part2 |= (1 << i);
+        HV57708_SendData(part2, part1);
+        HV57708_OutputData();
+        rt_thread_mdelay(500);
+    }
+    hv_shadow.valid = RT_FALSE; // 绕过了 HV57708_ShowFrame
+    hv_fb.preshifted = RT_FALSE;
+    HV57708_BusRelease();
+}
+
+/*******************************************************************************
+  * @brief  设置某个引脚输出高电平
+  * @param  pin - 要输出高电平的引脚(1 ~ 64)
+  * @retval None
+*******************************************************************************/
+void HV57708_SetPin(rt_uint8_t pin)
+{
+    rt_uint32_t temp = 0x00000000;
+    if (pin > 64)
+        return;
+    if (pin <= 32)
+    {
+        temp |= (1 << (pin-1));
+        HV57708_ShowFrame(temp);
+    }
+    else
+    {
+        temp |= (1 << (pin-33));
+        HV57708_ShowFrame((rt_uint64_t)temp << 32);
+    }
+}
+
+/*******************************************************************************
+  * @brief  比较 rt_pin_write 实现与端口寄存器实现发送一帧所需的时钟周期,
+  *         只移位不锁存, 不影响当前显示
+  * @param  None
+  * @retval None
+*******************************************************************************/
+void HV57708_Benchmark(void)
+{
+    rt_uint32_t pin_sum = 0, pin_min = RT_UINT32_MAX;
+    rt_uint32_t port_sum = 0, port_min = RT_UINT32_MAX;
+    rt_uint32_t part2 = 0x12345678, part1 = 0x9ABCDEF0;
+    rt_uint32_t start, cycles;
+    rt_base_t level;
+    rt_uint8_t i;
+
+    HV57708_BusTake();
+    DWT_CycleInit();
+
+    for (i = 0; i < HV57708_BENCH_FRAMES; i++)
+    {
+        level = rt_hw_interrupt_disable();
+        start = DWT_CycleGet();
+        HV57708_SendData_Pin(part2, part1);
+        cycles = DWT_CycleGet() - start;
+        rt_hw_interrupt_enable(level);
+        pin_sum += cycles;
+        if (cycles < pin_min)
+            pin_min = cycles;
+
+        level = rt_hw_interrupt_disable();
+        start = DWT_CycleGet();
+        HV57708_ShiftWord(part2);
+        HV57708_ShiftWord(part1);
+        cycles = DWT_CycleGet() - start;
+        rt_hw_interrupt_enable(level);
+        port_sum += cycles;
+        if (cycles < port_min)
+            port_min = cycles;
+
+        /* 换一组数据, 让两种实现都覆盖不同的电平组合 */
+        part2 = part2 * 1664525 + 1013904223;
+        part1 = part1 * 1664525 + 1013904223;
+    }
+
+    hv_fb.preshifted = RT_FALSE; // 移位寄存器已被改写
+    HV57708_BusRelease();
+
+    rt_kprintf("hv57708 shift 64 bits, %d frames:\n", HV57708_BENCH_FRAMES);
+    rt_kprintf("rt_pin_write: avg %u cycles (%u ns), min %u cycles\n",
+               pin_sum / HV57708_BENCH_FRAMES,
+               DWT_CycleToNs(pin_sum / HV57708_BENCH_FRAMES), pin_min);
+    rt_kprintf("port BSRR:    avg %u cycles (%u ns), min %u cycles\n",
+               port_sum / HV57708_BENCH_FRAMES,
+               DWT_CycleToNs(port_sum / HV57708_BENCH_FRAMES), port_min);
+}
+
+/*******************************************************************************
+  * @brief  遍历全部 10^6 种数字组合, 比较查表编码与逐位拼接编码的
+  *         结果和耗时. 只在默认接线下两者等价
+  * @param  None
+  * @retval None
+*******************************************************************************/
+void HV57708_BenchEncode(void)
+{
+    rt_uint8_t data[HV57708_TUBE_NUM] = {0};
+    rt_uint32_t lut_cycles = 0, ref_cycles = 0;
+    rt_uint32_t mismatch = 0, count = 0;
+    rt_uint32_t start;
+    rt_uint64_t lut, ref;
+    rt_uint8_t i;
+
+    DWT_CycleInit();
+
+    do
+    {
+        start = DWT_CycleGet();
+        lut = HV57708_Encode(data);
+        lut_cycles += DWT_CycleGet() - start;
+
+        start = DWT_CycleGet();
+        ref = HV57708_EncodeRef(data);
+        ref_cycles += DWT_CycleGet() - start;
+
+        if (lut != ref)
+        {
+            if (mismatch++ == 0)
+                rt_kprintf("first mismatch: %d%d%d%d%d%d\n",
+                           data[0], data[1], data[2], data[3], data[4], data[5]);
+        }
+        count++;
+
+        /* 六位十进制计数, 进位到最高位之外时结束 */
+        for (i = 0; i < HV57708_TUBE_NUM; i++)
+        {
+            if (++data[i] < 10)
+                break;
+            data[i] = 0;
+        }
+    } while (i < HV57708_TUBE_NUM);
+
+    rt_kprintf("hv57708 encode %u frames, %u mismatch\n", count, mismatch);
+    rt_kprintf("lookup table: avg %u cycles\n", lut_cycles / count);
+    rt_kprintf("bit shifting: avg %u cycles\n", ref_cycles / count);
+}
+
+/*******************************************************************************
+  * @brief  比较固定编码加移位与布局表编码加整链移位的耗时, 只移位不锁存
+  * @param  None
+  * @retval None
+*******************************************************************************/
+void HV57708_BenchLayout(void)
+{
+    rt_uint8_t data[HV57708_TUBE_NUM] = {1, 2, 3, 4, 5, 6};
+    rt_uint8_t values[32];
+    rt_uint64_t frame[HV57708_CHIP_NUM];
+    rt_uint64_t fixed;
+    rt_uint32_t fixed_cycles = 0, layout_cycles = 0;
+    rt_uint32_t start;
+    rt_base_t level;
+    rt_uint8_t i;
+
+    RT_ASSERT(hv57708_layout_num <= sizeof(values));
+
+    /* 数字管显示同样的数字, 其余元件全亮 */
+    rt_memset(values, 0xFF, sizeof(values));
+    rt_memcpy(values, data, sizeof(data));
+
+    HV57708_BusTake();
+    DWT_CycleInit();
+
+    for (i = 0; i < HV57708_BENCH_FRAMES; i++)
+    {
+        level = rt_hw_interrupt_disable();
+        start = DWT_CycleGet();
+        fixed = HV57708_Encode(data);
+        HV57708_SendData((rt_uint32_t)(fixed >> 32), (rt_uint32_t)fixed);
+        fixed_cycles += DWT_CycleGet() - start;
+
+        start = DWT_CycleGet();
+        HV57708_LayoutEncode(values, frame);
+        HV57708_ChainSend(frame);
+        layout_cycles += DWT_CycleGet() - start;
+        rt_hw_interrupt_enable(level);
+    }
+
+    hv_fb.preshifted = RT_FALSE; // 移位寄存器已被改写
+    HV57708_BusRelease();
+
+    rt_kprintf("hv57708 encode and shift, %d frames:\n", HV57708_BENCH_FRAMES);
+    rt_kprintf("fixed 1 chip:      avg %u cycles\n", fixed_cycles / HV57708_BENCH_FRAMES);
+    rt_kprintf("layout %d chip(s): avg %u cycles, %d elements\n", HV57708_CHIP_NUM,
+               layout_cycles / HV57708_BENCH_FRAMES, hv57708_layout_num);
 }
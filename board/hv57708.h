@@ -20,8 +20,42 @@
 /* Includes ------------------------------------------------------------------*/
 #include <drv_common.h>
 /* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+    rt_uint32_t submitted;  /* 提交显示的帧数 */
+    rt_uint32_t shifted;    /* 实际移位并锁存的帧数 */
+    rt_uint32_t skipped;    /* 与已锁存的帧相同而跳过的帧数 */
+} HV57708_Stats;
+
+/* 布局表中的一个阴极: 第 chip 片 HV57708 的第 channel 个输出 (0 ~ 63) */
+typedef struct
+{
+    rt_uint8_t chip;
+    rt_uint8_t channel;
+} HV57708_Pin;
+
+/* 布局表中的一个元件: 数字管, 指示灯, 冒号氖泡等 */
+typedef struct
+{
+    rt_uint8_t type;            /* HV57708_ELEM_DIGIT / HV57708_ELEM_MASK */
+    rt_uint8_t count;           /* 阴极数 */
+    const HV57708_Pin *pins;
+} HV57708_Element;
+
+/* 合成显示的一层, 各层在一次遍历中合并:
+   DIGITS 与 BITS 层的点亮位相或, BLANK 层的位相或后统一清除 */
+typedef struct
+{
+    rt_uint8_t type;            /* HV57708_LAYER_DIGITS / BITS / BLANK */
+    const rt_uint8_t *digits;   /* DIGITS 层: HV57708_TUBE_NUM 个数字, 大于 9 不亮 */
+    rt_uint64_t bits;           /* BITS 层: 点亮的位, BLANK 层: 熄灭的位 */
+} HV57708_Layer;
 
 /* Exported constants --------------------------------------------------------*/
+/* 布局表, 在 hv57708_layout.c 中按板子的接线定义 */
+extern const HV57708_Element hv57708_layout[];
+extern const rt_uint8_t hv57708_layout_num;
+
 /* Exported macro ------------------------------------------------------------*/
 /* Exported define -----------------------------------------------------------*/
 
@@ -34,6 +68,11 @@
 #define HV57708_DI4         28
 #define HV57708_SW          19
 
+/* 仿真后端: 定义此宏则所有引脚操作都改为驱动 hv57708_sim.c 中的软件模型,
+   不访问 GPIO, 用于在没有辉光管的情况下验证移位时序和锁存结果 */
+// #define HV57708_USING_SIM
+
+#ifndef HV57708_USING_SIM
 #define HV57708_CLK_H       rt_pin_write(HV57708_CLK, PIN_HIGH)
 #define HV57708_LE_H        rt_pin_write(HV57708_LE, PIN_HIGH)
 #define HV57708_POL_H       rt_pin_write(HV57708_POL, PIN_HIGH)
@@ -49,6 +88,123 @@
 #define HV57708_DIN2_L      rt_pin_write(HV57708_DI2, PIN_LOW)
 #define HV57708_DIN3_L      rt_pin_write(HV57708_DI3, PIN_LOW)
 #define HV57708_DIN4_L      rt_pin_write(HV57708_DI4, PIN_LOW)
+#else
+#define HV57708_CLK_H       HV57708_SimPin(HV57708_CLK, PIN_HIGH)
+#define HV57708_LE_H        HV57708_SimPin(HV57708_LE, PIN_HIGH)
+#define HV57708_POL_H       HV57708_SimPin(HV57708_POL, PIN_HIGH)
+#define HV57708_DIN1_H      HV57708_SimPin(HV57708_DI1, PIN_HIGH)
+#define HV57708_DIN2_H      HV57708_SimPin(HV57708_DI2, PIN_HIGH)
+#define HV57708_DIN3_H      HV57708_SimPin(HV57708_DI3, PIN_HIGH)
+#define HV57708_DIN4_H      HV57708_SimPin(HV57708_DI4, PIN_HIGH)
+
+#define HV57708_CLK_L       HV57708_SimPin(HV57708_CLK, PIN_LOW)
+#define HV57708_LE_L        HV57708_SimPin(HV57708_LE, PIN_LOW)
+#define HV57708_POL_L       HV57708_SimPin(HV57708_POL, PIN_LOW)
+#define HV57708_DIN1_L      HV57708_SimPin(HV57708_DI1, PIN_LOW)
+#define HV57708_DIN2_L      HV57708_SimPin(HV57708_DI2, PIN_LOW)
+#define HV57708_DIN3_L      HV57708_SimPin(HV57708_DI3, PIN_LOW)
+#define HV57708_DIN4_L      HV57708_SimPin(HV57708_DI4, PIN_LOW)
+#endif
+
+/* 快速移位使用的端口寄存器:
+   DIN4 ~ DIN1 依次为 PB12 ~ PB15, CLK 为 PC11, LE 为 PC12 */
+#define HV57708_DIN_PORT    GPIOB
+#define HV57708_DIN_MASK    (GPIO_PIN_12 | GPIO_PIN_13 | GPIO_PIN_14 | GPIO_PIN_15)
+#define HV57708_CTRL_PORT   GPIOC
+#define HV57708_CLK_MASK    GPIO_PIN_11
+#define HV57708_LE_MASK     GPIO_PIN_12
+#define HV57708_DIN_PIN_BASE    16  /* PB0 的引脚编号 */
+#define HV57708_CTRL_PIN_BASE   32  /* PC0 的引脚编号 */
+
+#if defined(HV57708_DIN_WRITE)
+/* 端口访问已在包含本文件之前定义, 例如主机测试中记录写入的模拟端口 */
+#elif !defined(HV57708_USING_SIM)
+#define HV57708_DIN_WRITE(bsrr)     (HV57708_DIN_PORT->BSRR = (bsrr))
+#define HV57708_CTRL_SET(mask)      (HV57708_CTRL_PORT->BSRR = (mask))
+#define HV57708_CTRL_RESET(mask)    (HV57708_CTRL_PORT->BRR = (mask))
+#define HV57708_SW_WRITE(level)     rt_pin_write(HV57708_SW, level)
+#define HV57708_SW_READ()           rt_pin_read(HV57708_SW)
+#else
+#define HV57708_DIN_WRITE(bsrr)     HV57708_SimPort(HV57708_DIN_PIN_BASE, (bsrr))
+#define HV57708_CTRL_SET(mask)      HV57708_SimPort(HV57708_CTRL_PIN_BASE, (mask))
+#define HV57708_CTRL_RESET(mask)    HV57708_SimPort(HV57708_CTRL_PIN_BASE, (rt_uint32_t)(mask) << 16)
+#define HV57708_SW_WRITE(level)     HV57708_SimPin(HV57708_SW, level)
+#define HV57708_SW_READ()           HV57708_SimRead(HV57708_SW)
+#endif
+
+/* 辉光管接线: 从左到右第 t 个管显示数字 d 时点亮的 HV57708 输出位 (0 ~ 63),
+   换用不同接线的板子只需修改此宏, 编码表在编译期由它生成 */
+#define HV57708_TUBE_NUM            6
+#define HV57708_CATHODE_BIT(t, d)   ((t) * 10 + ((d) == 0 ? 9 : (d) - 1))
+
+/* 第 t 个管全部阴极的掩码, 用于 BLANK 层熄灭整个管 */
+#define HV57708_CATHODE_MASK(t, d)  ((rt_uint64_t)1 << HV57708_CATHODE_BIT(t, d))
+#define HV57708_TUBE_MASK(t)        (HV57708_CATHODE_MASK(t, 0) | HV57708_CATHODE_MASK(t, 1) | \
+                                     HV57708_CATHODE_MASK(t, 2) | HV57708_CATHODE_MASK(t, 3) | \
+                                     HV57708_CATHODE_MASK(t, 4) | HV57708_CATHODE_MASK(t, 5) | \
+                                     HV57708_CATHODE_MASK(t, 6) | HV57708_CATHODE_MASK(t, 7) | \
+                                     HV57708_CATHODE_MASK(t, 8) | HV57708_CATHODE_MASK(t, 9))
+
+/* 备用输出 60 ~ 63, 可接冒号氖泡或指示灯, 用于 BITS 层 */
+#define HV57708_SPARE_NUM           4
+#define HV57708_SPARE_BIT(i)        ((rt_uint64_t)1 << (60 + (i)))
+#define HV57708_SPARE_MASK          ((rt_uint64_t)0xF << 60)
+
+/* 级联的芯片数, 第 0 片的 DIN 接 MCU, 第 k 片的 DOUT 接第 k+1 片的 DIN.
+   大于 1 时只能通过 HV57708_DisplayLayout 显示, 其余接口按单片处理 */
+#define HV57708_CHIP_NUM            1
+
+/* 元件类型 */
+#define HV57708_ELEM_DIGIT          0   /* 数值 v 点亮 pins[v], 超出范围不亮 */
+#define HV57708_ELEM_MASK           1   /* 数值的第 i 位点亮 pins[i] */
+
+/* 合成层类型 */
+#define HV57708_LAYER_DIGITS        0
+#define HV57708_LAYER_BITS          1
+#define HV57708_LAYER_BLANK         2
+
+/* 阴极保护调度: 数字变化时, 若距上次保护已超过 PERIOD, 给每个管点亮一次
+   累计点亮时间最短的阴极, 持续 TICKS 后恢复 */
+#define HV57708_PROTECT_PERIOD      (RT_TICK_PER_SECOND * 15)
+#define HV57708_PROTECT_TICKS       (RT_TICK_PER_SECOND / 50)
+#define HV57708_PROTECT_SWEEP_TICKS 75  /* HV57708_Protection 每个数字的停留时间 */
+
+/* 定义此宏则 HV57708_SendData 退回到逐个调用 rt_pin_write 的实现 */
+// #define HV57708_USING_PIN_API
+
+/* 使用硬件定时器中断逐拍移位, 每拍移入 4 位, 16 拍后产生锁存脉冲,
+   HV57708_Display 提交后立即返回. 需要在 menuconfig 中使能对应的定时器 */
+#ifdef BSP_USING_TIM4
+#define HV57708_USING_ASYNC
+#define HV57708_ASYNC_TIMER     "timer4"
+#define HV57708_ASYNC_TICK_US   10      /* 每拍间隔, 一帧约 17 拍 */
+#endif
+
+/* 软件 PWM 调光: 定时器中断按亮度在点亮与熄灭的帧之间切换,
+   每个刷新周期分为 HV57708_PWM_LEVELS 个时隙, 必须是 2 的幂 */
+#ifdef BSP_USING_TIM5
+#define HV57708_USING_PWM
+#define HV57708_PWM_TIMER       "timer5"
+#define HV57708_PWM_LEVELS      64
+#define HV57708_PWM_REFRESH     100     /* 默认刷新率, Hz */
+/* 刷新率范围: 上限时中断为 25.6kHz, 时隙 39us, 仍能容纳一次移位锁存
+   和中断进出的开销; 低于下限会闪烁 */
+#define HV57708_PWM_REFRESH_MIN 50
+#define HV57708_PWM_REFRESH_MAX 400
+#endif
+
+/* 电源占空比调光: HV57708_SW (PB3) 复用为 TIM2_CH2 (部分重映射 1),
+   由 PWM 设备开关高压电源, 见 hv57708_dim.c. 需要在 menuconfig 中使能 PWM2 通道 2 */
+#ifdef BSP_USING_PWM2_CH2
+#define HV57708_USING_DIM
+#define HV57708_DIM_PWM         "pwm2"
+#define HV57708_DIM_CH          2
+#define HV57708_DIM_PERIOD      2000000 /* PWM 周期, ns, 即 500Hz */
+#endif
+
+#ifdef HV57708_USING_SIM
+#include "hv57708_sim.h"
+#endif
 
 /* Exported functions ------------------------------------------------------- */
 void HV57708_Init(void);
@@ -56,10 +212,47 @@ void HV57708_TubePower(rt_base_t NewState);
 rt_base_t HV57708_TubePowerStatus(void);
 void HV57708_SendData(uint32_t datapart2, uint32_t datapart1);
 void HV57708_OutputData(void);
+#ifdef HV57708_USING_ASYNC
+rt_err_t HV57708_SendFrameAsync(rt_uint32_t datapart2, rt_uint32_t datapart1);
+rt_err_t HV57708_WaitFrame(rt_int32_t timeout);
+#endif
 void HV57708_Display(unsigned char data[]);
+rt_uint64_t HV57708_Encode(const rt_uint8_t data[]);
+void HV57708_DisplayRaw(rt_uint64_t frame);
+rt_uint64_t HV57708_Compose(const HV57708_Layer layers[], rt_uint8_t num);
+void HV57708_DisplayLayers(const HV57708_Layer layers[], rt_uint8_t num);
+void HV57708_LayoutEncode(const rt_uint8_t values[], rt_uint64_t frame[]);
+void HV57708_ChainSend(const rt_uint64_t frame[]);
+void HV57708_DisplayLayout(const rt_uint8_t values[]);
+void HV57708_OverlayBegin(void);
+void HV57708_OverlayFrame(rt_uint64_t frame);
+void HV57708_OverlayEnd(void);
+rt_err_t HV57708_OverlayTryFrame(rt_uint64_t frame);
+rt_err_t HV57708_OverlayTryEnd(void);
 void HV57708_Protection(void);
+void HV57708_ProtectionSchedule(rt_bool_t enable);
+rt_uint32_t HV57708_GetUsage(rt_uint8_t tube, rt_uint8_t digit);
+/* 双缓冲: 随时渲染到后缓冲并预先移位, 在 DS3231 1Hz SQW 下降沿只产生锁存脉冲.
+   与 HV57708_Display 共用总线锁, 不会交错移位, 但后显示的会覆盖先显示的 */
+void HV57708_FbRender(rt_uint8_t data[]);
+void HV57708_FbEdge(void);
+void HV57708_FbSetLatchHook(void (*hook)(rt_uint32_t ns));
+void HV57708_FbGetLatency(rt_uint32_t *last_ns, rt_uint32_t *max_ns);
+#ifdef HV57708_USING_PWM
+/* 调光期间由定时器中断独占总线, HV57708_Display 只更新显示内容 */
+rt_err_t HV57708_PwmStart(rt_uint32_t refresh_hz);
+void HV57708_PwmStop(void);
+void HV57708_SetBrightness(rt_uint8_t tube, rt_uint8_t level);
+rt_uint8_t HV57708_GetBrightness(rt_uint8_t tube);
+void HV57708_PwmMeasure(void);
+#endif
+void HV57708_GetStats(HV57708_Stats *stats);
+void HV57708_ResetStats(void);
 /*测试用*/
 void HV57708_Scan(void);
 void HV57708_SetPin(uint8_t pin);
+void HV57708_Benchmark(void);
+void HV57708_BenchLayout(void);
+void HV57708_BenchEncode(void);
 
 #endif /* __HV57708_H */
@@ -0,0 +1,278 @@
+/*******************************************************************************
+* @file     --> hv57708_anim.c
+* @version  --> 1.0
+* @brief    --> 辉光管数字切换动画
+*               切换时先在调用者线程中把整段动画预先生成为帧序列:
+*               不同的帧存入 frames[], 每一步只记录帧序号和停留的 tick,
+*               再由 1 tick 周期的软件定时器回调逐步播放,
+*               回调在定时器线程中运行, 只做一次查表和一次显示, 耗时固定.
+*               显示需要移位和统计, 不放在 SysTick 中断里
+*******************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include "hv57708_anim.h"
+#include "dwt_cycle.h"
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+    rt_uint8_t frame;   /* frames[] 中的序号 */
+    rt_uint8_t ticks;   /* 停留时间 */
+} anim_step;
+
+/* Private variables ---------------------------------------------------------*/
+static struct
+{
+    struct rt_timer timer;
+    rt_uint64_t frames[HV57708_ANIM_MAX_FRAMES];
+    anim_step steps[HV57708_ANIM_MAX_STEPS];
+    rt_uint8_t frame_num;
+    rt_uint8_t step_num;
+    rt_uint8_t pos;
+    rt_uint8_t remaining;
+    rt_uint8_t last[HV57708_TUBE_NUM];  /* 当前显示的数字 */
+    volatile rt_bool_t playing;
+    rt_bool_t inited;
+    rt_uint32_t build_ns;               /* 最近一次生成动画的耗时 */
+    rt_uint32_t tick_max_ns;            /* 定时器回调的最大耗时 */
+} hv_anim;
+
+/* Private functions ---------------------------------------------------------*/
+
+/* 追加一步, 相同的帧只保存一次 */
+static rt_err_t anim_push(rt_uint64_t frame, rt_uint8_t ticks)
+{
+    rt_uint8_t i;
+
+    if (hv_anim.step_num >= HV57708_ANIM_MAX_STEPS)
+        return -RT_EFULL;
+
+    for (i = 0; i < hv_anim.frame_num; i++)
+    {
+        if (hv_anim.frames[i] == frame)
+            break;
+    }
+    if (i == hv_anim.frame_num)
+    {
+        if (hv_anim.frame_num >= HV57708_ANIM_MAX_FRAMES)
+            return -RT_EFULL;
+        hv_anim.frames[hv_anim.frame_num++] = frame;
+    }
+
+    hv_anim.steps[hv_anim.step_num].frame = i;
+    hv_anim.steps[hv_anim.step_num].ticks = ticks;
+    hv_anim.step_num++;
+
+    return RT_EOK;
+}
+
+/* 渐变: 每 HV57708_ANIM_FADE_LEVELS 个 tick 中新数字占 lvl 个 */
+static rt_err_t anim_build_fade(const rt_uint8_t from[], const rt_uint8_t to[])
+{
+    rt_uint64_t old_frame = HV57708_Encode(from);
+    rt_uint64_t new_frame = HV57708_Encode(to);
+    rt_uint8_t lvl, r;
+    rt_err_t ret;
+
+    for (lvl = 1; lvl < HV57708_ANIM_FADE_LEVELS; lvl++)
+    {
+        for (r = 0; r < HV57708_ANIM_FADE_REPEAT; r++)
+        {
+            ret = anim_push(old_frame, HV57708_ANIM_FADE_LEVELS - lvl);
+            if (ret != RT_EOK)
+                return ret;
+            ret = anim_push(new_frame, lvl);
+            if (ret != RT_EOK)
+                return ret;
+        }
+    }
+
+    return anim_push(new_frame, 1);
+}
+
+/* 滚动步数: 先转一整圈再停在新数字上, 数字不变则不滚动 */
+static rt_uint8_t anim_roll_len(rt_uint8_t from, rt_uint8_t to)
+{
+    if (from == to)
+        return 0;
+    if (from > 9 || to > 9)
+        return 10;
+    return 10 + (to + 10 - from) % 10;
+}
+
+/* 滚动: 第 k 个变化的管在第 k * delay 步开始滚动, delay 为 0 则同时滚动 */
+static rt_err_t anim_build_roll(const rt_uint8_t from[], const rt_uint8_t to[], rt_uint8_t delay)
+{
+    rt_uint8_t start[HV57708_TUBE_NUM], len[HV57708_TUBE_NUM];
+    rt_uint8_t digits[HV57708_TUBE_NUM];
+    rt_uint8_t total = 0, k = 0;
+    rt_uint8_t s, t;
+    rt_err_t ret;
+
+    for (t = 0; t < HV57708_TUBE_NUM; t++)
+    {
+        len[t] = anim_roll_len(from[t], to[t]);
+        start[t] = (len[t] != 0) ? (k++ * delay) : 0;
+        if (start[t] + len[t] > total)
+            total = start[t] + len[t];
+    }
+
+    for (s = 0; s < total; s++)
+    {
+        for (t = 0; t < HV57708_TUBE_NUM; t++)
+        {
+            if (s < start[t])
+                digits[t] = from[t];
+            else if (s - start[t] >= len[t])
+                digits[t] = to[t];
+            else
+                digits[t] = ((from[t] > 9 ? 0 : from[t]) + s - start[t] + 1) % 10;
+        }
+        ret = anim_push(HV57708_Encode(digits), HV57708_ANIM_ROLL_TICKS);
+        if (ret != RT_EOK)
+            return ret;
+    }
+
+    return anim_push(HV57708_Encode(to), 1);
+}
+
+/* 定时器回调, 每 tick 一次, 在定时器线程中运行. 不等待总线:
+   其他线程占用移位线时跳过这一帧, 结束时下一 tick 重试 */
+static void anim_timeout(void *parameter)
+{
+    rt_uint32_t start = DWT_CycleGet();
+    rt_uint32_t ns;
+
+    if (--hv_anim.remaining == 0)
+    {
+        if (++hv_anim.pos >= hv_anim.step_num)
+        {
+            if (HV57708_OverlayTryEnd() == RT_EOK)
+            {
+                rt_timer_stop(&hv_anim.timer);
+                hv_anim.playing = RT_FALSE;
+            }
+            else
+            {
+                hv_anim.pos--;
+                hv_anim.remaining = 1;
+            }
+        }
+        else
+        {
+            hv_anim.remaining = hv_anim.steps[hv_anim.pos].ticks;
+            HV57708_OverlayTryFrame(hv_anim.frames[hv_anim.steps[hv_anim.pos].frame]);
+        }
+    }
+
+    ns = DWT_CycleToNs(DWT_CycleGet() - start);
+    if (ns > hv_anim.tick_max_ns)
+        hv_anim.tick_max_ns = ns;
+}
+
+/*******************************************************************************
+  * @brief  初始化动画定时器, 在 HV57708_Init 之后调用
+  * @param  None
+  * @retval RT_EOK
+*******************************************************************************/
+rt_err_t HV57708_AnimInit(void)
+{
+    if (hv_anim.inited)
+        return RT_EOK;
+
+    rt_memset(hv_anim.last, 0xFF, sizeof(hv_anim.last)); // 上电时全部不亮
+    rt_timer_init(&hv_anim.timer, "hv_anim", anim_timeout, RT_NULL, 1,
+                  RT_TIMER_FLAG_PERIODIC | RT_TIMER_FLAG_SOFT_TIMER);
+    DWT_CycleInit();
+    hv_anim.inited = RT_TRUE;
+
+    return RT_EOK;
+}
+
+/*******************************************************************************
+  * @brief  以动画切换到新的数字, 生成帧序列后立即返回.
+  *         正在播放时打断当前动画, 从其目标数字开始新的动画
+  * @param  data: data0 ~ data5 表示辉光管从左到右
+  * @param  effect - 动画效果
+  * @retval RT_EOK: 成功, -RT_EFULL: 动画超出长度, 已直接切换
+*******************************************************************************/
+rt_err_t HV57708_AnimDisplay(rt_uint8_t data[], HV57708_Effect effect)
+{
+    rt_uint32_t start = DWT_CycleGet();
+    rt_bool_t was_playing;
+    rt_base_t level;
+    rt_err_t ret = RT_EOK;
+
+    RT_ASSERT(data != NULL);
+
+    if (!hv_anim.inited)
+        effect = HV57708_ANIM_NONE;
+
+    if (hv_anim.inited)
+        rt_timer_stop(&hv_anim.timer);
+    level = rt_hw_interrupt_disable();
+    was_playing = hv_anim.playing;
+    hv_anim.playing = RT_FALSE;
+    rt_hw_interrupt_enable(level);
+
+    hv_anim.frame_num = 0;
+    hv_anim.step_num = 0;
+    switch (effect)
+    {
+        case HV57708_ANIM_CROSSFADE:
+            ret = anim_build_fade(hv_anim.last, data);
+            break;
+        case HV57708_ANIM_ROLL:
+            ret = anim_build_roll(hv_anim.last, data, 0);
+            break;
+        case HV57708_ANIM_CASCADE:
+            ret = anim_build_roll(hv_anim.last, data, HV57708_ANIM_CASCADE_DELAY);
+            break;
+        default:
+            break;
+    }
+    rt_memcpy(hv_anim.last, data, sizeof(hv_anim.last));
+
+    if (!was_playing)
+        HV57708_OverlayBegin();
+    HV57708_Display(data); // 只记录内容, 动画结束后显示
+
+    if (ret != RT_EOK || hv_anim.step_num == 0)
+    {
+        HV57708_OverlayEnd();
+        return ret;
+    }
+
+    hv_anim.pos = 0;
+    hv_anim.remaining = hv_anim.steps[0].ticks;
+    HV57708_OverlayFrame(hv_anim.frames[hv_anim.steps[0].frame]);
+    hv_anim.playing = RT_TRUE;
+    hv_anim.build_ns = DWT_CycleToNs(DWT_CycleGet() - start);
+    rt_timer_start(&hv_anim.timer);
+
+    return RT_EOK;
+}
+
+/*******************************************************************************
+  * @brief  是否正在播放动画
+  * @param  None
+  * @retval RT_TRUE 正在播放
+*******************************************************************************/
+rt_bool_t HV57708_AnimBusy(void)
+{
+    return hv_anim.playing;
+}
+
+/*******************************************************************************
+  * @brief  获取动画的 CPU 耗时
+  * @param  build_ns - 最近一次生成帧序列的耗时, 在调用者线程中, 可为 RT_NULL
+  * @param  tick_max_ns - 定时器回调的最大耗时, 在定时器线程中, 可为 RT_NULL
+  * @retval None
+*******************************************************************************/
+void HV57708_AnimGetCost(rt_uint32_t *build_ns, rt_uint32_t *tick_max_ns)
+{
+    if (build_ns != RT_NULL)
+        *build_ns = hv_anim.build_ns;
+    if (tick_max_ns != RT_NULL)
+        *tick_max_ns = hv_anim.tick_max_ns;
+}
@@ -0,0 +1,38 @@
+/*******************************************************************************
+* @file     --> hv57708_anim.h
+* @version  --> 1.0
+* @brief    --> 辉光管数字切换动画头文件
+*******************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __HV57708_ANIM_H
+#define __HV57708_ANIM_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "hv57708.h"
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum
+{
+    HV57708_ANIM_NONE,          /* 直接切换 */
+    HV57708_ANIM_CROSSFADE,     /* 新旧数字交替, 新数字占空比逐步增加 */
+    HV57708_ANIM_ROLL,          /* 变化的管同时滚动到新数字 */
+    HV57708_ANIM_CASCADE,       /* 变化的管从左到右依次滚动 */
+} HV57708_Effect;
+
+/* Exported define -----------------------------------------------------------*/
+#define HV57708_ANIM_MAX_FRAMES     32      /* 一段动画最多的不同帧 */
+#define HV57708_ANIM_MAX_STEPS      128     /* 一段动画最多的步数 */
+
+#define HV57708_ANIM_FADE_LEVELS    8       /* 渐变级数 */
+#define HV57708_ANIM_FADE_REPEAT    3       /* 每级重复次数 */
+#define HV57708_ANIM_ROLL_TICKS     25      /* 滚动时每个数字停留的 tick */
+#define HV57708_ANIM_CASCADE_DELAY  2       /* 相邻管开始滚动相隔的步数 */
+
+/* Exported functions ------------------------------------------------------- */
+rt_err_t HV57708_AnimInit(void);
+rt_err_t HV57708_AnimDisplay(rt_uint8_t data[], HV57708_Effect effect);
+rt_bool_t HV57708_AnimBusy(void);
+void HV57708_AnimGetCost(rt_uint32_t *build_ns, rt_uint32_t *tick_max_ns);
+
+#endif /* __HV57708_ANIM_H */
@@ -0,0 +1,377 @@
+/*******************************************************************************
+* @file     --> hv57708_dim.c
+* @version  --> 1.0
+* @brief    --> 辉光管电源占空比调光
+*               电源开关 HV57708_SW (PB3) 复用为 TIM2_CH2, 由 PWM 设备
+*               以固定周期开关高压电源, 整体亮度由占空比决定, 不占用 CPU.
+*               占空比为 0 或满量程时引脚切回普通输出, 直接关断或常开.
+*               调光线程按 RTC 时间查日程得到目标占空比, 每 20ms 向目标
+*               前进一步, 夜间自动降低亮度, 减少功耗和阴极损耗
+*******************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include <rtdevice.h>
+#include "hv57708_dim.h"
+#include "ds3231.h"
+#include "ds3231_cache.h"
+#include "ds3231_tz.h"
+
+#ifdef HV57708_USING_DIM
+
+/* Private define ------------------------------------------------------------*/
+#define DIM_THREAD_STACK        768
+#define DIM_THREAD_PRIORITY     24
+#define DIM_THREAD_TIMESLICE    5
+
+/* 每步的变化量 */
+#define DIM_STEP                (HV57708_DIM_MAX * HV57708_DIM_STEP_MS / HV57708_DIM_RAMP_MS)
+
+#define DIM_MINUTES(p)          ((p)->hour * 60 + (p)->minute)
+
+/* Private variables ---------------------------------------------------------*/
+/* 默认日程: 白天全亮, 夜间降低亮度 */
+static const HV57708_DimPoint dim_default[] =
+{
+    {0,  30, 150},
+    {7,  0,  HV57708_DIM_MAX},
+    {22, 0,  400},
+};
+
+static struct
+{
+    struct rt_device_pwm *pwm;
+    struct rt_thread thread;
+    struct rt_semaphore wake;
+    struct rt_mutex lock;
+    HV57708_DimPoint points[HV57708_DIM_POINT_MAX];
+    rt_uint8_t point_num;
+    rt_uint8_t active;          /* 当前生效的日程点 */
+    rt_uint16_t duty;           /* 当前输出的占空比 */
+    rt_uint16_t target;         /* 渐变的目标 */
+    rt_bool_t schedule;         /* 是否按日程调光 */
+    rt_bool_t resync;           /* 日程有变化, 立即读取 RTC */
+    rt_bool_t pwm_mode;         /* SW 引脚是否复用为 PWM 输出 */
+    volatile rt_base_t power;
+    rt_bool_t inited;
+} hv_dim;
+
+ALIGN(RT_ALIGN_SIZE)
+static rt_uint8_t dim_stack[DIM_THREAD_STACK];
+
+/* Private functions ---------------------------------------------------------*/
+
+/* SW 引脚作为普通输出 */
+static void dim_pin_gpio(rt_base_t level)
+{
+    if (hv_dim.pwm_mode)
+    {
+        rt_pwm_disable(hv_dim.pwm, HV57708_DIM_CH);
+        rt_pin_mode(HV57708_SW, PIN_MODE_OUTPUT);
+        hv_dim.pwm_mode = RT_FALSE;
+    }
+    HV57708_SW_WRITE(level);
+}
+
+/* SW 引脚复用为 TIM2_CH2 输出, 重映射在 HAL_TIM_MspPostInit 中设置 */
+static void dim_pin_pwm(void)
+{
+    GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+    if (hv_dim.pwm_mode)
+        return;
+
+    rt_pwm_enable(hv_dim.pwm, HV57708_DIM_CH);
+    GPIO_InitStruct.Pin = GPIO_PIN_3;
+    GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+    GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_LOW;
+    HAL_GPIO_Init(GPIOB, &GPIO_InitStruct);
+    hv_dim.pwm_mode = RT_TRUE;
+}
+
+/* 按电源状态和当前占空比设置输出, 调用前持有 lock */
+static void dim_apply(void)
+{
+    if (!hv_dim.power || hv_dim.duty == 0)
+    {
+        dim_pin_gpio(PIN_LOW);
+    }
+    else if (hv_dim.duty >= HV57708_DIM_MAX || hv_dim.pwm == RT_NULL)
+    {
+        dim_pin_gpio(PIN_HIGH);
+    }
+    else
+    {
+        rt_pwm_set(hv_dim.pwm, HV57708_DIM_CH, HV57708_DIM_PERIOD,
+                   HV57708_DIM_PERIOD / HV57708_DIM_MAX * hv_dim.duty);
+        dim_pin_pwm();
+    }
+}
+
+/* 日程中 minutes 时生效的点: 之前最近的一点, 都在之后则为前一天的最后一点 */
+static rt_uint8_t dim_lookup(rt_uint16_t minutes)
+{
+    rt_uint8_t i;
+
+    for (i = hv_dim.point_num; i > 0; i--)
+    {
+        if (DIM_MINUTES(&hv_dim.points[i - 1]) <= minutes)
+            return i - 1;
+    }
+    return hv_dim.point_num - 1;
+}
+
+static void dim_thread_entry(void *parameter)
+{
+#ifdef DS3231_USING_TZ
+    DS3231_Time time;
+#endif
+    DS3231_Clock clock;
+    rt_tick_t last_poll = 0;
+    rt_int32_t timeout;
+
+    while (1)
+    {
+        rt_mutex_take(&hv_dim.lock, RT_WAITING_FOREVER);
+
+        if (hv_dim.schedule && hv_dim.point_num > 0 &&
+            (hv_dim.resync || rt_tick_get() - last_poll >= rt_tick_from_millisecond(HV57708_DIM_POLL_MS)))
+        {
+#if defined(DS3231_USING_TZ)
+            DS3231_TzLocalTime(&time); // 本地时间, 时间缓存有效时不占用总线
+            clock.hour = time.hour;
+            clock.minute = time.minute;
+#elif defined(DS3231_USING_CACHE)
+            DS3231_CacheGetClock(&clock); // 不占用总线
+#else
+            DS3231_GetClock(&clock);
+#endif
+            last_poll = rt_tick_get();
+            hv_dim.resync = RT_FALSE;
+            hv_dim.active = dim_lookup(clock.hour * 60 + clock.minute);
+            hv_dim.target = hv_dim.points[hv_dim.active].duty;
+        }
+
+        if (hv_dim.duty < hv_dim.target)
+        {
+            hv_dim.duty = (hv_dim.target - hv_dim.duty > DIM_STEP) ? hv_dim.duty + DIM_STEP : hv_dim.target;
+            dim_apply();
+        }
+        else if (hv_dim.duty > hv_dim.target)
+        {
+            hv_dim.duty = (hv_dim.duty - hv_dim.target > DIM_STEP) ? hv_dim.duty - DIM_STEP : hv_dim.target;
+            dim_apply();
+        }
+
+        if (hv_dim.duty != hv_dim.target)
+            timeout = rt_tick_from_millisecond(HV57708_DIM_STEP_MS);
+        else if (hv_dim.schedule && hv_dim.point_num > 0)
+            timeout = rt_tick_from_millisecond(HV57708_DIM_POLL_MS);
+        else
+            timeout = RT_WAITING_FOREVER;
+
+        rt_mutex_release(&hv_dim.lock);
+
+        rt_sem_take(&hv_dim.wake, timeout);
+    }
+}
+
+/*******************************************************************************
+  * @brief  初始化调光, 在 HV57708_Init 和 DS3231_Init 之后调用.
+  *         从当前电源状态和满量程开始, 渐变到日程的目标
+  * @param  None
+  * @retval RT_EOK: 成功, -RT_ERROR: 找不到 PWM 设备, 只能开关电源
+*******************************************************************************/
+rt_err_t HV57708_DimInit(void)
+{
+    rt_err_t ret = RT_EOK;
+
+    if (hv_dim.inited)
+        return RT_EOK;
+
+    hv_dim.pwm = (struct rt_device_pwm *)rt_device_find(HV57708_DIM_PWM);
+    if (hv_dim.pwm == RT_NULL)
+    {
+        rt_kprintf("[%d]%s(): can't find device %s!\n", __LINE__, __func__, HV57708_DIM_PWM);
+        ret = -RT_ERROR;
+    }
+
+    rt_mutex_init(&hv_dim.lock, "hv_dim", RT_IPC_FLAG_FIFO);
+    rt_sem_init(&hv_dim.wake, "hv_dim", 0, RT_IPC_FLAG_FIFO);
+
+    hv_dim.power = HV57708_SW_READ();
+    hv_dim.duty = HV57708_DIM_MAX;
+    hv_dim.target = HV57708_DIM_MAX;
+    HV57708_DimSetProfile(dim_default, sizeof(dim_default) / sizeof(dim_default[0]));
+    hv_dim.schedule = RT_TRUE;
+    hv_dim.resync = RT_TRUE;
+
+    rt_thread_init(&hv_dim.thread, "hv_dim", dim_thread_entry, RT_NULL,
+                   dim_stack, sizeof(dim_stack), DIM_THREAD_PRIORITY, DIM_THREAD_TIMESLICE);
+    hv_dim.inited = RT_TRUE;
+    rt_thread_startup(&hv_dim.thread);
+
+    return ret;
+}
+
+/*******************************************************************************
+  * @brief  打开或关闭辉光管电源, 打开时按当前占空比输出
+  * @param  state - PIN_HIGH: 打开, PIN_LOW: 关闭
+  * @retval None
+*******************************************************************************/
+void HV57708_DimPower(rt_base_t state)
+{
+    if (!hv_dim.inited)
+    {
+        HV57708_SW_WRITE(state);
+        return;
+    }
+
+    rt_mutex_take(&hv_dim.lock, RT_WAITING_FOREVER);
+    hv_dim.power = state;
+    dim_apply();
+    rt_mutex_release(&hv_dim.lock);
+}
+
+/*******************************************************************************
+  * @brief  获取电源开关状态. PWM 输出时引脚电平不断变化, 返回记录的状态.
+  *         可在中断中调用
+  * @param  None
+  * @retval PIN_HIGH: 打开, PIN_LOW: 关闭
+*******************************************************************************/
+rt_base_t HV57708_DimPowerStatus(void)
+{
+    if (!hv_dim.inited)
+        return HV57708_SW_READ();
+
+    return hv_dim.power;
+}
+
+/*******************************************************************************
+  * @brief  手动设定占空比并停止日程, 从当前占空比渐变过去
+  * @param  duty - 0 ~ HV57708_DIM_MAX, 超出按满量程
+  * @retval None
+*******************************************************************************/
+void HV57708_DimSetDuty(rt_uint16_t duty)
+{
+    if (!hv_dim.inited)
+        return;
+
+    if (duty > HV57708_DIM_MAX)
+        duty = HV57708_DIM_MAX;
+
+    rt_mutex_take(&hv_dim.lock, RT_WAITING_FOREVER);
+    hv_dim.schedule = RT_FALSE;
+    hv_dim.target = duty;
+    rt_mutex_release(&hv_dim.lock);
+
+    rt_sem_release(&hv_dim.wake);
+}
+
+/*******************************************************************************
+  * @brief  获取当前输出的占空比
+  * @param  None
+  * @retval 0 ~ HV57708_DIM_MAX
+*******************************************************************************/
+rt_uint16_t HV57708_DimGetDuty(void)
+{
+    return hv_dim.duty;
+}
+
+/*******************************************************************************
+  * @brief  设置日程, 按时间排序后保存, 日程开启时立即生效
+  * @param  points - 日程点, 顺序任意
+  * @param  num - 点数, 1 ~ HV57708_DIM_POINT_MAX
+  * @retval RT_EOK: 成功, -RT_EINVAL: 参数错误
+*******************************************************************************/
+rt_err_t HV57708_DimSetProfile(const HV57708_DimPoint points[], rt_uint8_t num)
+{
+    HV57708_DimPoint sorted[HV57708_DIM_POINT_MAX];
+    HV57708_DimPoint tmp;
+    rt_uint8_t i, j;
+
+    if (points == RT_NULL || num == 0 || num > HV57708_DIM_POINT_MAX)
+        return -RT_EINVAL;
+
+    for (i = 0; i < num; i++)
+    {
+        if (points[i].hour > 23 || points[i].minute > 59 || points[i].duty > HV57708_DIM_MAX)
+            return -RT_EINVAL;
+
+        /* 插入排序 */
+        tmp = points[i];
+        for (j = i; j > 0 && DIM_MINUTES(&sorted[j - 1]) > DIM_MINUTES(&tmp); j--)
+            sorted[j] = sorted[j - 1];
+        sorted[j] = tmp;
+    }
+
+    if (hv_dim.inited)
+        rt_mutex_take(&hv_dim.lock, RT_WAITING_FOREVER);
+    rt_memcpy(hv_dim.points, sorted, sizeof(HV57708_DimPoint) * num);
+    hv_dim.point_num = num;
+    hv_dim.resync = RT_TRUE;
+    if (hv_dim.inited)
+    {
+        rt_mutex_release(&hv_dim.lock);
+        rt_sem_release(&hv_dim.wake);
+    }
+
+    return RT_EOK;
+}
+
+/*******************************************************************************
+  * @brief  获取日程
+  * @param  points - 输出
+  * @param  num - points 的长度
+  * @retval 复制的点数
+*******************************************************************************/
+rt_uint8_t HV57708_DimGetProfile(HV57708_DimPoint points[], rt_uint8_t num)
+{
+    if (num > hv_dim.point_num)
+        num = hv_dim.point_num;
+
+    rt_memcpy(points, hv_dim.points, sizeof(HV57708_DimPoint) * num);
+
+    return num;
+}
+
+/*******************************************************************************
+  * @brief  开启或停止按日程调光
+  * @param  enable - RT_TRUE: 开启
+  * @retval None
+*******************************************************************************/
+void HV57708_DimSchedule(rt_bool_t enable)
+{
+    if (!hv_dim.inited)
+        return;
+
+    rt_mutex_take(&hv_dim.lock, RT_WAITING_FOREVER);
+    hv_dim.schedule = enable;
+    hv_dim.resync = RT_TRUE;
+    rt_mutex_release(&hv_dim.lock);
+
+    rt_sem_release(&hv_dim.wake);
+}
+
+/*******************************************************************************
+  * @brief  打印电源, 占空比和日程
+  * @param  None
+  * @retval None
+*******************************************************************************/
+void HV57708_DimShow(void)
+{
+    rt_uint8_t i;
+
+    rt_kprintf("power: %s, output: %s\n", hv_dim.power ? "on" : "off",
+               hv_dim.pwm_mode ? "pwm" : "gpio");
+    rt_kprintf("duty: %u/%u, target: %u, period: %u ns\n",
+               hv_dim.duty, HV57708_DIM_MAX, hv_dim.target, HV57708_DIM_PERIOD);
+    rt_kprintf("schedule: %s\n", hv_dim.schedule ? "on" : "off");
+    for (i = 0; i < hv_dim.point_num; i++)
+    {
+        rt_kprintf("%c %02u:%02u  %4u\n",
+                   (hv_dim.schedule && i == hv_dim.active) ? '*' : ' ',
+                   hv_dim.points[i].hour, hv_dim.points[i].minute, hv_dim.points[i].duty);
+    }
+}
+
+#endif /* HV57708_USING_DIM */
@@ -0,0 +1,45 @@
+/*******************************************************************************
+* @file     --> hv57708_dim.h
+* @version  --> 1.0
+* @brief    --> 辉光管电源占空比调光头文件
+*******************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __HV57708_DIM_H
+#define __HV57708_DIM_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "hv57708.h"
+
+#ifdef HV57708_USING_DIM
+
+/* Exported types ------------------------------------------------------------*/
+/* 日程中的一点: 从 hour:minute 开始使用 duty, 直到下一点 */
+typedef struct
+{
+    rt_uint8_t hour;
+    rt_uint8_t minute;
+    rt_uint16_t duty;           /* 千分比, 0 ~ HV57708_DIM_MAX */
+} HV57708_DimPoint;
+
+/* Exported define -----------------------------------------------------------*/
+#define HV57708_DIM_MAX             1000    /* 占空比满量程 */
+#define HV57708_DIM_POINT_MAX       8       /* 日程最多的点数 */
+#define HV57708_DIM_STEP_MS         20      /* 渐变时每步的间隔 */
+#define HV57708_DIM_RAMP_MS         2000    /* 从 0 渐变到满量程的时间 */
+#define HV57708_DIM_POLL_MS         10000   /* 读取 RTC 检查日程的间隔 */
+
+/* Exported functions ------------------------------------------------------- */
+rt_err_t HV57708_DimInit(void);
+void HV57708_DimPower(rt_base_t state);
+rt_base_t HV57708_DimPowerStatus(void);
+void HV57708_DimSetDuty(rt_uint16_t duty);
+rt_uint16_t HV57708_DimGetDuty(void);
+rt_err_t HV57708_DimSetProfile(const HV57708_DimPoint points[], rt_uint8_t num);
+rt_uint8_t HV57708_DimGetProfile(HV57708_DimPoint points[], rt_uint8_t num);
+void HV57708_DimSchedule(rt_bool_t enable);
+void HV57708_DimShow(void);
+
+#endif /* HV57708_USING_DIM */
+
+#endif /* __HV57708_DIM_H */
@@ -0,0 +1,45 @@
+/*******************************************************************************
+* @file     --> hv57708_layout.c
+* @version  --> 1.0
+* @brief    --> HV57708 布局表, 描述每个元件的阴极接在哪一片的哪个输出
+*               本板: 一片 HV57708, 6 个数字管, 输出 60 ~ 63 引出备用.
+*               换用 8 管或 IN-12/IN-14 的板子时修改 HV57708_CHIP_NUM 和
+*               此表即可, 例如第 7, 8 个管接在第 1 片:
+*               {1, 0} ~ {1, 9}, {1, 10} ~ {1, 19}
+*******************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include "hv57708.h"
+
+/* Private define ------------------------------------------------------------*/
+#define HV57708_TUBE_PINS(t) \
+    { {0, HV57708_CATHODE_BIT(t, 0)}, {0, HV57708_CATHODE_BIT(t, 1)}, \
+      {0, HV57708_CATHODE_BIT(t, 2)}, {0, HV57708_CATHODE_BIT(t, 3)}, \
+      {0, HV57708_CATHODE_BIT(t, 4)}, {0, HV57708_CATHODE_BIT(t, 5)}, \
+      {0, HV57708_CATHODE_BIT(t, 6)}, {0, HV57708_CATHODE_BIT(t, 7)}, \
+      {0, HV57708_CATHODE_BIT(t, 8)}, {0, HV57708_CATHODE_BIT(t, 9)} }
+
+/* Private variables ---------------------------------------------------------*/
+static const HV57708_Pin tube0_pins[] = HV57708_TUBE_PINS(0);
+static const HV57708_Pin tube1_pins[] = HV57708_TUBE_PINS(1);
+static const HV57708_Pin tube2_pins[] = HV57708_TUBE_PINS(2);
+static const HV57708_Pin tube3_pins[] = HV57708_TUBE_PINS(3);
+static const HV57708_Pin tube4_pins[] = HV57708_TUBE_PINS(4);
+static const HV57708_Pin tube5_pins[] = HV57708_TUBE_PINS(5);
+
+/* 备用输出, 可接冒号氖泡或指示灯 */
+static const HV57708_Pin spare_pins[] = { {0, 60}, {0, 61}, {0, 62}, {0, 63} };
+
+/* Exported variables --------------------------------------------------------*/
+const HV57708_Element hv57708_layout[] =
+{
+    {HV57708_ELEM_DIGIT, 10, tube0_pins},
+    {HV57708_ELEM_DIGIT, 10, tube1_pins},
+    {HV57708_ELEM_DIGIT, 10, tube2_pins},
+    {HV57708_ELEM_DIGIT, 10, tube3_pins},
+    {HV57708_ELEM_DIGIT, 10, tube4_pins},
+    {HV57708_ELEM_DIGIT, 10, tube5_pins},
+    {HV57708_ELEM_MASK,  4,  spare_pins},
+};
+
+const rt_uint8_t hv57708_layout_num = sizeof(hv57708_layout) / sizeof(hv57708_layout[0]);
@@ -0,0 +1,420 @@
+/*******************************************************************************
+* @file     --> hv57708_sim.c
+* @version  --> 1.0
+* @brief    --> HV57708 软件模型
+*               定义 HV57708_USING_SIM 后驱动的所有引脚操作都送到这里:
+*               模型按引脚电平变化推进 4 个 16 位移位寄存器, LE 上升沿
+*               (或 LE 为高时的 CLK 上升沿) 锁存, POL 为低时输出反相.
+*               每次寄存器写入和等待都按估算的周期数累计时间,
+*               以此为时间戳记录 CLK/LE/POL 边沿和每次锁存的结果.
+*               模型只依赖 rtthread.h 中的基本类型, 与 GPIO 无关
+*******************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include "hv57708.h"
+
+#ifdef HV57708_USING_SIM
+
+/* Private define ------------------------------------------------------------*/
+/* 模型跟踪的引脚, 对应 levels 中的位 */
+#define SIM_DI1     0
+#define SIM_DI2     1
+#define SIM_DI3     2
+#define SIM_DI4     3
+#define SIM_CLK     4
+#define SIM_LE      5
+#define SIM_POL     6
+#define SIM_SW      7
+#define SIM_PIN_NUM 8
+
+#define SIM_LATCH_NUM   8   /* 锁存记录条数, 必须是 2 的幂 */
+
+/* Private variables ---------------------------------------------------------*/
+static const rt_uint8_t sim_pins[SIM_PIN_NUM] =
+{
+    HV57708_DI1, HV57708_DI2, HV57708_DI3, HV57708_DI4,
+    HV57708_CLK, HV57708_LE, HV57708_POL, HV57708_SW,
+};
+
+static const char *sim_pin_names[SIM_PIN_NUM] =
+{
+    "DIN1", "DIN2", "DIN3", "DIN4", "CLK", "LE", "POL", "SW",
+};
+
+/* 芯片状态: sr[d] 由 DIN(d+1) 输入, 新移入的位在位 0,
+   锁存后 sr[d] 的位 s 对应输出位 4 * s + d, 与驱动的约定一致 */
+static struct
+{
+    rt_uint16_t sr[4];
+    rt_uint16_t levels;
+    rt_uint64_t latch;
+} hv_sim_chip;
+
+static struct
+{
+    HV57708_SimStats stats;
+    rt_uint32_t now;
+    HV57708_SimEvent trace[HV57708_SIM_TRACE_NUM];
+    rt_uint32_t trace_pos;
+    struct
+    {
+        rt_uint32_t time;
+        rt_uint64_t value;
+    } latch[SIM_LATCH_NUM];
+    rt_uint32_t latch_pos;
+} hv_sim;
+
+/* Private functions ---------------------------------------------------------*/
+
+static int sim_index(rt_base_t pin)
+{
+    int i;
+
+    for (i = 0; i < SIM_PIN_NUM; i++)
+    {
+        if (sim_pins[i] == pin)
+            return i;
+    }
+    return -1;
+}
+
+static void sim_record(rt_uint8_t pin, rt_uint8_t level)
+{
+    HV57708_SimEvent *ev = &hv_sim.trace[hv_sim.trace_pos++ & (HV57708_SIM_TRACE_NUM - 1)];
+
+    ev->time = hv_sim.now;
+    ev->pin = pin;
+    ev->level = level;
+}
+
+/* 移位寄存器并行送入锁存器 */
+static void sim_latch(void)
+{
+    rt_uint64_t value = 0;
+    int s, d;
+
+    for (s = 15; s >= 0; s--)
+    {
+        for (d = 3; d >= 0; d--)
+            value = (value << 1) | ((hv_sim_chip.sr[d] >> s) & 1);
+    }
+    hv_sim_chip.latch = value;
+
+    hv_sim.latch[hv_sim.latch_pos & (SIM_LATCH_NUM - 1)].time = hv_sim.now;
+    hv_sim.latch[hv_sim.latch_pos & (SIM_LATCH_NUM - 1)].value = value;
+    hv_sim.latch_pos++;
+}
+
+/* CLK 上升沿: 4 个寄存器同时移入 DIN 的电平 */
+static void sim_shift(void)
+{
+    int d;
+
+    for (d = 0; d < 4; d++)
+        hv_sim_chip.sr[d] = (hv_sim_chip.sr[d] << 1) | ((hv_sim_chip.levels >> (SIM_DI1 + d)) & 1);
+    hv_sim.stats.clk_edges++;
+
+    if (hv_sim_chip.levels & (1 << SIM_LE)) // LE 为高时锁存器透明
+        sim_latch();
+}
+
+static void sim_apply(rt_base_t pin, rt_base_t level)
+{
+    int idx = sim_index(pin);
+    rt_uint16_t bit;
+
+    if (idx < 0)
+        return;
+
+    bit = 1 << idx;
+    level = (level != PIN_LOW);
+    if (((hv_sim_chip.levels & bit) != 0) == level)
+        return;
+
+    hv_sim_chip.levels ^= bit;
+    hv_sim.stats.toggles++;
+
+    switch (idx)
+    {
+        case SIM_CLK:
+            sim_record(idx, level);
+            if (level)
+                sim_shift();
+            break;
+        case SIM_LE:
+            sim_record(idx, level);
+            if (level)
+            {
+                hv_sim.stats.latches++;
+                sim_latch();
+            }
+            break;
+        case SIM_POL:
+        case SIM_SW:
+            sim_record(idx, level);
+            break;
+        default:
+            break;
+    }
+}
+
+static void sim_advance(rt_uint32_t cycles)
+{
+    hv_sim.now += cycles;
+    hv_sim.stats.cycles += cycles;
+}
+
+/* 按接线宏直接计算期望的输出, 不经过编码表 */
+static rt_uint64_t sim_expect(const rt_uint8_t data[])
+{
+    rt_uint64_t frame = 0;
+    int t;
+
+    for (t = 0; t < HV57708_TUBE_NUM; t++)
+    {
+        if (data[t] <= 9)
+            frame |= (rt_uint64_t)1 << HV57708_CATHODE_BIT(t, data[t]);
+    }
+    return frame;
+}
+
+/*******************************************************************************
+  * @brief  复位模型, 清除寄存器, 引脚电平, 计数和记录
+  * @param  None
+  * @retval None
+*******************************************************************************/
+void HV57708_SimReset(void)
+{
+    rt_base_t level = rt_hw_interrupt_disable();
+
+    rt_memset(&hv_sim_chip, 0, sizeof(hv_sim_chip));
+    rt_memset(&hv_sim, 0, sizeof(hv_sim));
+    rt_hw_interrupt_enable(level);
+}
+
+/*******************************************************************************
+  * @brief  模拟一次端口 BSRR 写入, 低半字置位, 高半字复位, 置位优先
+  * @param  base - 端口第 0 脚的引脚编号
+  * @param  bsrr - 写入的值
+  * @retval None
+*******************************************************************************/
+void HV57708_SimPort(rt_base_t base, rt_uint32_t bsrr)
+{
+    rt_uint32_t set = bsrr & 0xFFFF;
+    rt_uint32_t reset = (bsrr >> 16) & ~set;
+    int i;
+
+    hv_sim.stats.stores++;
+    sim_advance(HV57708_SIM_STORE_CYCLES);
+
+    for (i = 0; i < 16; i++)
+    {
+        if (reset & (1 << i))
+            sim_apply(base + i, PIN_LOW);
+        else if (set & (1 << i))
+            sim_apply(base + i, PIN_HIGH);
+    }
+}
+
+/*******************************************************************************
+  * @brief  模拟一次 rt_pin_write
+  * @param  pin - 引脚编号
+  * @param  level - PIN_HIGH / PIN_LOW
+  * @retval None
+*******************************************************************************/
+void HV57708_SimPin(rt_base_t pin, rt_base_t level)
+{
+    hv_sim.stats.stores++;
+    sim_advance(HV57708_SIM_PIN_API_CYCLES);
+    sim_apply(pin, level);
+}
+
+/*******************************************************************************
+  * @brief  读取模型中的引脚电平
+  * @param  pin - 引脚编号
+  * @retval PIN_HIGH / PIN_LOW, 模型不跟踪的引脚为 PIN_LOW
+*******************************************************************************/
+rt_base_t HV57708_SimRead(rt_base_t pin)
+{
+    int idx = sim_index(pin);
+
+    if (idx < 0)
+        return PIN_LOW;
+    return (hv_sim_chip.levels & (1 << idx)) ? PIN_HIGH : PIN_LOW;
+}
+
+/*******************************************************************************
+  * @brief  模拟空操作等待
+  * @param  cycles - 等待的周期数
+  * @retval None
+*******************************************************************************/
+void HV57708_SimDelay(rt_uint32_t cycles)
+{
+    sim_advance(cycles);
+}
+
+/*******************************************************************************
+  * @brief  获取锁存器中的 64 位数据, 位为 1 的阴极点亮
+  * @param  None
+  * @retval 锁存的数据
+*******************************************************************************/
+rt_uint64_t HV57708_SimLatched(void)
+{
+    return hv_sim_chip.latch;
+}
+
+/*******************************************************************************
+  * @brief  获取 64 个输出引脚的电平, POL 为低时与锁存的数据相反
+  * @param  None
+  * @retval 输出电平
+*******************************************************************************/
+rt_uint64_t HV57708_SimOutputs(void)
+{
+    if (hv_sim_chip.levels & (1 << SIM_POL))
+        return hv_sim_chip.latch;
+    return ~hv_sim_chip.latch;
+}
+
+/*******************************************************************************
+  * @brief  获取模型的累计计数
+  * @param  stats - 输出
+  * @retval None
+*******************************************************************************/
+void HV57708_SimGetStats(HV57708_SimStats *stats)
+{
+    rt_base_t level;
+
+    RT_ASSERT(stats != RT_NULL);
+
+    level = rt_hw_interrupt_disable();
+    *stats = hv_sim.stats;
+    rt_hw_interrupt_enable(level);
+}
+
+/*******************************************************************************
+  * @brief  复制最近的 CLK/LE/POL/SW 边沿记录, 从旧到新
+  * @param  events - 输出
+  * @param  num - events 的长度
+  * @retval 复制的条数
+*******************************************************************************/
+rt_uint32_t HV57708_SimTrace(HV57708_SimEvent events[], rt_uint32_t num)
+{
+    rt_uint32_t pos, avail, i;
+    rt_base_t level;
+
+    level = rt_hw_interrupt_disable();
+    pos = hv_sim.trace_pos;
+    avail = pos < HV57708_SIM_TRACE_NUM ? pos : HV57708_SIM_TRACE_NUM;
+    if (num > avail)
+        num = avail;
+    for (i = 0; i < num; i++)
+        events[i] = hv_sim.trace[(pos - num + i) & (HV57708_SIM_TRACE_NUM - 1)];
+    rt_hw_interrupt_enable(level);
+
+    return num;
+}
+
+/*******************************************************************************
+  * @brief  打印最近的边沿和锁存记录
+  * @param  num - 打印的边沿条数
+  * @retval None
+*******************************************************************************/
+void HV57708_SimDump(rt_uint32_t num)
+{
+    HV57708_SimEvent ev[16];
+    rt_uint32_t n, i, pos;
+
+    if (num > sizeof(ev) / sizeof(ev[0]))
+        num = sizeof(ev) / sizeof(ev[0]);
+
+    n = HV57708_SimTrace(ev, num);
+    rt_kprintf("%10s  pin   level\n", "cycle");
+    for (i = 0; i < n; i++)
+        rt_kprintf("%10u  %-4s  %d\n", ev[i].time, sim_pin_names[ev[i].pin], ev[i].level);
+
+    pos = hv_sim.latch_pos;
+    n = pos < SIM_LATCH_NUM ? pos : SIM_LATCH_NUM;
+    rt_kprintf("%10s  latched\n", "cycle");
+    for (i = 0; i < n; i++)
+    {
+        rt_uint32_t k = (pos - n + i) & (SIM_LATCH_NUM - 1);
+        rt_kprintf("%10u  %08x%08x\n", hv_sim.latch[k].time,
+                   (rt_uint32_t)(hv_sim.latch[k].value >> 32),
+                   (rt_uint32_t)hv_sim.latch[k].value);
+    }
+}
+
+/*******************************************************************************
+  * @brief  通过模型逐帧发送一组数字, 统计每帧的寄存器写入, 引脚翻转和
+  *         估算的总线时间, 并检查锁存的 64 位是否与接线宏算出的一致.
+  *         每帧前后保存并恢复芯片状态, 不影响当前显示
+  * @param  None
+  * @retval None
+*******************************************************************************/
+void HV57708_SimBench(void)
+{
+    static const rt_uint8_t fixed[][HV57708_TUBE_NUM] =
+    {
+        {1, 2, 3, 4, 5, 6},
+        {6, 5, 4, 3, 2, 1},
+        {9, 0, 9, 0, 9, 0},
+        {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF},
+    };
+    rt_uint8_t data[HV57708_TUBE_NUM];
+    HV57708_SimStats before, after;
+    rt_uint32_t stores = 0, toggles = 0, cycles = 0;
+    rt_uint64_t frame, expect, latched;
+    rt_base_t level;
+    int i, t, num, pass = 0;
+
+    num = 10 + sizeof(fixed) / sizeof(fixed[0]);
+    rt_kprintf("digits  stores  toggles  edges  cycles     ns  latched\n");
+    for (i = 0; i < num; i++)
+    {
+        for (t = 0; t < HV57708_TUBE_NUM; t++)
+            data[t] = (i < 10) ? i : fixed[i - 10][t];
+        frame = HV57708_Encode(data);
+        expect = sim_expect(data);
+
+        level = rt_hw_interrupt_disable();
+        {
+            rt_uint16_t sr[4], levels;
+            rt_uint64_t latch = hv_sim_chip.latch;
+
+            rt_memcpy(sr, hv_sim_chip.sr, sizeof(sr));
+            levels = hv_sim_chip.levels;
+            before = hv_sim.stats;
+            HV57708_SendData(frame >> 32, (rt_uint32_t)frame);
+            HV57708_OutputData();
+            after = hv_sim.stats;
+            latched = hv_sim_chip.latch;
+            rt_memcpy(hv_sim_chip.sr, sr, sizeof(sr));
+            hv_sim_chip.levels = levels;
+            hv_sim_chip.latch = latch;
+        }
+        rt_hw_interrupt_enable(level);
+
+        stores += after.stores - before.stores;
+        toggles += after.toggles - before.toggles;
+        cycles += after.cycles - before.cycles;
+        if (latched == expect)
+            pass++;
+
+        for (t = 0; t < HV57708_TUBE_NUM; t++)
+            rt_kprintf("%c", data[t] <= 9 ? '0' + data[t] : '-');
+        rt_kprintf("  %6u  %7u  %5u  %6u  %5u  %s\n",
+                   after.stores - before.stores,
+                   after.toggles - before.toggles,
+                   after.clk_edges - before.clk_edges,
+                   after.cycles - before.cycles,
+                   (after.cycles - before.cycles) * 1000 / HV57708_SIM_CORE_MHZ,
+                   latched == expect ? "ok" : "MISMATCH");
+    }
+
+    rt_kprintf("avg per frame: %u stores, %u toggles, %u cycles (%u ns at %d MHz)\n",
+               stores / num, toggles / num, cycles / num,
+               cycles / num * 1000 / HV57708_SIM_CORE_MHZ, HV57708_SIM_CORE_MHZ);
+    rt_kprintf("latched outputs: %d/%d frames match\n", pass, num);
+}
+
+#endif /* HV57708_USING_SIM */
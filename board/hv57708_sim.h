@@ -0,0 +1,52 @@
+/*******************************************************************************
+* @file     --> hv57708_sim.h
+* @version  --> 1.0
+* @brief    --> HV57708 软件模型头文件
+*******************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __HV57708_SIM_H
+#define __HV57708_SIM_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <rtthread.h>
+
+/* Exported types ------------------------------------------------------------*/
+/* 模型的累计计数, 时间单位为估算的 CPU 时钟周期 */
+typedef struct
+{
+    rt_uint32_t stores;     /* GPIO 寄存器写入次数 */
+    rt_uint32_t toggles;    /* 引脚电平实际变化的次数 */
+    rt_uint32_t clk_edges;  /* CLK 上升沿, 即移位次数 */
+    rt_uint32_t latches;    /* LE 上升沿, 即锁存次数 */
+    rt_uint32_t cycles;     /* 估算的总线时间 */
+} HV57708_SimStats;
+
+/* 一条引脚事件记录 */
+typedef struct
+{
+    rt_uint32_t time;       /* 发生时刻, 周期 */
+    rt_uint8_t pin;
+    rt_uint8_t level;
+} HV57708_SimEvent;
+
+/* Exported define -----------------------------------------------------------*/
+#define HV57708_SIM_CORE_MHZ        72      /* 估算总线时间所用的主频 */
+#define HV57708_SIM_STORE_CYCLES    2       /* 一次端口寄存器写入的周期数 */
+#define HV57708_SIM_PIN_API_CYCLES  40      /* 一次 rt_pin_write 的周期数 */
+#define HV57708_SIM_TRACE_NUM       256     /* 事件记录条数, 必须是 2 的幂 */
+
+/* Exported functions ------------------------------------------------------- */
+void HV57708_SimReset(void);
+void HV57708_SimPort(rt_base_t base, rt_uint32_t bsrr);
+void HV57708_SimPin(rt_base_t pin, rt_base_t level);
+rt_base_t HV57708_SimRead(rt_base_t pin);
+void HV57708_SimDelay(rt_uint32_t cycles);
+rt_uint64_t HV57708_SimLatched(void);
+rt_uint64_t HV57708_SimOutputs(void);
+void HV57708_SimGetStats(HV57708_SimStats *stats);
+rt_uint32_t HV57708_SimTrace(HV57708_SimEvent events[], rt_uint32_t num);
+void HV57708_SimBench(void);
+void HV57708_SimDump(rt_uint32_t num);
+
+#endif /* __HV57708_SIM_H */
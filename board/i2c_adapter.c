@@ -9,54 +9,142 @@
 /* Includes ------------------------------------------------------------------*/
 #include "i2c_adapter.h"
 #include <rtdevice.h>
+#include "dwt_cycle.h"
 
 /* Private typedef -----------------------------------------------------------*/
 /* Private macro -------------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
+#define I2C_WRITER_MAX      4   /* 同时登记的写线程数 */
+
 /* Private variables ---------------------------------------------------------*/
 rt_bool_t i2c_initialized = RT_FALSE;
-static struct rt_i2c_bus_device *i2c_bus = RT_NULL; /* I2C总线设备句柄 */
+static I2c_Device i2c_default;                      /* 兼容接口使用的总线 */
+static I2c_Device *i2c_devices[I2C_DEVICE_MAX];     /* 已打开的设备, 用于统计 */
+static rt_uint32_t i2c_heap_total;
+#ifdef RT_USING_HOOK
+/* 正在写的线程和设备, 统计其间的堆分配. 不同总线上的写可以同时进行,
+   等待总线锁的线程也已登记, 表满时不统计 */
+static struct
+{
+    rt_thread_t thread;
+    I2c_Device *dev;
+} i2c_writers[I2C_WRITER_MAX];
+static rt_bool_t i2c_hooked = RT_FALSE;
+#endif
+#ifdef RT_USING_I2C_BITOPS
+/* drv_soft_i2c 注册的软件总线, 只有这些总线的 priv 指向 rt_i2c_bit_ops */
+static const char *const i2c_soft_buses[] =
+{
+#ifdef BSP_USING_I2C1
+    "i2c1",
+#endif
+#ifdef BSP_USING_I2C2
+    "i2c2",
+#endif
+#ifdef BSP_USING_I2C3
+    "i2c3",
+#endif
+#ifdef BSP_USING_I2C4
+    "i2c4",
+#endif
+    RT_NULL
+};
+#endif
 
 /* Private function prototypes -----------------------------------------------*/
 /* Private functions ---------------------------------------------------------*/
 
-/*******************************************************************************
-* @brief    初始化 I2C 设备 (获取 I2C 句柄)
-* @param    name - 已经注册过的 I2C 总线名称
-* @retval   None
-*******************************************************************************/
-rt_err_t I2c_Init(const char *name)
+/* 所有传输都经过这里, 按设备统计次数和耗时 */
+static rt_size_t i2c_transfer(I2c_Device *dev, struct rt_i2c_msg msgs[], rt_uint32_t num)
 {
-    /* 查找I2C总线设备，获取I2C总线设备句柄 */
-    i2c_bus = (struct rt_i2c_bus_device *)rt_device_find(name);
+    rt_uint32_t start = DWT_CycleGet();
+    rt_size_t ret = rt_i2c_transfer(dev->bus, msgs, num);
+    rt_uint32_t us = DWT_CycleToNs(DWT_CycleGet() - start) / 1000;
+    I2c_Stats *stats = &dev->stats;
+    rt_base_t level;
+
+    level = rt_hw_interrupt_disable();
+    stats->transfers++;
+    stats->messages += num;
+    if (ret != num)
+        stats->errors++;
+    stats->last_us = us;
+    if (us > stats->max_us)
+        stats->max_us = us;
+    stats->sum_us += us;
+    rt_hw_interrupt_enable(level);
 
-    if (i2c_bus == RT_NULL)
+    return ret;
+}
+
+#ifdef RT_USING_HOOK
+static void i2c_malloc_hook(void *ptr, rt_uint32_t size)
+{
+    rt_thread_t self = rt_thread_self();
+    int i;
+
+    i2c_heap_total++;
+    for (i = 0; i < I2C_WRITER_MAX; i++)
     {
-        rt_kprintf("[%d]%s(): can't find device %s!\n", __LINE__, __func__, name);
-        return -RT_ERROR;
+        if (self != RT_NULL && i2c_writers[i].thread == self)
+        {
+            i2c_writers[i].dev->stats.heap_allocs++;
+            break;
+        }
     }
+}
+#endif
 
-    i2c_initialized = RT_TRUE;
-    return RT_EOK;
+/* 标记当前线程进入或离开写路径 */
+static void i2c_heap_watch(I2c_Device *dev, rt_bool_t enter)
+{
+#ifdef RT_USING_HOOK
+    rt_thread_t self = rt_thread_self();
+    rt_thread_t match = enter ? RT_NULL : self;
+    rt_base_t level;
+    int i;
+
+    if (self == RT_NULL)
+        return;
+
+    level = rt_hw_interrupt_disable();
+    for (i = 0; i < I2C_WRITER_MAX; i++)
+    {
+        if (i2c_writers[i].thread == match)
+        {
+            i2c_writers[i].dev = dev;
+            i2c_writers[i].thread = enter ? self : RT_NULL;
+            break;
+        }
+    }
+    rt_hw_interrupt_enable(level);
+#endif
 }
 
-/*******************************************************************************
-* @brief    I2C 向指定从机发送一个字节
-* @param    SlaveAddress  - 从机地址
-* @param    txByte    - 被发送的字节
-* @retval   RT_EOK: 成功, -RT_ERROR: 失败
-*******************************************************************************/
-rt_err_t I2c_WriteByte(uint8_t SlaveAddress, uint8_t txByte)
+static void i2c_xfer_begin(I2c_Xfer *xfer, I2c_Device *dev, rt_uint16_t addr)
+{
+    xfer->dev = dev;
+    xfer->num = 0;
+    xfer->addr = addr;
+    xfer->overflow = RT_FALSE;
+}
+
+/* 单条消息 */
+static rt_err_t i2c_single(I2c_Device *dev, rt_uint16_t addr, rt_uint16_t flags, uint8_t *buf, rt_uint16_t len)
 {
     struct rt_i2c_msg msgs;
 
-    msgs.addr = SlaveAddress;
-    msgs.flags = RT_I2C_WR;
-    msgs.buf = &txByte;
-    msgs.len = 1;
+    if (dev->bus == RT_NULL || buf == RT_NULL)
+    {
+        return -RT_ERROR;
+    }
+
+    msgs.addr = addr;
+    msgs.flags = flags;
+    msgs.buf = buf;
+    msgs.len = len;
 
-    /* 调用I2C设备接口传输数据 */
-    if (rt_i2c_transfer(i2c_bus, &msgs, 1) != 1)
+    if (i2c_transfer(dev, &msgs, 1) != 1)
     {
         return -RT_ERROR;
     }
@@ -64,101 +152,281 @@ rt_err_t I2c_WriteByte(uint8_t SlaveAddress, uint8_t txByte)
     return RT_EOK;
 }
 
-/*******************************************************************************
-* @brief    I2C 从指定的从机读取一个字节
-* @param    SlaveAddress  - 从机地址
-* @param    rxByte        - 指向读取数据的指针
-* @retval   RT_EOK: 成功, -RT_ERROR: 失败
-*******************************************************************************/
-rt_err_t I2c_ReadByte(uint8_t SlaveAddress, uint8_t *rxByte)
+/* 写寄存器地址, 重复起始后读取数据, 一次传输 */
+static rt_err_t i2c_read_reg(I2c_Device *dev, rt_uint16_t addr, uint8_t REG_Address, uint8_t len, uint8_t *buf)
 {
-    struct rt_i2c_msg msgs;
+    I2c_Xfer xfer;
 
-    if (rxByte == NULL)
+    if (dev->bus == RT_NULL || buf == RT_NULL)
     {
         return -RT_ERROR;
     }
 
-    msgs.addr = SlaveAddress;
-    msgs.flags = RT_I2C_RD;
-    msgs.buf = rxByte;
-    msgs.len = 1;
+    i2c_xfer_begin(&xfer, dev, addr);
+    I2c_XferWrite(&xfer, &REG_Address, 1);
+    I2c_XferRead(&xfer, buf, len);
+
+    return I2c_XferSubmit(&xfer);
+}
+
+/* 寄存器地址和数据是两条消息, 第二条不产生 START, 总线上与一次写入相同,
+   不需要拼接缓冲区 */
+static rt_err_t i2c_write_reg(I2c_Device *dev, rt_uint16_t addr, uint8_t REG_Address, uint8_t len, uint8_t *buf)
+{
+    I2c_Xfer xfer;
+    rt_err_t ret;
 
-    if (rt_i2c_transfer(i2c_bus, &msgs, 1) != 1)
+    if (dev->bus == RT_NULL || buf == RT_NULL)
     {
         return -RT_ERROR;
     }
 
-    return RT_EOK;
+    i2c_xfer_begin(&xfer, dev, addr);
+    I2c_XferWrite(&xfer, &REG_Address, 1);
+    I2c_XferAppend(&xfer, buf, len);
+
+    i2c_heap_watch(dev, RT_TRUE);
+    ret = I2c_XferSubmit(&xfer);
+    i2c_heap_watch(dev, RT_FALSE);
+
+    return ret;
 }
 
-/*******************************************************************************
-* @brief    I2C 写一个字节数据到从机的指定地址
-* @param    SlaveAddress  - 从机地址
-* @param    REG_Address   - 寄存器地址
-* @param    REG_data      - 字节数据
-* @retval   RT_EOK/-RT_ERROR
-*******************************************************************************/
-rt_err_t I2c_Write_1Byte(uint8_t SlaveAddress, uint8_t REG_Address, uint8_t REG_data)
+/* 改为组合传输之前的读取方式: 写寄存器地址和读数据分两次传输, 仅用于对比测试 */
+static rt_err_t i2c_read_split(I2c_Device *dev, uint8_t REG_Address, uint8_t len, uint8_t *buf)
 {
-    rt_uint8_t buf[2];
-    struct rt_i2c_msg msgs;
+    if (i2c_single(dev, dev->addr, RT_I2C_WR, &REG_Address, 1) != RT_EOK)
+        return -RT_ERROR;
 
-    buf[0] = REG_Address;
-    buf[1] = REG_data;
+    return i2c_single(dev, dev->addr, RT_I2C_RD, buf, len);
+}
 
-    msgs.addr = SlaveAddress;
-    msgs.flags = RT_I2C_WR;
-    msgs.buf = buf;
-    msgs.len = 2;
+/* 设置软件 I2C 的时序, 作用于整条总线. 其他总线的 priv 不是 rt_i2c_bit_ops, 不修改 */
+static void i2c_apply_profile(I2c_Device *dev)
+{
+#ifdef RT_USING_I2C_BITOPS
+    struct rt_i2c_bit_ops *ops = RT_NULL;
+    const char *name = dev->bus->parent.parent.name;
+    int i;
 
-    if (rt_i2c_transfer(i2c_bus, &msgs, 1) != 1)
+    for (i = 0; i2c_soft_buses[i] != RT_NULL; i++)
     {
-        return -RT_ERROR;
+        if (rt_strncmp(name, i2c_soft_buses[i], RT_NAME_MAX) == 0)
+        {
+            ops = (struct rt_i2c_bit_ops *)dev->bus->priv;
+            break;
+        }
+    }
+    if (ops == RT_NULL)
+    {
+        rt_kprintf("[%d]%s(): %.*s is not a soft i2c bus, profile ignored\n",
+                   __LINE__, __func__, RT_NAME_MAX, name);
+        return;
     }
+    if (dev->profile.delay_us != 0)
+        ops->delay_us = dev->profile.delay_us;
+    if (dev->profile.timeout != 0)
+        ops->timeout = dev->profile.timeout;
+#endif
+}
 
-    return RT_EOK;
+static void i2c_register(I2c_Device *dev)
+{
+    rt_base_t level;
+    int i, slot = -1;
+
+    level = rt_hw_interrupt_disable();
+    for (i = 0; i < I2C_DEVICE_MAX; i++)
+    {
+        if (i2c_devices[i] == dev)
+        {
+            slot = -1;
+            break;
+        }
+        if (i2c_devices[i] == RT_NULL && slot < 0)
+            slot = i;
+    }
+    if (i == I2C_DEVICE_MAX && slot >= 0)
+        i2c_devices[slot] = dev;
+    rt_hw_interrupt_enable(level);
 }
 
 /*******************************************************************************
-* @brief    I2C 从从机的指定地址读取一个字节
-* @param    SlaveAddress  - 从机地址
-* @param    REG_Address   - 寄存器地址
-* @param    REG_data      - 指向读取字节的指针
-* @retval   RT_EOK: 成功, -RT_ERROR: 失败
+* @brief    打开 I2C 设备: 绑定总线, 从机地址和时序. 可以同时打开多个总线上的设备
+* @param    dev       - 设备句柄, 由调用者提供存储, 关闭之前必须有效
+* @param    bus_name  - 已经注册过的 I2C 总线名称
+* @param    addr      - 从机地址 (7 位)
+* @param    profile   - 总线时序, RT_NULL 表示保持驱动的设置
+* @retval   RT_EOK, -RT_ERROR: 找不到总线
 *******************************************************************************/
-rt_err_t I2c_Read_1Byte(uint8_t SlaveAddress, uint8_t REG_Address, uint8_t *REG_data)
+rt_err_t I2c_Open(I2c_Device *dev, const char *bus_name, rt_uint16_t addr, const I2c_Profile *profile)
 {
-    /* 先写寄存器地址，再读取数据 */
-    struct rt_i2c_msg msgs;
+    RT_ASSERT(dev != RT_NULL);
+
+    rt_memset(dev, 0, sizeof(*dev));
 
-    if (REG_data == NULL)
+    /* 查找I2C总线设备，获取I2C总线设备句柄 */
+    dev->bus = (struct rt_i2c_bus_device *)rt_device_find(bus_name);
+    if (dev->bus == RT_NULL)
     {
+        rt_kprintf("[%d]%s(): can't find device %s!\n", __LINE__, __func__, bus_name);
         return -RT_ERROR;
     }
 
-    msgs.addr = SlaveAddress;
-    msgs.flags = RT_I2C_WR;
-    msgs.buf = &REG_Address;
-    msgs.len = 1;
+    dev->addr = addr;
+    if (profile != RT_NULL)
+    {
+        dev->profile = *profile;
+        i2c_apply_profile(dev);
+    }
 
-    if (rt_i2c_transfer(i2c_bus, &msgs, 1) != 1)
+    DWT_CycleInit();
+#ifdef RT_USING_HOOK
+    /* 钩子只有一个, 只在第一次打开设备时设置 */
+    if (!i2c_hooked)
     {
-        return -RT_ERROR;
+        i2c_hooked = RT_TRUE;
+        rt_malloc_sethook(i2c_malloc_hook);
     }
+#endif
+    i2c_register(dev);
+
+    return RT_EOK;
+}
+
+/*******************************************************************************
+* @brief    关闭 I2C 设备, 之后不能再用于传输
+* @param    dev - 设备句柄
+* @retval   None
+*******************************************************************************/
+void I2c_Close(I2c_Device *dev)
+{
+    rt_base_t level;
+    int i;
+
+    level = rt_hw_interrupt_disable();
+    for (i = 0; i < I2C_DEVICE_MAX; i++)
+    {
+        if (i2c_devices[i] == dev)
+            i2c_devices[i] = RT_NULL;
+    }
+    dev->bus = RT_NULL;
+    rt_hw_interrupt_enable(level);
+}
+
+/*******************************************************************************
+* @brief    向设备发送数据, 不带寄存器地址, 用于命令式的从机
+* @param    dev  - 设备句柄
+* @param    buf  - 发送数据
+* @param    len  - 字节数
+* @retval   RT_EOK: 成功, -RT_ERROR: 失败
+*******************************************************************************/
+rt_err_t I2c_DevSend(I2c_Device *dev, uint8_t *buf, rt_uint16_t len)
+{
+    return i2c_single(dev, dev->addr, RT_I2C_WR, buf, len);
+}
+
+/*******************************************************************************
+* @brief    从设备接收数据, 不带寄存器地址
+* @param    dev  - 设备句柄
+* @param    buf  - 接收缓冲区
+* @param    len  - 字节数
+* @retval   RT_EOK: 成功, -RT_ERROR: 失败
+*******************************************************************************/
+rt_err_t I2c_DevRecv(I2c_Device *dev, uint8_t *buf, rt_uint16_t len)
+{
+    return i2c_single(dev, dev->addr, RT_I2C_RD, buf, len);
+}
+
+/*******************************************************************************
+* @brief    向设备的指定寄存器写入 n 个字节, 不分配内存
+* @param    dev           - 设备句柄
+* @param    REG_Address   - 寄存器地址
+* @param    len           - 字节数
+* @param    buf           - 发送数据缓冲区
+* @retval   RT_EOK: 成功, -RT_ERROR: 失败
+*******************************************************************************/
+rt_err_t I2c_DevWriteReg(I2c_Device *dev, uint8_t REG_Address, uint8_t len, uint8_t *buf)
+{
+    return i2c_write_reg(dev, dev->addr, REG_Address, len, buf);
+}
 
-    msgs.flags = RT_I2C_RD;
-    msgs.buf = REG_data;
-    msgs.len = 1;
+/*******************************************************************************
+* @brief    从设备的指定寄存器读取 n 个字节, 一次组合传输
+* @param    dev           - 设备句柄
+* @param    REG_Address   - 寄存器地址
+* @param    len           - 字节数
+* @param    buf           - 接收数据缓冲区
+* @retval   RT_EOK: 成功, -RT_ERROR: 失败
+*******************************************************************************/
+rt_err_t I2c_DevReadReg(I2c_Device *dev, uint8_t REG_Address, uint8_t len, uint8_t *buf)
+{
+    return i2c_read_reg(dev, dev->addr, REG_Address, len, buf);
+}
 
-    if (rt_i2c_transfer(i2c_bus, &msgs, 1) != 1)
+/*******************************************************************************
+* @brief    初始化 I2C 设备 (获取 I2C 句柄), 供下面按从机地址访问的兼容接口使用.
+*           新代码用 I2c_Open 打开自己的设备
+* @param    name - 已经注册过的 I2C 总线名称
+* @retval   None
+*******************************************************************************/
+rt_err_t I2c_Init(const char *name)
+{
+    if (I2c_Open(&i2c_default, name, 0, RT_NULL) != RT_EOK)
     {
         return -RT_ERROR;
     }
 
+    i2c_initialized = RT_TRUE;
     return RT_EOK;
 }
 
+/*******************************************************************************
+* @brief    I2C 向指定从机发送一个字节
+* @param    SlaveAddress  - 从机地址
+* @param    txByte    - 被发送的字节
+* @retval   RT_EOK: 成功, -RT_ERROR: 失败
+*******************************************************************************/
+rt_err_t I2c_WriteByte(uint8_t SlaveAddress, uint8_t txByte)
+{
+    return i2c_single(&i2c_default, SlaveAddress, RT_I2C_WR, &txByte, 1);
+}
+
+/*******************************************************************************
+* @brief    I2C 从指定的从机读取一个字节
+* @param    SlaveAddress  - 从机地址
+* @param    rxByte        - 指向读取数据的指针
+* @retval   RT_EOK: 成功, -RT_ERROR: 失败
+*******************************************************************************/
+rt_err_t I2c_ReadByte(uint8_t SlaveAddress, uint8_t *rxByte)
+{
+    return i2c_single(&i2c_default, SlaveAddress, RT_I2C_RD, rxByte, 1);
+}
+
+/*******************************************************************************
+* @brief    I2C 写一个字节数据到从机的指定地址
+* @param    SlaveAddress  - 从机地址
+* @param    REG_Address   - 寄存器地址
+* @param    REG_data      - 字节数据
+* @retval   RT_EOK/-RT_ERROR
+*******************************************************************************/
+rt_err_t I2c_Write_1Byte(uint8_t SlaveAddress, uint8_t REG_Address, uint8_t REG_data)
+{
+    return i2c_write_reg(&i2c_default, SlaveAddress, REG_Address, 1, &REG_data);
+}
+
+/*******************************************************************************
+* @brief    I2C 从从机的指定地址读取一个字节
+* @param    SlaveAddress  - 从机地址
+* @param    REG_Address   - 寄存器地址
+* @param    REG_data      - 指向读取字节的指针
+* @retval   RT_EOK: 成功, -RT_ERROR: 失败
+*******************************************************************************/
+rt_err_t I2c_Read_1Byte(uint8_t SlaveAddress, uint8_t REG_Address, uint8_t *REG_data)
+{
+    return I2c_Read_nByte(SlaveAddress, REG_Address, 1, REG_data);
+}
+
 /*******************************************************************************
 * @brief    I2C 向从机的指定地址写入 n 个字节
 * @param    SlaveAddress  - 从机地址
@@ -169,73 +437,241 @@ rt_err_t I2c_Read_1Byte(uint8_t SlaveAddress, uint8_t REG_Address, uint8_t *REG_
 *******************************************************************************/
 rt_err_t I2c_Write_nByte(uint8_t SlaveAddress, uint8_t REG_Address, uint8_t len, uint8_t *buf)
 {
-    struct rt_i2c_msg msgs;
-    uint8_t *pBuf;
-    rt_err_t ret = -RT_ERROR;
+    return i2c_write_reg(&i2c_default, SlaveAddress, REG_Address, len, buf);
+}
+
+/*******************************************************************************
+* @brief    I2C 从从机的指定地址读取 n 个字节
+* @param    SlaveAddress  - 从机地址
+* @param    REG_Address   - 寄存器地址
+* @param    len           - 字节数据
+* @param    buf           - 接收数据缓冲区
+* @retval   RT_EOK: 成功, -RT_ERROR: 失败
+*******************************************************************************/
+rt_err_t I2c_Read_nByte(uint8_t SlaveAddress, uint8_t REG_Address, uint8_t len, uint8_t *buf)
+{
+    return i2c_read_reg(&i2c_default, SlaveAddress, REG_Address, len, buf);
+}
 
-    if (NULL == buf)
+/*******************************************************************************
+* @brief    开始一次组合传输
+* @param    xfer - 传输描述, 可以在栈上
+* @param    dev  - 设备句柄
+* @retval   None
+*******************************************************************************/
+void I2c_XferBegin(I2c_Xfer *xfer, I2c_Device *dev)
+{
+    i2c_xfer_begin(xfer, dev, dev->addr);
+}
+
+static void i2c_xfer_add(I2c_Xfer *xfer, rt_uint16_t flags, uint8_t *buf, rt_uint16_t len)
+{
+    struct rt_i2c_msg *msg;
+
+    if (xfer->num >= I2C_XFER_MSG_MAX)
+    {
+        xfer->overflow = RT_TRUE;
+        return;
+    }
+
+    msg = &xfer->msgs[xfer->num++];
+    msg->addr = xfer->addr;
+    msg->flags = flags;
+    msg->buf = buf;
+    msg->len = len;
+}
+
+/*******************************************************************************
+* @brief    组合传输中追加一条写消息
+* @param    xfer - 传输描述
+* @param    buf  - 发送数据, 提交之前必须有效
+* @param    len  - 字节数
+* @retval   None
+*******************************************************************************/
+void I2c_XferWrite(I2c_Xfer *xfer, uint8_t *buf, rt_uint16_t len)
+{
+    i2c_xfer_add(xfer, RT_I2C_WR, buf, len);
+}
+
+/*******************************************************************************
+* @brief    组合传输中追加一条写消息, 紧接前一条写消息发送, 不产生 START 和地址,
+*           用于在寄存器地址之后直接发送调用者的缓冲区
+* @param    xfer - 传输描述
+* @param    buf  - 发送数据, 提交之前必须有效
+* @param    len  - 字节数
+* @retval   None
+*******************************************************************************/
+void I2c_XferAppend(I2c_Xfer *xfer, uint8_t *buf, rt_uint16_t len)
+{
+    i2c_xfer_add(xfer, RT_I2C_WR | RT_I2C_NO_START, buf, len);
+}
+
+/*******************************************************************************
+* @brief    组合传输中追加一条读消息, 与前一条消息之间为重复起始条件
+* @param    xfer - 传输描述
+* @param    buf  - 接收缓冲区
+* @param    len  - 字节数
+* @retval   None
+*******************************************************************************/
+void I2c_XferRead(I2c_Xfer *xfer, uint8_t *buf, rt_uint16_t len)
+{
+    i2c_xfer_add(xfer, RT_I2C_RD, buf, len);
+}
+
+/*******************************************************************************
+* @brief    提交组合传输: 一次加锁, 一个 START, 消息之间重复起始, 一个 STOP
+* @param    xfer - 传输描述
+* @retval   RT_EOK: 成功, -RT_ERROR: 失败, -RT_EFULL: 消息超过 I2C_XFER_MSG_MAX
+*******************************************************************************/
+rt_err_t I2c_XferSubmit(I2c_Xfer *xfer)
+{
+    if (xfer->overflow)
+    {
+        return -RT_EFULL;
+    }
+    if (xfer->num == 0)
+    {
+        return RT_EOK;
+    }
+    if (xfer->dev->bus == RT_NULL)
     {
         return -RT_ERROR;
     }
 
-    pBuf = rt_malloc(len + 1);
-    if (NULL == pBuf)
+    if (i2c_transfer(xfer->dev, xfer->msgs, xfer->num) != xfer->num)
     {
         return -RT_ERROR;
     }
 
-    pBuf[0] = REG_Address;
-    rt_memcpy(&pBuf[1], buf, len);
+    return RT_EOK;
+}
+
+/*******************************************************************************
+* @brief    获取统计
+* @param    dev   - 设备句柄, RT_NULL 为所有已打开设备的合计
+* @param    stats - 输出
+* @retval   None
+*******************************************************************************/
+void I2c_GetStats(I2c_Device *dev, I2c_Stats *stats)
+{
+    rt_base_t level;
+    I2c_Stats *s;
+    int i;
 
-    msgs.addr = SlaveAddress;
-    msgs.flags = RT_I2C_WR;
-    msgs.buf = pBuf;
-    msgs.len = len + 1;
+    RT_ASSERT(stats != RT_NULL);
 
-    if (rt_i2c_transfer(i2c_bus, &msgs, 1) == 1)
+    level = rt_hw_interrupt_disable();
+    if (dev != RT_NULL)
     {
-        ret = RT_EOK;
+        *stats = dev->stats;
     }
-
-    rt_free(pBuf);
-    return ret;
+    else
+    {
+        rt_memset(stats, 0, sizeof(*stats));
+        for (i = 0; i < I2C_DEVICE_MAX; i++)
+        {
+            if (i2c_devices[i] == RT_NULL)
+                continue;
+            s = &i2c_devices[i]->stats;
+            stats->transfers += s->transfers;
+            stats->messages += s->messages;
+            stats->errors += s->errors;
+            stats->sum_us += s->sum_us;
+            stats->heap_allocs += s->heap_allocs;
+            if (s->max_us > stats->max_us)
+                stats->max_us = s->max_us;
+        }
+        stats->heap_total = i2c_heap_total;
+    }
+    rt_hw_interrupt_enable(level);
 }
 
 /*******************************************************************************
-* @brief    I2C 从从机的指定地址读取 n 个字节
-* @param    SlaveAddress  - 从机地址
-* @param    REG_Address   - 寄存器地址
-* @param    len           - 字节数据
-* @param    buf           - 接收数据缓冲区
-* @retval   RT_EOK: 成功, -RT_ERROR: 失败
+* @brief    清除所有设备的统计
+* @param    None
+* @retval   None
 *******************************************************************************/
-rt_err_t I2c_Read_nByte(uint8_t SlaveAddress, uint8_t REG_Address, uint8_t len, uint8_t *buf)
+void I2c_ResetStats(void)
 {
-    struct rt_i2c_msg msgs;
+    rt_base_t level;
+    int i;
 
-    if (buf == NULL)
+    level = rt_hw_interrupt_disable();
+    for (i = 0; i < I2C_DEVICE_MAX; i++)
     {
-        return -RT_ERROR;
+        if (i2c_devices[i] != RT_NULL)
+            rt_memset(&i2c_devices[i]->stats, 0, sizeof(I2c_Stats));
     }
+    i2c_heap_total = 0;
+    rt_hw_interrupt_enable(level);
+}
 
-    msgs.addr = SlaveAddress;
-    msgs.flags = RT_I2C_WR;
-    msgs.buf = &REG_Address;
-    msgs.len = 1;
+/*******************************************************************************
+* @brief    打印每个设备的统计和合计
+* @param    None
+* @retval   None
+*******************************************************************************/
+void I2c_Show(void)
+{
+    I2c_Device *dev;
+    I2c_Stats stats;
+    int i;
 
-    if (rt_i2c_transfer(i2c_bus, &msgs, 1) != 1)
+    for (i = 0; i < I2C_DEVICE_MAX; i++)
     {
-        return -RT_ERROR;
+        dev = i2c_devices[i];
+        if (dev == RT_NULL || dev->bus == RT_NULL)
+            continue;
+        I2c_GetStats(dev, &stats);
+        rt_kprintf("%.*s 0x%02x: transfers %u, errors %u, max %u us, avg %u us\n",
+                   RT_NAME_MAX, dev->bus->parent.parent.name, dev->addr,
+                   stats.transfers, stats.errors, stats.max_us,
+                   stats.transfers > 0 ? stats.sum_us / stats.transfers : 0);
     }
 
-    msgs.flags = RT_I2C_RD;
-    msgs.buf = buf;
-    msgs.len = len;
+    I2c_GetStats(RT_NULL, &stats);
+    rt_kprintf("i2c transfers: %u, messages: %u, errors: %u\n",
+               stats.transfers, stats.messages, stats.errors);
+    if (stats.transfers > 0)
+    {
+        rt_kprintf("time: max %u us, avg %u us\n",
+                   stats.max_us, stats.sum_us / stats.transfers);
+    }
+#ifdef RT_USING_HOOK
+    rt_kprintf("heap: %u allocations in i2c writes, %u in total\n",
+               stats.heap_allocs, stats.heap_total);
+#endif
+}
+
+/*******************************************************************************
+* @brief    对比分两次传输和组合传输读取寄存器的耗时
+* @param    dev           - 设备句柄
+* @param    REG_Address   - 寄存器地址
+* @param    len           - 每次读取的字节数, 不超过 32
+* @param    count         - 每种方式的读取次数
+* @retval   None
+*******************************************************************************/
+void I2c_Bench(I2c_Device *dev, uint8_t REG_Address, uint8_t len, rt_uint32_t count)
+{
+    uint8_t buf[32];
+    rt_uint32_t i, start, split_us, combined_us, errors = 0;
 
-    if (rt_i2c_transfer(i2c_bus, &msgs, 1) != 1)
+    if (len == 0 || len > sizeof(buf) || count == 0 || dev == RT_NULL || dev->bus == RT_NULL)
     {
-        return -RT_ERROR;
+        rt_kprintf("[%d]%s(): invalid argument\n", __LINE__, __func__);
+        return;
     }
 
-    return RT_EOK;
+    start = DWT_CycleGet();
+    for (i = 0; i < count; i++)
+        errors += (i2c_read_split(dev, REG_Address, len, buf) != RT_EOK);
+    split_us = DWT_CycleToNs((DWT_CycleGet() - start) / count) / 1000;
+
+    start = DWT_CycleGet();
+    for (i = 0; i < count; i++)
+        errors += (I2c_DevReadReg(dev, REG_Address, len, buf) != RT_EOK);
+    combined_us = DWT_CycleToNs((DWT_CycleGet() - start) / count) / 1000;
+
+    rt_kprintf("read %u bytes x %u: split %u us, combined %u us, saved %d us, errors: %u\n",
+               len, count, split_us, combined_us, (int)(split_us - combined_us), errors);
 }
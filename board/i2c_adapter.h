@@ -5,21 +5,72 @@
 * @date     7-Jun-2020
 * @brief    将 RT_Thread 的 I2C 总线传输接口封装成易于操作传感器的接口
 *******************************************************************************/
-  
+
 /* Define to prevent recursive inclusion -------------------------------------*/
 #ifndef __I2C_UTIL_H
 #define __I2C_UTIL_H
 
 /* Includes ------------------------------------------------------------------*/
 #include <rtthread.h>
+#include <rtdevice.h>
 
 /* Exported variables --------------------------------------------------------*/
 extern rt_bool_t i2c_initialized;
 
 /* Exported type -------------------------------------------------------------*/
+#define I2C_DEVICE_MAX      4   /* 同时打开的设备数, 用于统计 */
+
+/* 总线时序, 0 表示保持驱动的设置. 作用于整条总线, 同一总线上后打开的设备生效 */
+typedef struct
+{
+    rt_uint32_t delay_us;       /* 软件 I2C 半个时钟周期的延时 */
+    rt_uint32_t timeout;        /* 等待从机释放 SCL (时钟延展) 的超时, tick */
+} I2c_Profile;
+
+typedef struct
+{
+    rt_uint32_t transfers;      /* rt_i2c_transfer 调用次数, 即总线加锁次数 */
+    rt_uint32_t messages;       /* 消息数, 每条消息一个 START 或重复 START */
+    rt_uint32_t errors;
+    rt_uint32_t last_us;        /* 最近一次传输的耗时, 含等待总线锁 */
+    rt_uint32_t max_us;
+    rt_uint32_t sum_us;
+    rt_uint32_t heap_allocs;    /* 写路径中的堆分配次数, 应为 0 (需要 RT_USING_HOOK) */
+    rt_uint32_t heap_total;     /* 全系统的堆分配次数, 用于确认钩子有效, 只在合计中 */
+} I2c_Stats;
+
+/* 设备句柄: 总线, 从机地址, 时序, 由调用者提供存储 */
+typedef struct
+{
+    struct rt_i2c_bus_device *bus;
+    rt_uint16_t addr;
+    I2c_Profile profile;
+    I2c_Stats stats;
+} I2c_Device;
+
+/* 组合传输: 多条消息一次提交, 消息之间为重复起始条件, 只在最后产生 STOP,
+   期间总线只加锁一次, 其他线程无法插入 */
+#define I2C_XFER_MSG_MAX    4
+
+typedef struct
+{
+    struct rt_i2c_msg msgs[I2C_XFER_MSG_MAX];
+    I2c_Device *dev;
+    rt_uint8_t num;
+    rt_uint16_t addr;
+    rt_bool_t overflow;
+} I2c_Xfer;
 
 /* Exported functions ------------------------------------------------------- */
-/* 通用函数 */
+/* 设备句柄 */
+rt_err_t I2c_Open(I2c_Device *dev, const char *bus_name, rt_uint16_t addr, const I2c_Profile *profile);
+void I2c_Close(I2c_Device *dev);
+rt_err_t I2c_DevSend(I2c_Device *dev, uint8_t *buf, rt_uint16_t len);
+rt_err_t I2c_DevRecv(I2c_Device *dev, uint8_t *buf, rt_uint16_t len);
+rt_err_t I2c_DevWriteReg(I2c_Device *dev, uint8_t REG_Address, uint8_t len, uint8_t *buf);
+rt_err_t I2c_DevReadReg(I2c_Device *dev, uint8_t REG_Address, uint8_t len, uint8_t *buf);
+
+/* 兼容接口: 使用 I2c_Init 指定的总线, 每次传入从机地址 */
 rt_err_t I2c_Init(const char *name);
 rt_err_t I2c_WriteByte(uint8_t SlaveAddress, uint8_t txByte);
 rt_err_t I2c_ReadByte(uint8_t SlaveAddress, uint8_t *rxByte);
@@ -30,4 +81,17 @@ rt_err_t I2c_Read_1Byte(uint8_t SlaveAddress, uint8_t REG_Address, uint8_t *REG_
 rt_err_t I2c_Write_nByte(uint8_t SlaveAddress, uint8_t REG_Address, uint8_t len, uint8_t *buf);
 rt_err_t I2c_Read_nByte(uint8_t SlaveAddress, uint8_t REG_Address, uint8_t len, uint8_t *buf);
 
+/* 组合传输 */
+void I2c_XferBegin(I2c_Xfer *xfer, I2c_Device *dev);
+void I2c_XferWrite(I2c_Xfer *xfer, uint8_t *buf, rt_uint16_t len);
+void I2c_XferAppend(I2c_Xfer *xfer, uint8_t *buf, rt_uint16_t len);
+void I2c_XferRead(I2c_Xfer *xfer, uint8_t *buf, rt_uint16_t len);
+rt_err_t I2c_XferSubmit(I2c_Xfer *xfer);
+
+/* 统计 */
+void I2c_GetStats(I2c_Device *dev, I2c_Stats *stats);
+void I2c_ResetStats(void);
+void I2c_Show(void);
+void I2c_Bench(I2c_Device *dev, uint8_t REG_Address, uint8_t len, rt_uint32_t count);
+
 #endif /* __I2C_UTIL_H */
@@ -24,24 +24,11 @@
 static rt_err_t write_cmd(sht3x_device_t dev, rt_uint16_t cmd)
 {
     rt_uint8_t buf[2] = {0};
-    struct rt_i2c_msg msg;
 
     buf[0] = cmd >> 8;
     buf[1] = cmd & 0xFF;
 
-    msg.addr = dev->i2c_addr;
-    msg.flags = RT_I2C_WR;
-    msg.buf = buf;
-    msg.len = sizeof(buf);
-
-    if (rt_i2c_transfer(dev->i2c, &msg, 1) == 1)
-    {
-        return RT_EOK;
-    }
-    else
-    {
-        return -RT_ERROR;
-    }
+    return I2c_DevSend(&dev->i2c, buf, sizeof(buf));
 }
 
 /* calculate CRC value of bytes in buffer */
@@ -68,19 +55,7 @@ static rt_uint8_t cal_crc(void *data, rt_uint8_t len)
 
 static rt_err_t read_bytes(sht3x_device_t dev, rt_uint8_t *data, rt_uint16_t len)
 {
-    struct rt_i2c_msg msg;
-
-    msg.addr = dev->i2c_addr;
-    msg.flags = RT_I2C_RD;
-    msg.buf = data;
-    msg.len = len;
-
-    if (rt_i2c_transfer(dev->i2c, &msg, 1) != 1)
-    {
-        return -RT_ERROR;
-    }
-
-    return RT_EOK;
+    return I2c_DevRecv(&dev->i2c, data, len);
 }
 
 static rt_err_t read_two_bytes_and_crc(sht3x_device_t dev, rt_uint16_t *data)
@@ -116,6 +91,10 @@ sht3x_device_t sht3x_device_create(const char *i2c_bus_name, rt_uint8_t sht3x_ad
 
 {
     sht3x_device_t dev;
+    I2c_Profile *bus_profile = RT_NULL;
+#ifdef SHT3X_USING_BUS_PROFILE
+    I2c_Profile profile;
+#endif
     rt_uint32_t ser_num;
 
     RT_ASSERT(i2c_bus_name);
@@ -127,21 +106,21 @@ sht3x_device_t sht3x_device_create(const char *i2c_bus_name, rt_uint8_t sht3x_ad
         return RT_NULL;
     }
 
-    dev->i2c = (struct rt_i2c_bus_device *)rt_device_find(i2c_bus_name);
-    if (dev->i2c == RT_NULL)
+    if(sht3x_addr != SHT3X_ADDR_PD && sht3x_addr != SHT3X_ADDR_PU)
     {
-        rt_kprintf("[%d]%s(): can't find %s\n", __LINE__, __func__, i2c_bus_name);
+        rt_kprintf("[%d]%s(): illegal sht3x address: 0x%x\n", __LINE__, __func__, sht3x_addr);
         rt_free(dev);
         return RT_NULL;
     }
 
-    if(sht3x_addr == SHT3X_ADDR_PD || sht3x_addr == SHT3X_ADDR_PU)
-    {
-        dev->i2c_addr = sht3x_addr;
-    }
-    else
+#ifdef SHT3X_USING_BUS_PROFILE
+    /* 单独一条总线, 放慢时钟并放宽时钟延展的等待, 不影响 DS3231 的总线 */
+    profile.delay_us = SHT3X_I2C_DELAY_US;
+    profile.timeout = rt_tick_from_millisecond(SHT3X_I2C_TIMEOUT_MS);
+    bus_profile = &profile;
+#endif
+    if (I2c_Open(&dev->i2c, i2c_bus_name, sht3x_addr, bus_profile) != RT_EOK)
     {
-        rt_kprintf("[%d]%s(): illegal sht3x address: 0x%x\n", __LINE__, __func__, sht3x_addr);
         rt_free(dev);
         return RT_NULL;
     }
@@ -150,6 +129,7 @@ sht3x_device_t sht3x_device_create(const char *i2c_bus_name, rt_uint8_t sht3x_ad
     if (dev->lock == RT_NULL)
     {
         rt_kprintf("[%d]%s(): can't create mutex for sht3x device\n", __LINE__, __func__);
+        I2c_Close(&dev->i2c);
         rt_free(dev);
         return RT_NULL;
     }
@@ -178,6 +158,7 @@ void sht3x_device_destroy(sht3x_device_t dev)
     RT_ASSERT(dev);
 
     rt_mutex_delete(dev->lock);
+    I2c_Close(&dev->i2c);
     rt_free(dev);
 }
 
@@ -12,12 +12,27 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include <rtthread.h>
+#include "i2c_adapter.h"
 
 /* Exported define -----------------------------------------------------------*/
 /* SHT3X 的 I2C 地址 */
 #define SHT3X_ADDR_PD 0x44 // addr pin pulled down: 0x44
 #define SHT3X_ADDR_PU 0x45 // addr pin pulled down: 0x45
 
+/* 传感器所在的 I2C 总线, 默认与 DS3231 共用 i2c1.
+   焊接 PB10/PB11 并在 menuconfig 中打开 BSP_USING_I2C2 后可改为 "i2c2" */
+#ifndef SHT3X_I2C_BUS
+#define SHT3X_I2C_BUS           "i2c1"
+#endif
+
+/* 单独使用一条总线时打开: 放慢时钟并放宽时钟延展的等待.
+   时序作用于整条总线, 与 DS3231 共用时保持驱动的时序 */
+// #define SHT3X_USING_BUS_PROFILE
+
+/* 总线时序: 约 100kHz, 时钟延展模式下测量期间从机拉低 SCL 最长 15.5ms */
+#define SHT3X_I2C_DELAY_US      5
+#define SHT3X_I2C_TIMEOUT_MS    20
+
 /* 根据硬件调整 Alert 和 Reset 引脚的宏开关和宏定义 */
 
 // #define SHT3X_ENABLE_ALERT_PIN
@@ -100,8 +115,7 @@ typedef union sht3x_status_word
 
 struct sht3x_device
 {
-    struct rt_i2c_bus_device *i2c;
-    rt_uint8_t i2c_addr;
+    I2c_Device i2c;
     rt_mutex_t lock;
 
     rt_base_t reset_pin;
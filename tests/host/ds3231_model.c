@@ -0,0 +1,100 @@
+/*******************************************************************************
+* @file     ds3231_model.c
+* @version  1.0
+* @brief    主机测试用的 DS3231 模型, 见 ds3231_model.h.
+*           写消息的第一个字节是寄存器指针, 之后的字节 (包括不带 START 的
+*           后续写消息) 依次写入; 读消息从指针处依次读出
+*******************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include "ds3231_model.h"
+#include "rtshim.h"
+
+/* Private define ------------------------------------------------------------*/
+#define MODEL_ADDRESS   0x68
+
+/* Private variables ---------------------------------------------------------*/
+static struct
+{
+    rt_uint8_t reg[DS3231_MODEL_REG_NUM];
+    rt_uint8_t ptr;
+    rt_uint32_t transfers;
+} ds3231_model;
+
+/* Private functions ---------------------------------------------------------*/
+static rt_uint8_t model_bcd(rt_uint8_t val)
+{
+    return (val / 10) << 4 | (val % 10);
+}
+
+static rt_size_t model_slave(struct rt_i2c_msg msgs[], rt_uint32_t num)
+{
+    rt_uint32_t i;
+    rt_uint16_t j;
+
+    ds3231_model.transfers++;
+    for (i = 0; i < num; i++)
+    {
+        j = 0;
+        if (msgs[i].flags & RT_I2C_RD)
+        {
+            for (; j < msgs[i].len; j++)
+                msgs[i].buf[j] = ds3231_model.reg[ds3231_model.ptr++ % DS3231_MODEL_REG_NUM];
+            continue;
+        }
+
+        if (!(msgs[i].flags & RT_I2C_NO_START) && msgs[i].len > 0)
+            ds3231_model.ptr = msgs[i].buf[j++];
+        for (; j < msgs[i].len; j++)
+            ds3231_model.reg[ds3231_model.ptr++ % DS3231_MODEL_REG_NUM] = msgs[i].buf[j];
+    }
+    return num;
+}
+
+/*******************************************************************************
+  * @brief  挂接到 I2C 替身, 寄存器清零, 控制寄存器为上电默认值
+  * @param  None
+  * @retval None
+*******************************************************************************/
+void DS3231_ModelAttach(void)
+{
+    rt_memset(&ds3231_model, 0, sizeof(ds3231_model));
+    ds3231_model.reg[0x0E] = 0x1C;  // INTCN, RS2, RS1
+    ds3231_model.reg[0x0F] = 0x88;  // OSF, EN32kHz
+    shim_i2c_attach(MODEL_ADDRESS, model_slave);
+}
+
+/*******************************************************************************
+  * @brief  设置时间寄存器, 24 小时制
+  * @param  seconds - 2000-01-01 00:00:00 起的秒数
+  * @retval None
+*******************************************************************************/
+void DS3231_ModelSetSeconds(rt_uint32_t seconds)
+{
+    DS3231_Time time;
+
+    DS3231_SecondsToTime(seconds, &time);
+    ds3231_model.reg[0] = model_bcd(time.second);
+    ds3231_model.reg[1] = model_bcd(time.minute);
+    ds3231_model.reg[2] = model_bcd(time.hour);
+    ds3231_model.reg[3] = time.day;
+    ds3231_model.reg[4] = model_bcd(time.date);
+    ds3231_model.reg[5] = model_bcd(time.month);
+    ds3231_model.reg[6] = model_bcd(time.year);
+}
+
+rt_uint8_t DS3231_ModelReg(rt_uint8_t reg)
+{
+    return ds3231_model.reg[reg];
+}
+
+void DS3231_ModelSetReg(rt_uint8_t reg, rt_uint8_t value)
+{
+    ds3231_model.reg[reg] = value;
+}
+
+/* 模型收到的组合传输次数 */
+rt_uint32_t DS3231_ModelTransfers(void)
+{
+    return ds3231_model.transfers;
+}
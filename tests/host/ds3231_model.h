@@ -0,0 +1,25 @@
+/*******************************************************************************
+* @file     ds3231_model.h
+* @version  1.0
+* @brief    主机测试用的 DS3231 模型: 19 个寄存器, 挂在替身 I2C 总线的 0x68 上,
+*           寄存器指针自动递增, 时间寄存器由测试直接设置, 不自行走时
+*******************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __DS3231_MODEL_H
+#define __DS3231_MODEL_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "ds3231.h"
+
+/* Exported define -----------------------------------------------------------*/
+#define DS3231_MODEL_REG_NUM    19
+
+/* Exported functions ------------------------------------------------------- */
+void DS3231_ModelAttach(void);
+void DS3231_ModelSetSeconds(rt_uint32_t seconds);
+rt_uint8_t DS3231_ModelReg(rt_uint8_t reg);
+void DS3231_ModelSetReg(rt_uint8_t reg, rt_uint8_t value);
+rt_uint32_t DS3231_ModelTransfers(void);
+
+#endif /* __DS3231_MODEL_H */
@@ -0,0 +1,76 @@
+/*******************************************************************************
+* @file     board.h
+* @version  1.0
+* @brief    主机测试用的板级替身: GPIO 端口, DWT 周期计数器和主频.
+*           寄存器都是普通变量, 写入不产生任何效果, 需要观察端口写入的
+*           测试自行定义 HV57708_DIN_WRITE 等宏
+*******************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __BOARD_H__
+#define __BOARD_H__
+
+/* Includes ------------------------------------------------------------------*/
+#include <rtthread.h>
+#include <drv_common.h>
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+    volatile rt_uint32_t CRL;
+    volatile rt_uint32_t CRH;
+    volatile rt_uint32_t IDR;
+    volatile rt_uint32_t ODR;
+    volatile rt_uint32_t BSRR;
+    volatile rt_uint32_t BRR;
+    volatile rt_uint32_t LCKR;
+} GPIO_TypeDef;
+
+typedef struct
+{
+    volatile rt_uint32_t CTRL;
+    volatile rt_uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct
+{
+    volatile rt_uint32_t DEMCR;
+} CoreDebug_Type;
+
+/* Exported variables --------------------------------------------------------*/
+extern GPIO_TypeDef shim_gpio[4];
+extern DWT_Type shim_dwt;
+extern CoreDebug_Type shim_core_debug;
+extern rt_uint32_t SystemCoreClock;
+
+/* Exported define -----------------------------------------------------------*/
+#define GPIOA                       (&shim_gpio[0])
+#define GPIOB                       (&shim_gpio[1])
+#define GPIOC                       (&shim_gpio[2])
+#define GPIOD                       (&shim_gpio[3])
+
+#define GPIO_PIN_0                  ((rt_uint16_t)0x0001)
+#define GPIO_PIN_1                  ((rt_uint16_t)0x0002)
+#define GPIO_PIN_2                  ((rt_uint16_t)0x0004)
+#define GPIO_PIN_3                  ((rt_uint16_t)0x0008)
+#define GPIO_PIN_4                  ((rt_uint16_t)0x0010)
+#define GPIO_PIN_5                  ((rt_uint16_t)0x0020)
+#define GPIO_PIN_6                  ((rt_uint16_t)0x0040)
+#define GPIO_PIN_7                  ((rt_uint16_t)0x0080)
+#define GPIO_PIN_8                  ((rt_uint16_t)0x0100)
+#define GPIO_PIN_9                  ((rt_uint16_t)0x0200)
+#define GPIO_PIN_10                 ((rt_uint16_t)0x0400)
+#define GPIO_PIN_11                 ((rt_uint16_t)0x0800)
+#define GPIO_PIN_12                 ((rt_uint16_t)0x1000)
+#define GPIO_PIN_13                 ((rt_uint16_t)0x2000)
+#define GPIO_PIN_14                 ((rt_uint16_t)0x4000)
+#define GPIO_PIN_15                 ((rt_uint16_t)0x8000)
+
+#define DWT                         (&shim_dwt)
+#define CoreDebug                   (&shim_core_debug)
+#define DWT_CTRL_CYCCNTENA_Msk      (1UL << 0)
+#define CoreDebug_DEMCR_TRCENA_Msk  (1UL << 24)
+
+#define __nop()                     ((void)0)
+
+#endif /* __BOARD_H__ */
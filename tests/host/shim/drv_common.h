@@ -0,0 +1,23 @@
+/*******************************************************************************
+* @file     drv_common.h
+* @version  1.0
+* @brief    主机测试用的 BSP 公共头文件替身
+*******************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __DRV_COMMON_H__
+#define __DRV_COMMON_H__
+
+/* Includes ------------------------------------------------------------------*/
+#include <rtthread.h>
+#include <rtdevice.h>
+#include <board.h>
+
+/* Exported define -----------------------------------------------------------*/
+#define GET_PIN(PORTx, PIN)         ((rt_base_t)(16 * PORTx##_INDEX + (PIN)))
+#define A_INDEX                     0
+#define B_INDEX                     1
+#define C_INDEX                     2
+#define D_INDEX                     3
+
+#endif /* __DRV_COMMON_H__ */
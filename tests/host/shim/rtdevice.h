@@ -0,0 +1,98 @@
+/*******************************************************************************
+* @file     rtdevice.h
+* @version  1.0
+* @brief    主机测试用的设备框架替身: 设备查找, 引脚, 硬件定时器, I2C 总线.
+*           设备由 rtshim.c 静态提供: "timer4", "timer5", "i2c1", "i2c2"
+*******************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __RT_DEVICE_H__
+#define __RT_DEVICE_H__
+
+/* Includes ------------------------------------------------------------------*/
+#include <rtthread.h>
+
+/* Exported define -----------------------------------------------------------*/
+#define RT_DEVICE_OFLAG_RDONLY      0x001
+#define RT_DEVICE_OFLAG_WRONLY      0x002
+#define RT_DEVICE_OFLAG_RDWR        0x003
+
+#define PIN_LOW                     0x00
+#define PIN_HIGH                    0x01
+#define PIN_MODE_OUTPUT             0x00
+#define PIN_MODE_INPUT              0x01
+#define PIN_MODE_INPUT_PULLUP       0x02
+#define PIN_MODE_INPUT_PULLDOWN     0x03
+#define PIN_MODE_OUTPUT_OD          0x04
+#define PIN_IRQ_MODE_FALLING        0x01
+#define PIN_IRQ_ENABLE              0x01
+#define PIN_IRQ_DISABLE             0x00
+
+#define HWTIMER_CTRL_FREQ_SET       0x21
+#define HWTIMER_CTRL_STOP           0x22
+#define HWTIMER_CTRL_INFO_GET       0x23
+#define HWTIMER_CTRL_MODE_SET       0x24
+
+#define RT_I2C_WR                   0x0000
+#define RT_I2C_RD                   (1u << 0)
+#define RT_I2C_ADDR_10BIT           (1u << 2)
+#define RT_I2C_NO_START             (1u << 4)
+#define RT_I2C_IGNORE_NACK          (1u << 5)
+#define RT_I2C_NO_READ_ACK          (1u << 6)
+
+/* Exported types ------------------------------------------------------------*/
+struct rt_device
+{
+    struct rt_object parent;
+    rt_err_t (*rx_indicate)(rt_device_t dev, rt_size_t size);
+    void *user_data;
+};
+
+typedef enum
+{
+    HWTIMER_MODE_ONESHOT = 0x01,
+    HWTIMER_MODE_PERIOD
+} rt_hwtimer_mode_t;
+
+typedef struct
+{
+    rt_int32_t sec;
+    rt_int32_t usec;
+} rt_hwtimerval_t;
+
+struct rt_i2c_msg
+{
+    rt_uint16_t addr;
+    rt_uint16_t flags;
+    rt_uint16_t len;
+    rt_uint8_t *buf;
+};
+
+struct rt_i2c_bus_device
+{
+    struct rt_device parent;
+    rt_uint16_t flags;
+    rt_uint16_t addr;
+    rt_uint32_t timeout;
+    rt_uint32_t retries;
+    void *priv;
+};
+
+/* Exported functions ------------------------------------------------------- */
+rt_device_t rt_device_find(const char *name);
+rt_err_t rt_device_open(rt_device_t dev, rt_uint16_t oflag);
+rt_err_t rt_device_close(rt_device_t dev);
+rt_size_t rt_device_write(rt_device_t dev, rt_off_t pos, const void *buffer, rt_size_t size);
+rt_err_t rt_device_control(rt_device_t dev, int cmd, void *arg);
+rt_err_t rt_device_set_rx_indicate(rt_device_t dev, rt_err_t (*rx_ind)(rt_device_t dev, rt_size_t size));
+
+void rt_pin_mode(rt_base_t pin, rt_base_t mode);
+void rt_pin_write(rt_base_t pin, rt_base_t value);
+int rt_pin_read(rt_base_t pin);
+rt_err_t rt_pin_attach_irq(rt_int32_t pin, rt_uint32_t mode, void (*hdr)(void *args), void *args);
+rt_err_t rt_pin_irq_enable(rt_base_t pin, rt_uint32_t enabled);
+
+struct rt_i2c_bus_device *rt_i2c_bus_device_find(const char *bus_name);
+rt_size_t rt_i2c_transfer(struct rt_i2c_bus_device *bus, struct rt_i2c_msg msgs[], rt_uint32_t num);
+
+#endif /* __RT_DEVICE_H__ */
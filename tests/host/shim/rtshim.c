@@ -0,0 +1,568 @@
+/*******************************************************************************
+* @file     rtshim.c
+* @version  1.0
+* @brief    主机测试用的 RT-Thread 替身实现.
+*           只有一个线程: 中断开关只记嵌套, 互斥量只记持有次数, 线程不运行.
+*           信号量为 0 时 rt_sem_take 代替"其他上下文"推进正在运行的
+*           硬件定时器, 直到信号量被释放, 相当于线程阻塞期间中断照常发生
+*******************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <rtthread.h>
+#include <rtdevice.h>
+#include <board.h>
+#include "rtshim.h"
+
+/* Private define ------------------------------------------------------------*/
+#define SHIM_TIMER_MAX      16
+#define SHIM_PIN_MAX        (16 * 4)
+#define SHIM_I2C_SLAVE_MAX  4
+#define SHIM_SEM_SPIN_MAX   100000  /* 信号量等待时最多推进的中断次数 */
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+    struct rt_device parent;
+    rt_hwtimer_mode_t mode;
+    rt_int32_t period_us;
+    rt_bool_t running;
+} shim_hwtimer;
+
+/* Private variables ---------------------------------------------------------*/
+GPIO_TypeDef shim_gpio[4];
+DWT_Type shim_dwt;
+CoreDebug_Type shim_core_debug;
+rt_uint32_t SystemCoreClock = 72000000;
+
+void (*shim_pin_hook)(rt_base_t pin, rt_base_t value);
+
+static shim_hwtimer shim_timers[] =
+{
+    { .parent.parent.name = "timer4" },
+    { .parent.parent.name = "timer5" },
+};
+
+static struct rt_i2c_bus_device shim_buses[] =
+{
+    { .parent.parent.name = "i2c1" },
+    { .parent.parent.name = "i2c2" },
+};
+
+static struct
+{
+    rt_tick_t tick;
+    rt_uint8_t irq_nest;
+    rt_uint8_t irq_disabled;
+    rt_uint16_t critical;
+    rt_timer_t timers[SHIM_TIMER_MAX];
+    rt_uint8_t timer_num;
+    rt_uint8_t pins[SHIM_PIN_MAX];
+    struct
+    {
+        rt_uint16_t addr;
+        shim_i2c_slave slave;
+    } slaves[SHIM_I2C_SLAVE_MAX];
+    struct rt_thread main;
+    int checks;
+    int failures;
+} shim;
+
+/* Private functions ---------------------------------------------------------*/
+
+static shim_hwtimer *shim_hwtimer_find(const char *name)
+{
+    rt_size_t i;
+
+    for (i = 0; i < sizeof(shim_timers) / sizeof(shim_timers[0]); i++)
+    {
+        if (strcmp(shim_timers[i].parent.parent.name, name) == 0)
+            return &shim_timers[i];
+    }
+    return RT_NULL;
+}
+
+static rt_bool_t shim_is_hwtimer(rt_device_t dev)
+{
+    return (char *)dev >= (char *)shim_timers &&
+           (char *)dev < (char *)shim_timers + sizeof(shim_timers);
+}
+
+/* 每个正在运行的硬件定时器各触发一次, 返回触发的个数 */
+static int shim_hwtimer_step(void)
+{
+    rt_size_t i;
+    int fired = 0;
+
+    for (i = 0; i < sizeof(shim_timers) / sizeof(shim_timers[0]); i++)
+    {
+        if (shim_timers[i].running)
+        {
+            shim_hwtimer_fire(shim_timers[i].parent.parent.name, 1);
+            fired++;
+        }
+    }
+    return fired;
+}
+
+/*---------------------------------- 中断 ------------------------------------*/
+
+rt_base_t rt_hw_interrupt_disable(void)
+{
+    return shim.irq_disabled++;
+}
+
+void rt_hw_interrupt_enable(rt_base_t level)
+{
+    RT_ASSERT(shim.irq_disabled == level + 1);
+    shim.irq_disabled = (rt_uint8_t)level;
+}
+
+void rt_interrupt_enter(void)
+{
+    shim.irq_nest++;
+}
+
+void rt_interrupt_leave(void)
+{
+    shim.irq_nest--;
+}
+
+rt_uint8_t rt_interrupt_get_nest(void)
+{
+    return shim.irq_nest;
+}
+
+void rt_enter_critical(void)
+{
+    shim.critical++;
+}
+
+void rt_exit_critical(void)
+{
+    shim.critical--;
+}
+
+/*------------------------------- 时钟与定时器 --------------------------------*/
+
+rt_tick_t rt_tick_get(void)
+{
+    return shim.tick;
+}
+
+rt_tick_t rt_tick_from_millisecond(rt_int32_t ms)
+{
+    return (rt_tick_t)ms * RT_TICK_PER_SECOND / 1000;
+}
+
+void rt_timer_init(rt_timer_t timer, const char *name, void (*timeout)(void *parameter),
+                   void *parameter, rt_tick_t time, rt_uint8_t flag)
+{
+    strncpy(timer->parent.name, name, RT_NAME_MAX - 1);
+    timer->parent.flag = flag;
+    timer->timeout_func = timeout;
+    timer->parameter = parameter;
+    timer->init_tick = time;
+    timer->active = RT_FALSE;
+
+    RT_ASSERT(shim.timer_num < SHIM_TIMER_MAX);
+    shim.timers[shim.timer_num++] = timer;
+}
+
+rt_err_t rt_timer_start(rt_timer_t timer)
+{
+    timer->timeout_tick = shim.tick + timer->init_tick;
+    timer->active = RT_TRUE;
+    return RT_EOK;
+}
+
+rt_err_t rt_timer_stop(rt_timer_t timer)
+{
+    if (!timer->active)
+        return -RT_ERROR;
+    timer->active = RT_FALSE;
+    return RT_EOK;
+}
+
+rt_err_t rt_timer_control(rt_timer_t timer, int cmd, void *arg)
+{
+    if (cmd == RT_TIMER_CTRL_SET_TIME)
+        timer->init_tick = *(rt_tick_t *)arg;
+    else if (cmd == RT_TIMER_CTRL_GET_TIME)
+        *(rt_tick_t *)arg = timer->init_tick;
+    return RT_EOK;
+}
+
+void shim_tick_advance(rt_tick_t ticks)
+{
+    rt_uint8_t i;
+    rt_timer_t timer;
+
+    while (ticks-- > 0)
+    {
+        shim.tick++;
+        for (i = 0; i < shim.timer_num; i++)
+        {
+            timer = shim.timers[i];
+            if (!timer->active || timer->timeout_tick != shim.tick)
+                continue;
+
+            if (timer->parent.flag & RT_TIMER_FLAG_PERIODIC)
+                timer->timeout_tick = shim.tick + timer->init_tick;
+            else
+                timer->active = RT_FALSE;
+
+            /* 软件定时器在定时器线程中回调, 硬件定时器在 SysTick 中断中 */
+            if (!(timer->parent.flag & RT_TIMER_FLAG_SOFT_TIMER))
+                rt_interrupt_enter();
+            timer->timeout_func(timer->parameter);
+            if (!(timer->parent.flag & RT_TIMER_FLAG_SOFT_TIMER))
+                rt_interrupt_leave();
+        }
+    }
+}
+
+/*---------------------------------- 线程 ------------------------------------*/
+
+rt_err_t rt_thread_init(struct rt_thread *thread, const char *name,
+                        void (*entry)(void *parameter), void *parameter,
+                        void *stack_start, rt_uint32_t stack_size,
+                        rt_uint8_t priority, rt_uint32_t tick)
+{
+    strncpy(thread->parent.name, name, RT_NAME_MAX - 1);
+    thread->entry = entry;
+    thread->parameter = parameter;
+    return RT_EOK;
+}
+
+rt_thread_t rt_thread_create(const char *name, void (*entry)(void *parameter), void *parameter,
+                             rt_uint32_t stack_size, rt_uint8_t priority, rt_uint32_t tick)
+{
+    rt_thread_t thread = calloc(1, sizeof(struct rt_thread));
+
+    rt_thread_init(thread, name, entry, parameter, RT_NULL, stack_size, priority, tick);
+    return thread;
+}
+
+/* 线程不运行, 入口函数多为死循环, 测试直接调用其中的处理函数 */
+rt_err_t rt_thread_startup(rt_thread_t thread)
+{
+    return RT_EOK;
+}
+
+rt_thread_t rt_thread_self(void)
+{
+    return &shim.main;
+}
+
+rt_err_t rt_thread_delay(rt_tick_t tick)
+{
+    shim_tick_advance(tick);
+    return RT_EOK;
+}
+
+rt_err_t rt_thread_mdelay(rt_int32_t ms)
+{
+    return rt_thread_delay(rt_tick_from_millisecond(ms));
+}
+
+/*------------------------------- 线程间同步 ---------------------------------*/
+
+rt_err_t rt_sem_init(rt_sem_t sem, const char *name, rt_uint32_t value, rt_uint8_t flag)
+{
+    strncpy(sem->parent.name, name, RT_NAME_MAX - 1);
+    sem->value = (rt_uint16_t)value;
+    return RT_EOK;
+}
+
+rt_err_t rt_sem_take(rt_sem_t sem, rt_int32_t time)
+{
+    int spin = 0;
+
+    RT_DEBUG_NOT_IN_INTERRUPT;
+
+    /* 阻塞期间由硬件定时器中断释放信号量 */
+    while (sem->value == 0 && time != RT_WAITING_NO && spin++ < SHIM_SEM_SPIN_MAX)
+    {
+        if (shim_hwtimer_step() == 0)
+            break;
+    }
+
+    if (sem->value == 0)
+    {
+        /* 单线程中永久等待一个不会释放的信号量就是死锁 */
+        RT_ASSERT(time != RT_WAITING_FOREVER);
+        return -RT_ETIMEOUT;
+    }
+
+    sem->value--;
+    return RT_EOK;
+}
+
+rt_err_t rt_sem_release(rt_sem_t sem)
+{
+    sem->value++;
+    return RT_EOK;
+}
+
+rt_err_t rt_mutex_init(rt_mutex_t mutex, const char *name, rt_uint8_t flag)
+{
+    strncpy(mutex->parent.name, name, RT_NAME_MAX - 1);
+    mutex->hold = 0;
+    return RT_EOK;
+}
+
+rt_mutex_t rt_mutex_create(const char *name, rt_uint8_t flag)
+{
+    rt_mutex_t mutex = calloc(1, sizeof(struct rt_mutex));
+
+    rt_mutex_init(mutex, name, flag);
+    return mutex;
+}
+
+rt_err_t rt_mutex_delete(rt_mutex_t mutex)
+{
+    free(mutex);
+    return RT_EOK;
+}
+
+rt_err_t rt_mutex_take(rt_mutex_t mutex, rt_int32_t time)
+{
+    RT_DEBUG_NOT_IN_INTERRUPT;
+    mutex->hold++;
+    return RT_EOK;
+}
+
+rt_err_t rt_mutex_release(rt_mutex_t mutex)
+{
+    RT_ASSERT(mutex->hold > 0);
+    mutex->hold--;
+    return RT_EOK;
+}
+
+/*---------------------------------- 内存 ------------------------------------*/
+
+void *rt_malloc(rt_size_t size)
+{
+    return malloc(size);
+}
+
+void *rt_calloc(rt_size_t count, rt_size_t size)
+{
+    return calloc(count, size);
+}
+
+void rt_free(void *ptr)
+{
+    free(ptr);
+}
+
+/*--------------------------------- 库函数 -----------------------------------*/
+
+void rt_kprintf(const char *fmt, ...)
+{
+    va_list args;
+
+    va_start(args, fmt);
+    vprintf(fmt, args);
+    va_end(args);
+}
+
+int rt_snprintf(char *buf, rt_size_t size, const char *fmt, ...)
+{
+    va_list args;
+    int n;
+
+    va_start(args, fmt);
+    n = vsnprintf(buf, size, fmt, args);
+    va_end(args);
+    return n;
+}
+
+int __rt_ffs(int value)
+{
+    return __builtin_ffs(value);
+}
+
+/*---------------------------------- 设备 ------------------------------------*/
+
+rt_device_t rt_device_find(const char *name)
+{
+    rt_size_t i;
+
+    if (shim_hwtimer_find(name) != RT_NULL)
+        return &shim_hwtimer_find(name)->parent;
+
+    for (i = 0; i < sizeof(shim_buses) / sizeof(shim_buses[0]); i++)
+    {
+        if (strcmp(shim_buses[i].parent.parent.name, name) == 0)
+            return &shim_buses[i].parent;
+    }
+    return RT_NULL;
+}
+
+rt_err_t rt_device_open(rt_device_t dev, rt_uint16_t oflag)
+{
+    return RT_EOK;
+}
+
+rt_err_t rt_device_close(rt_device_t dev)
+{
+    return RT_EOK;
+}
+
+rt_size_t rt_device_write(rt_device_t dev, rt_off_t pos, const void *buffer, rt_size_t size)
+{
+    shim_hwtimer *timer = (shim_hwtimer *)dev;
+    const rt_hwtimerval_t *tv = buffer;
+
+    if (!shim_is_hwtimer(dev) || size != sizeof(rt_hwtimerval_t))
+        return 0;
+
+    timer->period_us = tv->sec * 1000000 + tv->usec;
+    timer->running = RT_TRUE;
+    return size;
+}
+
+rt_err_t rt_device_control(rt_device_t dev, int cmd, void *arg)
+{
+    shim_hwtimer *timer = (shim_hwtimer *)dev;
+
+    if (!shim_is_hwtimer(dev))
+        return -RT_ENOSYS;
+
+    if (cmd == HWTIMER_CTRL_STOP)
+        timer->running = RT_FALSE;
+    else if (cmd == HWTIMER_CTRL_MODE_SET)
+        timer->mode = *(rt_hwtimer_mode_t *)arg;
+    return RT_EOK;
+}
+
+rt_err_t rt_device_set_rx_indicate(rt_device_t dev, rt_err_t (*rx_ind)(rt_device_t dev, rt_size_t size))
+{
+    dev->rx_indicate = rx_ind;
+    return RT_EOK;
+}
+
+rt_uint32_t shim_hwtimer_fire(const char *name, rt_uint32_t max)
+{
+    shim_hwtimer *timer = shim_hwtimer_find(name);
+    rt_uint32_t count = 0;
+
+    RT_ASSERT(timer != RT_NULL);
+    while (timer->running && count < max)
+    {
+        if (timer->mode == HWTIMER_MODE_ONESHOT)
+            timer->running = RT_FALSE;
+        count++;
+        rt_interrupt_enter();
+        if (timer->parent.rx_indicate != RT_NULL)
+            timer->parent.rx_indicate(&timer->parent, sizeof(rt_hwtimerval_t));
+        rt_interrupt_leave();
+    }
+    return count;
+}
+
+rt_bool_t shim_hwtimer_running(const char *name)
+{
+    return shim_hwtimer_find(name)->running;
+}
+
+rt_int32_t shim_hwtimer_period(const char *name)
+{
+    return shim_hwtimer_find(name)->period_us;
+}
+
+/*---------------------------------- 引脚 ------------------------------------*/
+
+void rt_pin_mode(rt_base_t pin, rt_base_t mode)
+{
+}
+
+void rt_pin_write(rt_base_t pin, rt_base_t value)
+{
+    RT_ASSERT(pin >= 0 && pin < SHIM_PIN_MAX);
+    shim.pins[pin] = value ? PIN_HIGH : PIN_LOW;
+    if (shim_pin_hook != RT_NULL)
+        shim_pin_hook(pin, shim.pins[pin]);
+}
+
+int rt_pin_read(rt_base_t pin)
+{
+    RT_ASSERT(pin >= 0 && pin < SHIM_PIN_MAX);
+    return shim.pins[pin];
+}
+
+rt_base_t shim_pin_level(rt_base_t pin)
+{
+    return rt_pin_read(pin);
+}
+
+rt_err_t rt_pin_attach_irq(rt_int32_t pin, rt_uint32_t mode, void (*hdr)(void *args), void *args)
+{
+    return RT_EOK;
+}
+
+rt_err_t rt_pin_irq_enable(rt_base_t pin, rt_uint32_t enabled)
+{
+    return RT_EOK;
+}
+
+/*---------------------------------- I2C -------------------------------------*/
+
+struct rt_i2c_bus_device *rt_i2c_bus_device_find(const char *bus_name)
+{
+    return (struct rt_i2c_bus_device *)rt_device_find(bus_name);
+}
+
+void shim_i2c_attach(rt_uint16_t addr, shim_i2c_slave slave)
+{
+    int i;
+
+    for (i = 0; i < SHIM_I2C_SLAVE_MAX; i++)
+    {
+        if (shim.slaves[i].slave == RT_NULL || shim.slaves[i].addr == addr)
+        {
+            shim.slaves[i].addr = addr;
+            shim.slaves[i].slave = slave;
+            return;
+        }
+    }
+    RT_ASSERT(0);
+}
+
+/* 一次传输中的消息都发往同一个从机, 与驱动的用法一致 */
+rt_size_t rt_i2c_transfer(struct rt_i2c_bus_device *bus, struct rt_i2c_msg msgs[], rt_uint32_t num)
+{
+    int i;
+
+    RT_DEBUG_NOT_IN_INTERRUPT;
+
+    for (i = 0; i < SHIM_I2C_SLAVE_MAX; i++)
+    {
+        if (shim.slaves[i].slave != RT_NULL && shim.slaves[i].addr == msgs[0].addr)
+            return shim.slaves[i].slave(msgs, num);
+    }
+    return 0;
+}
+
+/*---------------------------------- 断言 ------------------------------------*/
+
+rt_bool_t shim_check(rt_bool_t ok, const char *expr, const char *file, int line)
+{
+    shim.checks++;
+    if (!ok)
+    {
+        shim.failures++;
+        printf("%s:%d: check failed: %s\n", file, line, expr);
+    }
+    return ok;
+}
+
+int shim_report(const char *name)
+{
+    printf("%s: %d checks, %d failed\n", name, shim.checks, shim.failures);
+    return shim.failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,41 @@
+/*******************************************************************************
+* @file     rtshim.h
+* @version  1.0
+* @brief    主机测试控制替身内核的接口: 推进时钟, 触发硬件定时器中断,
+*           观察引脚, 挂接 I2C 从机模型
+*******************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __RTSHIM_H
+#define __RTSHIM_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <rtthread.h>
+#include <rtdevice.h>
+
+/* Exported types ------------------------------------------------------------*/
+/* I2C 从机模型, 处理一次组合传输中发往该地址的全部消息, 返回完成的消息数 */
+typedef rt_size_t (*shim_i2c_slave)(struct rt_i2c_msg msgs[], rt_uint32_t num);
+
+/* Exported functions ------------------------------------------------------- */
+/* 软件定时器: 逐 tick 推进时钟, 到期的定时器在线程上下文中回调 */
+void shim_tick_advance(rt_tick_t ticks);
+
+/* 硬件定时器: 在中断上下文中回调, 直到定时器停止或达到 max 次, 返回回调次数 */
+rt_uint32_t shim_hwtimer_fire(const char *name, rt_uint32_t max);
+rt_bool_t shim_hwtimer_running(const char *name);
+rt_int32_t shim_hwtimer_period(const char *name);
+
+/* 引脚: 记录每个引脚的电平, hook 不为空时每次 rt_pin_write 都调用 */
+extern void (*shim_pin_hook)(rt_base_t pin, rt_base_t value);
+rt_base_t shim_pin_level(rt_base_t pin);
+
+/* I2C: 按 7 位地址挂接从机模型, 没有模型的地址不应答 */
+void shim_i2c_attach(rt_uint16_t addr, shim_i2c_slave slave);
+
+/* 断言: 失败时打印位置并计数, 测试结束时由 shim_report 汇总 */
+#define SHIM_CHECK(cond)    shim_check((cond), #cond, __FILE__, __LINE__)
+rt_bool_t shim_check(rt_bool_t ok, const char *expr, const char *file, int line);
+int shim_report(const char *name);
+
+#endif /* __RTSHIM_H */
@@ -0,0 +1,188 @@
+/*******************************************************************************
+* @file     rtthread.h
+* @version  1.0
+* @brief    主机测试用的 RT-Thread 替身, 只声明驱动用到的内核接口.
+*           单线程运行: 中断开关只计数, 互斥量只计嵌套, 定时器由测试推进,
+*           实现见 rtshim.c
+*******************************************************************************/
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __RTTHREAD_H__
+#define __RTTHREAD_H__
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <assert.h>
+
+/* Exported define -----------------------------------------------------------*/
+#define RT_NAME_MAX             8
+#define RT_ALIGN_SIZE           4
+#define RT_TICK_PER_SECOND      1000
+#define RT_USING_TIMER_SOFT
+
+#define RT_TRUE                 1
+#define RT_FALSE                0
+#define RT_NULL                 ((void *)0)
+
+#define RT_EOK                  0
+#define RT_ERROR                1
+#define RT_ETIMEOUT             2
+#define RT_EFULL                3
+#define RT_EEMPTY               4
+#define RT_ENOMEM               5
+#define RT_ENOSYS               6
+#define RT_EBUSY                7
+#define RT_EIO                  8
+#define RT_EINTR                9
+#define RT_EINVAL               10
+
+#define RT_WAITING_FOREVER      -1
+#define RT_WAITING_NO           0
+
+#define RT_IPC_FLAG_FIFO        0x00
+#define RT_IPC_FLAG_PRIO        0x01
+
+#define RT_TIMER_FLAG_ONE_SHOT      0x0
+#define RT_TIMER_FLAG_PERIODIC      0x2
+#define RT_TIMER_FLAG_HARD_TIMER    0x0
+#define RT_TIMER_FLAG_SOFT_TIMER    0x4
+#define RT_TIMER_CTRL_SET_TIME      0x0
+#define RT_TIMER_CTRL_GET_TIME      0x1
+
+#define ALIGN(n)                __attribute__((aligned(n)))
+#define RT_ALIGN(size, align)   (((size) + (align) - 1) & ~((align) - 1))
+#define rt_inline               static inline
+#define RT_ASSERT(x)            assert(x)
+#define RT_DEBUG_NOT_IN_INTERRUPT   assert(rt_interrupt_get_nest() == 0)
+
+#define MSH_CMD_EXPORT(cmd, desc)
+#define MSH_CMD_EXPORT_ALIAS(cmd, alias, desc)
+#define INIT_BOARD_EXPORT(fn)
+#define INIT_DEVICE_EXPORT(fn)
+#define INIT_APP_EXPORT(fn)
+
+/* Exported types ------------------------------------------------------------*/
+typedef int8_t                  rt_int8_t;
+typedef int16_t                 rt_int16_t;
+typedef int32_t                 rt_int32_t;
+typedef int64_t                 rt_int64_t;
+typedef uint8_t                 rt_uint8_t;
+typedef uint16_t                rt_uint16_t;
+typedef uint32_t                rt_uint32_t;
+typedef uint64_t                rt_uint64_t;
+typedef int                     rt_bool_t;
+typedef long                    rt_base_t;
+typedef unsigned long           rt_ubase_t;
+typedef rt_base_t               rt_err_t;
+typedef rt_uint32_t             rt_tick_t;
+typedef rt_ubase_t              rt_size_t;
+typedef rt_base_t               rt_off_t;
+
+#define RT_UINT8_MAX            0xff
+#define RT_UINT16_MAX           0xffff
+#define RT_UINT32_MAX           0xffffffff
+
+struct rt_object
+{
+    char name[RT_NAME_MAX];
+    rt_uint8_t type;
+    rt_uint8_t flag;
+};
+
+struct rt_semaphore
+{
+    struct rt_object parent;
+    rt_uint16_t value;
+};
+typedef struct rt_semaphore *rt_sem_t;
+
+struct rt_mutex
+{
+    struct rt_object parent;
+    rt_uint8_t hold;
+};
+typedef struct rt_mutex *rt_mutex_t;
+
+struct rt_timer
+{
+    struct rt_object parent;
+    void (*timeout_func)(void *parameter);
+    void *parameter;
+    rt_tick_t init_tick;
+    rt_tick_t timeout_tick;
+    rt_bool_t active;
+};
+typedef struct rt_timer *rt_timer_t;
+
+struct rt_thread
+{
+    struct rt_object parent;
+    void (*entry)(void *parameter);
+    void *parameter;
+    rt_ubase_t user_data;
+};
+typedef struct rt_thread *rt_thread_t;
+
+typedef struct rt_device *rt_device_t;
+
+/* Exported functions ------------------------------------------------------- */
+/* 中断 */
+rt_base_t rt_hw_interrupt_disable(void);
+void rt_hw_interrupt_enable(rt_base_t level);
+void rt_interrupt_enter(void);
+void rt_interrupt_leave(void);
+rt_uint8_t rt_interrupt_get_nest(void);
+void rt_enter_critical(void);
+void rt_exit_critical(void);
+
+/* 时钟与定时器 */
+rt_tick_t rt_tick_get(void);
+rt_tick_t rt_tick_from_millisecond(rt_int32_t ms);
+void rt_timer_init(rt_timer_t timer, const char *name, void (*timeout)(void *parameter),
+                   void *parameter, rt_tick_t time, rt_uint8_t flag);
+rt_err_t rt_timer_start(rt_timer_t timer);
+rt_err_t rt_timer_stop(rt_timer_t timer);
+rt_err_t rt_timer_control(rt_timer_t timer, int cmd, void *arg);
+
+/* 线程 */
+rt_err_t rt_thread_init(struct rt_thread *thread, const char *name,
+                        void (*entry)(void *parameter), void *parameter,
+                        void *stack_start, rt_uint32_t stack_size,
+                        rt_uint8_t priority, rt_uint32_t tick);
+rt_thread_t rt_thread_create(const char *name, void (*entry)(void *parameter), void *parameter,
+                             rt_uint32_t stack_size, rt_uint8_t priority, rt_uint32_t tick);
+rt_err_t rt_thread_startup(rt_thread_t thread);
+rt_thread_t rt_thread_self(void);
+rt_err_t rt_thread_mdelay(rt_int32_t ms);
+rt_err_t rt_thread_delay(rt_tick_t tick);
+
+/* 线程间同步 */
+rt_err_t rt_sem_init(rt_sem_t sem, const char *name, rt_uint32_t value, rt_uint8_t flag);
+rt_err_t rt_sem_take(rt_sem_t sem, rt_int32_t time);
+rt_err_t rt_sem_release(rt_sem_t sem);
+rt_err_t rt_mutex_init(rt_mutex_t mutex, const char *name, rt_uint8_t flag);
+rt_mutex_t rt_mutex_create(const char *name, rt_uint8_t flag);
+rt_err_t rt_mutex_delete(rt_mutex_t mutex);
+rt_err_t rt_mutex_take(rt_mutex_t mutex, rt_int32_t time);
+rt_err_t rt_mutex_release(rt_mutex_t mutex);
+
+/* 内存 */
+void *rt_malloc(rt_size_t size);
+void *rt_calloc(rt_size_t count, rt_size_t size);
+void rt_free(void *ptr);
+
+/* 库函数 */
+void rt_kprintf(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+int rt_snprintf(char *buf, rt_size_t size, const char *fmt, ...);
+#define rt_memset(s, c, n)      memset((s), (c), (n))
+#define rt_memcpy(d, s, n)      memcpy((d), (s), (n))
+#define rt_memcmp(a, b, n)      memcmp((a), (b), (n))
+#define rt_strlen(s)            strlen(s)
+#define rt_strcmp(a, b)         strcmp((a), (b))
+#define rt_strncmp(a, b, n)     strncmp((a), (b), (n))
+#define rt_strncpy(d, s, n)     strncpy((d), (s), (n))
+int __rt_ffs(int value);
+
+#endif /* __RTTHREAD_H__ */
@@ -0,0 +1,343 @@
+/*******************************************************************************
+* @file     test_ds3231_alarm.c
+* @version  1.0
+* @brief    软件闹钟的主机测试, 直接包含 ds3231_alarm.c 以访问堆和调度函数.
+*           芯片由 ds3231_model 模拟, 时间缓存和中断线程用下面的桩代替,
+*           闹钟线程不运行, 由 alarm_run 执行一轮与线程相同的处理
+*******************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include "ds3231_alarm.c"
+#include "ds3231_model.h"
+#include "rtshim.h"
+
+/* Private define ------------------------------------------------------------*/
+#define HEAP_OPS        20000
+
+/* Private variables ---------------------------------------------------------*/
+static int fired[DS3231_ALARM_MAX];
+static rt_uint8_t posted;
+
+/* 时间缓存和中断线程的桩 ----------------------------------------------------*/
+void DS3231_CacheGetTime(DS3231_Time *time)
+{
+    DS3231_GetTime(time);
+}
+
+rt_err_t DS3231_CacheGetSeconds(rt_uint32_t *seconds)
+{
+    return -RT_ERROR;
+}
+
+void DS3231_CacheResync(void)
+{
+}
+
+rt_err_t DS3231_IrqAttach(uint8_t alarm, DS3231_IrqCallback callback, void *param)
+{
+    return RT_EOK;
+}
+
+void DS3231_IrqPost(uint8_t flags)
+{
+    posted |= flags;
+}
+
+/* Private functions ---------------------------------------------------------*/
+static rt_uint32_t secs(rt_uint8_t year, rt_uint8_t month, rt_uint8_t date,
+                        rt_uint8_t hour, rt_uint8_t minute, rt_uint8_t second)
+{
+    DS3231_Time time = { .year = year, .month = month, .date = date,
+                         .hour = hour, .minute = minute, .second = second };
+
+    return DS3231_TimeToSeconds(&time);
+}
+
+static rt_uint8_t bcd(rt_uint8_t val)
+{
+    return (val >> 4) * 10 + (val & 0x0F);
+}
+
+static DS3231_AlarmConfig config_at(rt_uint8_t type, rt_uint32_t local)
+{
+    DS3231_AlarmConfig config;
+
+    rt_memset(&config, 0, sizeof(config));
+    config.type = type;
+    DS3231_SecondsToTime(local, &config.time);
+    return config;
+}
+
+/* 与闹钟线程的一轮处理相同 */
+static void alarm_run(void)
+{
+    rt_uint32_t now;
+    rt_bool_t again;
+
+    while (rt_sem_take(&ds3231_alarm.wake, RT_WAITING_NO) == RT_EOK)
+        ;
+    do
+    {
+        now = alarm_now();
+        rt_mutex_take(&ds3231_alarm.lock, RT_WAITING_FOREVER);
+        if (ds3231_alarm.resync)
+        {
+            ds3231_alarm.resync = RT_FALSE;
+            alarm_rebuild(now);
+        }
+        alarm_dispatch(now);
+        again = alarm_program(now);
+        rt_mutex_release(&ds3231_alarm.lock);
+    } while (again);
+}
+
+static void on_alarm(int id, void *param)
+{
+    fired[id]++;
+}
+
+/* 闹钟 1 寄存器中的 日期-时-分-秒, 匹配位都为 0 */
+static rt_bool_t alarm1_is(rt_uint32_t when)
+{
+    DS3231_Time time;
+
+    DS3231_SecondsToTime(when, &time);
+    return DS3231_ModelReg(0x07) == ((time.second / 10) << 4 | time.second % 10) &&
+           bcd(DS3231_ModelReg(0x08)) == time.minute &&
+           bcd(DS3231_ModelReg(0x09)) == time.hour &&
+           bcd(DS3231_ModelReg(0x0A)) == time.date;
+}
+
+/* 堆 -----------------------------------------------------------------------*/
+static rt_bool_t heap_valid(const alarm_heap *heap)
+{
+    rt_uint16_t i;
+
+    for (i = 0; i < heap->num; i++)
+    {
+        if (heap->pos[heap->node[i].slot] != i)
+            return RT_FALSE;
+        if (i > 0 && heap->node[(i - 1) / 2].when > heap->node[i].when)
+            return RT_FALSE;
+    }
+    return RT_TRUE;
+}
+
+/* 随机插入和按编号删除, 每步检查堆序和 pos, 最后按顺序弹出 */
+static void test_heap(void)
+{
+    alarm_node node[DS3231_ALARM_MAX];
+    rt_uint16_t pos[DS3231_ALARM_MAX];
+    rt_bool_t in[DS3231_ALARM_MAX] = { RT_FALSE };
+    alarm_heap heap = { node, pos, 0 };
+    rt_uint32_t seed = 7, last, i;
+    rt_uint16_t slot;
+    rt_bool_t ok = RT_TRUE;
+
+    for (i = 0; i < HEAP_OPS && ok; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        slot = (seed >> 16) % DS3231_ALARM_MAX;
+        if (in[slot])
+        {
+            heap_remove(&heap, pos[slot]);
+            in[slot] = RT_FALSE;
+        }
+        else
+        {
+            /* 时刻只取少数几个值, 覆盖相等的情况 */
+            heap_push(&heap, (seed >> 8) % 64, slot);
+            in[slot] = RT_TRUE;
+        }
+        ok = heap_valid(&heap);
+    }
+    SHIM_CHECK(ok);
+
+    for (last = 0; heap.num > 0; )
+    {
+        SHIM_CHECK(heap.node[0].when >= last);
+        last = heap.node[0].when;
+        heap_remove(&heap, 0);
+        SHIM_CHECK(heap_valid(&heap));
+    }
+}
+
+/* 下一次响铃, 不使用夏令时 -------------------------------------------------*/
+static void test_next(void)
+{
+    DS3231_AlarmConfig config;
+    rt_uint32_t when, friday = secs(26, 10, 16, 0, 0, 0);
+
+    DS3231_TzSet("UTC0");
+    SHIM_CHECK(DS3231_Weekday(26, 10, 16) == 5);
+
+    config = config_at(DS3231_ALARM_DAILY, friday + 7 * 3600 + 30 * 60);
+    SHIM_CHECK(alarm_next(&config, friday + 7 * 3600, &when) && when == friday + 27000);
+    /* 正好在响铃时刻时取下一天 */
+    SHIM_CHECK(alarm_next(&config, friday + 27000, &when) && when == friday + 86400 + 27000);
+    SHIM_CHECK(alarm_next(&config, friday + 8 * 3600, &when) && when == friday + 86400 + 27000);
+
+    /* 周五之后的工作日是周一, 周末是周六 */
+    config = config_at(DS3231_ALARM_WEEKLY, friday + 7 * 3600);
+    config.weekdays = DS3231_ALARM_WORKDAYS;
+    SHIM_CHECK(alarm_next(&config, friday + 6 * 3600, &when) && when == friday + 7 * 3600);
+    SHIM_CHECK(alarm_next(&config, friday + 8 * 3600, &when) && when == friday + 3 * 86400 + 7 * 3600);
+    config.weekdays = DS3231_ALARM_WEEKEND;
+    SHIM_CHECK(alarm_next(&config, friday + 8 * 3600, &when) && when == friday + 86400 + 7 * 3600);
+    config.weekdays = 0x40;
+    SHIM_CHECK(alarm_next(&config, friday + 8 * 3600, &when) && when == friday + 2 * 86400 + 7 * 3600);
+
+    config = config_at(DS3231_ALARM_INTERVAL, friday);
+    config.interval = 90;
+    SHIM_CHECK(alarm_next(&config, friday - 1, &when) && when == friday);
+    SHIM_CHECK(alarm_next(&config, friday, &when) && when == friday + 90);
+    SHIM_CHECK(alarm_next(&config, friday + 1000, &when) && when == friday + 1080);
+
+    config = config_at(DS3231_ALARM_ONCE, friday);
+    SHIM_CHECK(alarm_next(&config, friday - 1, &when) && when == friday);
+    SHIM_CHECK(!alarm_next(&config, friday, &when));
+}
+
+/* 夏令时切换的日子: 2026-03-29 02:00 CET 跳到 03:00 CEST,
+   2026-10-25 03:00 CEST 回到 02:00 CET */
+static void test_next_dst(void)
+{
+    static const rt_uint32_t range[][2] =
+    {
+        { 20 * 86400, 36 * 86400 },     // 03-20 ~ 04-05 (从 3 月 1 日起)
+        { 231 * 86400, 247 * 86400 },   // 10-18 ~ 11-03
+    };
+    DS3231_AlarmConfig config;
+    rt_uint32_t march = secs(26, 3, 1, 0, 0, 0), after, local, expect, when;
+    rt_bool_t ok = RT_TRUE;
+    int r;
+
+    SHIM_CHECK(DS3231_TzSet("CET-1CEST,M3.5.0,M10.5.0/3") == RT_EOK);
+
+    /* 每天 08:00 本地时间: 总是下一个本地 08:00, 换算后的 UTC 随偏移变化 */
+    config = config_at(DS3231_ALARM_DAILY, 8 * 3600);
+    for (r = 0; r < 2; r++)
+    {
+        for (after = march + range[r][0]; after < march + range[r][1] && ok; after += 1799)
+        {
+            local = DS3231_TzLocal(after);
+            expect = local - local % 86400 + 8 * 3600;
+            if (local % 86400 >= 8 * 3600)
+                expect += 86400;
+            ok = alarm_next(&config, after, &when) && when > after && DS3231_TzLocal(when) == expect;
+        }
+    }
+    SHIM_CHECK(ok);
+    SHIM_CHECK(alarm_next(&config, secs(26, 3, 28, 12, 0, 0), &when) && when == secs(26, 3, 29, 6, 0, 0));
+    SHIM_CHECK(alarm_next(&config, secs(26, 10, 24, 12, 0, 0), &when) && when == secs(26, 10, 25, 7, 0, 0));
+
+    /* 02:30 在 3 月 29 日不存在, 在切换后的 03:30 响 */
+    config = config_at(DS3231_ALARM_DAILY, 2 * 3600 + 30 * 60);
+    SHIM_CHECK(alarm_next(&config, secs(26, 3, 28, 12, 0, 0), &when) && when == secs(26, 3, 29, 1, 30, 0));
+    SHIM_CHECK(DS3231_TzLocal(when) == secs(26, 3, 29, 3, 30, 0));
+    /* 02:30 在 10 月 25 日出现两次, 只在较早的一次响 */
+    SHIM_CHECK(alarm_next(&config, secs(26, 10, 24, 12, 0, 0), &when) && when == secs(26, 10, 25, 0, 30, 0));
+    SHIM_CHECK(alarm_next(&config, when, &when) && when == secs(26, 10, 26, 1, 30, 0));
+
+    /* 每周日 08:00, 3 月 29 日是切换当天 */
+    config = config_at(DS3231_ALARM_WEEKLY, 8 * 3600);
+    config.weekdays = 0x40;
+    SHIM_CHECK(alarm_next(&config, secs(26, 3, 28, 12, 0, 0), &when) && when == secs(26, 3, 29, 6, 0, 0));
+    SHIM_CHECK(alarm_next(&config, when, &when) && when == secs(26, 4, 5, 6, 0, 0));
+    SHIM_CHECK(alarm_next(&config, secs(26, 10, 24, 12, 0, 0), &when) && when == secs(26, 10, 25, 7, 0, 0));
+
+    /* 间隔闹钟按 UTC 计时, 不受切换影响 */
+    config = config_at(DS3231_ALARM_INTERVAL, secs(26, 3, 29, 0, 0, 0));
+    config.interval = 3600;
+    SHIM_CHECK(alarm_next(&config, secs(26, 3, 29, 5, 10, 0), &when) && when == secs(26, 3, 29, 6, 0, 0));
+
+    DS3231_TzSet("UTC0");
+}
+
+/* 调度: 添加, 写入闹钟 1, 到点回调, 倒数, 删除, 校时后重建 --------------*/
+static void test_schedule(void)
+{
+    DS3231_AlarmConfig config;
+    DS3231_Time time;
+    rt_uint32_t t0 = secs(26, 10, 16, 6, 59, 50);
+    int once, daily, every, id, i;
+
+    DS3231_TzSet("UTC0");
+    DS3231_ModelSetSeconds(t0);
+    SHIM_CHECK(DS3231_AlarmInit() == RT_EOK);
+    SHIM_CHECK((DS3231_ModelReg(0x0E) & 0x01) == 0);    // 闹钟 1 中断已关闭
+
+    config = config_at(DS3231_ALARM_ONCE, t0 - 1);
+    SHIM_CHECK(DS3231_AlarmAdd(&config) == -RT_EINVAL);
+
+    config = config_at(DS3231_ALARM_DAILY, secs(0, 1, 1, 7, 0, 0));
+    config.callback = on_alarm;
+    daily = DS3231_AlarmAdd(&config);
+    config = config_at(DS3231_ALARM_INTERVAL, secs(26, 10, 16, 6, 30, 0));
+    config.interval = 3600;
+    config.callback = on_alarm;
+    every = DS3231_AlarmAdd(&config);
+    config = config_at(DS3231_ALARM_ONCE, t0 + 5);
+    config.callback = on_alarm;
+    once = DS3231_AlarmAdd(&config);
+    if (!SHIM_CHECK(daily >= 0 && every >= 0 && once >= 0))
+        return;
+
+    alarm_run();
+    SHIM_CHECK(DS3231_AlarmNext(&id) == t0 + 5 && id == once);
+    SHIM_CHECK(alarm1_is(t0 + 5));
+    SHIM_CHECK(ds3231_alarm.countdown == 5);
+
+    /* 使用时间缓存时由秒边沿倒数, 到 0 投递闹钟 1 事件 */
+    posted = 0;
+    for (i = 0; i < 4; i++)
+        DS3231_AlarmTick();
+    SHIM_CHECK(posted == 0);
+    DS3231_AlarmTick();
+    SHIM_CHECK(posted == DS3231_FLAG_A1F);
+
+    DS3231_ModelSetSeconds(t0 + 5);
+    alarm_run();
+    SHIM_CHECK(fired[once] == 1 && !ds3231_alarm.used[once]);
+    SHIM_CHECK(DS3231_AlarmNext(&id) == t0 + 10 && id == daily);
+    SHIM_CHECK(alarm1_is(t0 + 10));
+
+    /* 晚到 2 秒: 仍然回调, 记录延迟, 重复闹钟放回堆中 */
+    DS3231_ModelSetSeconds(t0 + 12);
+    alarm_run();
+    SHIM_CHECK(fired[daily] == 1 && ds3231_alarm.stats.late == 2);
+    SHIM_CHECK(DS3231_AlarmNext(&id) == secs(26, 10, 16, 7, 30, 0) && id == every);
+
+    SHIM_CHECK(DS3231_AlarmRemove(every) == RT_EOK);
+    SHIM_CHECK(DS3231_AlarmRemove(every) == -RT_EINVAL);
+    alarm_run();
+    SHIM_CHECK(DS3231_AlarmNext(&id) == secs(26, 10, 17, 7, 0, 0) && id == daily);
+    SHIM_CHECK(alarm1_is(secs(26, 10, 17, 7, 0, 0)));
+
+    /* 校时到 4 天之后, 每天的闹钟按新时间重建 */
+    DS3231_SecondsToTime(secs(26, 10, 20, 12, 0, 0), &time);
+    SHIM_CHECK(DS3231_SetTime(&time) == RT_EOK);
+    SHIM_CHECK(ds3231_alarm.resync);
+    alarm_run();
+    SHIM_CHECK(fired[daily] == 1);
+    SHIM_CHECK(DS3231_AlarmNext(&id) == secs(26, 10, 21, 7, 0, 0) && id == daily);
+
+    /* 删除最后一个闹钟后不再倒数 */
+    SHIM_CHECK(DS3231_AlarmRemove(daily) == RT_EOK);
+    alarm_run();
+    SHIM_CHECK(DS3231_AlarmNext(&id) == 0 && id == -1);
+    SHIM_CHECK(ds3231_alarm.countdown == 0 && !ds3231_alarm.armed);
+}
+
+int main(void)
+{
+    DS3231_ModelAttach();
+    DS3231_Init();
+
+    test_heap();
+    test_next();
+    test_next_dst();
+    test_schedule();
+
+    return shim_report("ds3231_alarm");
+}
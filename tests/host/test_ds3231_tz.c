@@ -0,0 +1,212 @@
+/*******************************************************************************
+* @file     test_ds3231_tz.c
+* @version  1.0
+* @brief    时区换算的主机测试, 以 glibc 的 localtime_r 为参照:
+*           15 个时区从 2000 到 2100 年每 1799 秒比较一次 DS3231_TzLocal,
+*           在每次偏移变化前后 1800 秒内逐秒比较, 检查 DS3231_TzUtc 往返,
+*           跳过和重复的一小时, 以及错误的 TZ 字符串被拒绝
+*******************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdlib.h>
+#include <time.h>
+#include "ds3231_tz.h"
+#include "ds3231_model.h"
+#include "rtshim.h"
+
+/* Private define ------------------------------------------------------------*/
+#define EPOCH_2000      946684800LL     /* 2000-01-01 00:00:00 的 Unix 时间 */
+#define SWEEP_FROM      (EPOCH_2000 + 86400)
+#define SWEEP_TO        (4102444800LL - 86400)  /* 2100-01-01 的前一天 */
+#define SWEEP_STEP      1799            /* 与整点错开, 经过一天中的每个时刻 */
+#define EDGE_WINDOW     1800
+
+/* Private variables ---------------------------------------------------------*/
+static const char *const zones[] =
+{
+    "CST-8",
+    "UTC0",
+    "CET-1CEST,M3.5.0,M10.5.0/3",
+    "EST5EDT,M3.2.0,M11.1.0",
+    "AEST-10AEDT,M10.1.0,M4.1.0/3",             // 南半球, 夏令时跨年
+    "NZST-12NZDT,M9.5.0,M4.1.0/3",
+    "<-03>3<-02>,M3.5.0/-2,M10.5.0/-1",         // 负的切换时刻
+    "IST-5:30",
+    "QST8QDT,M3.2.0,M11.1.0",
+    "WART4WARST,J1/0,J365/25",                  // 全年夏令时
+    "XXX3YYY,0/0,200/12",                       // 从 0 开始的儒略日
+    "EET-2EEST,M3.5.0/3,M10.5.0/4",
+    "<+0545>-5:45",
+    "CHAST-12:45CHADT,M9.5.0/2:45,M4.1.0/3:45",
+    "GMT0BST,M3.5.0/1,M10.5.0",
+};
+
+static const char *const bad_zones[] =
+{
+    "",
+    "AB-8",                         // 名称少于 3 个字符
+    "CST",                          // 没有偏移
+    "CST-25",                       // 偏移超出范围
+    "CET-1CEST,M13.1.0,M10.5.0",    // 月份错误
+    "CET-1CEST,M3.5.0",             // 缺少结束规则
+    "CET-1CEST,M3.5.7,M10.5.0",     // 星期错误
+    "EST5EDT,M3.2.0,M11.1.0x",      // 多余的字符
+    "<+08-8",                       // 引号没有闭合
+};
+
+/* 时间缓存和闹钟的桩 --------------------------------------------------------*/
+rt_err_t DS3231_CacheGetSeconds(rt_uint32_t *seconds)
+{
+    return -RT_ERROR;
+}
+
+void DS3231_CacheResync(void)
+{
+}
+
+void DS3231_AlarmResync(void)
+{
+}
+
+/* Private functions ---------------------------------------------------------*/
+static long glibc_offset(long long t)
+{
+    struct tm tm;
+    time_t tt = (time_t)t;
+
+    localtime_r(&tt, &tm);
+    return tm.tm_gmtoff;
+}
+
+static rt_bool_t local_ok(long long t, long offset)
+{
+    return DS3231_TzLocal((rt_uint32_t)(t - EPOCH_2000)) == (rt_uint32_t)(t + offset - EPOCH_2000);
+}
+
+/* 偏移在 (from, to] 中变化, 二分找到变化后的第一秒 */
+static long long find_edge(long long from, long long to)
+{
+    long before = glibc_offset(from);
+    long long mid;
+
+    while (to - from > 1)
+    {
+        mid = from + (to - from) / 2;
+        if (glibc_offset(mid) == before)
+            from = mid;
+        else
+            to = mid;
+    }
+    return to;
+}
+
+static void check_zone(const char *spec)
+{
+    long long t, s, edge;
+    long offset, prev = 0;
+    rt_uint32_t local;
+    int sweep_fail = 0, trip_fail = 0, edge_fail = 0, edges = 0;
+
+    setenv("TZ", spec, 1);
+    tzset();
+    if (!SHIM_CHECK(DS3231_TzSet(spec) == RT_EOK))
+        return;
+
+    for (t = SWEEP_FROM; t < SWEEP_TO; t += SWEEP_STEP)
+    {
+        offset = glibc_offset(t);
+        if (!local_ok(t, offset))
+            sweep_fail++;
+
+        /* 本地时间换算回 UTC 后应得到同一个本地时间 */
+        local = (rt_uint32_t)(t + offset - EPOCH_2000);
+        if (DS3231_TzLocal(DS3231_TzUtc(local)) != local)
+            trip_fail++;
+
+        if (t != SWEEP_FROM && offset != prev)
+        {
+            edges++;
+            edge = find_edge(t - SWEEP_STEP, t);
+            for (s = edge - EDGE_WINDOW; s < edge + EDGE_WINDOW; s++)
+            {
+                if (!local_ok(s, glibc_offset(s)))
+                    edge_fail++;
+            }
+        }
+        prev = offset;
+    }
+
+    if (sweep_fail || trip_fail || edge_fail)
+        rt_kprintf("%s: sweep %d, round trip %d, edges %d failed\n",
+                   spec, sweep_fail, trip_fail, edge_fail);
+    SHIM_CHECK(sweep_fail == 0);
+    SHIM_CHECK(trip_fail == 0);
+    SHIM_CHECK(edge_fail == 0);
+    /* 有夏令时的时区 100 年约 200 次切换, 全年夏令时的没有 */
+    SHIM_CHECK(edges == 0 || edges > 150);
+}
+
+static rt_uint32_t secs(rt_uint8_t year, rt_uint8_t month, rt_uint8_t date,
+                        rt_uint8_t hour, rt_uint8_t minute, rt_uint8_t second)
+{
+    DS3231_Time time = { .year = year, .month = month, .date = date,
+                         .hour = hour, .minute = minute, .second = second };
+
+    return DS3231_TimeToSeconds(&time);
+}
+
+/* 2026-03-08 02:00 EST 跳到 03:00 EDT, 2026-11-01 02:00 EDT 回到 01:00 EST */
+static void test_gap_overlap(void)
+{
+    SHIM_CHECK(DS3231_TzSet("EST5EDT,M3.2.0,M11.1.0") == RT_EOK);
+
+    /* 跳过的 02:30 按切换前的偏移换算, 即 03:30 EDT */
+    SHIM_CHECK(DS3231_TzUtc(secs(26, 3, 8, 2, 30, 0)) == secs(26, 3, 8, 7, 30, 0));
+    SHIM_CHECK(DS3231_TzLocal(secs(26, 3, 8, 7, 30, 0)) == secs(26, 3, 8, 3, 30, 0));
+    /* 重复的 01:30 取较早的一次 (EDT) */
+    SHIM_CHECK(DS3231_TzUtc(secs(26, 11, 1, 1, 30, 0)) == secs(26, 11, 1, 5, 30, 0));
+    SHIM_CHECK(DS3231_TzLocal(secs(26, 11, 1, 6, 30, 0)) == secs(26, 11, 1, 1, 30, 0));
+}
+
+static void test_bad(void)
+{
+    unsigned i;
+
+    SHIM_CHECK(DS3231_TzSet("CST-8") == RT_EOK);
+    for (i = 0; i < sizeof(bad_zones) / sizeof(bad_zones[0]); i++)
+    {
+        if (!SHIM_CHECK(DS3231_TzSet(bad_zones[i]) == -RT_EINVAL))
+            rt_kprintf("accepted \"%s\"\n", bad_zones[i]);
+    }
+    SHIM_CHECK(DS3231_TzSet(RT_NULL) == -RT_EINVAL);
+    /* 错误的字符串不改变原来的时区 */
+    SHIM_CHECK(rt_strcmp(DS3231_TzGet(), "CST-8") == 0);
+}
+
+/* 没有时间缓存时读取芯片的 UTC 换算 */
+static void test_local_time(void)
+{
+    DS3231_Time time;
+
+    DS3231_ModelSetSeconds(secs(26, 10, 16, 23, 30, 5));
+    SHIM_CHECK(DS3231_TzSet("CST-8") == RT_EOK);
+    DS3231_TzLocalTime(&time);
+    SHIM_CHECK(time.year == 26 && time.month == 10 && time.date == 17 && time.day == 6);
+    SHIM_CHECK(time.hour == 7 && time.minute == 30 && time.second == 5);
+}
+
+int main(void)
+{
+    unsigned i;
+
+    DS3231_ModelAttach();
+    DS3231_Init();
+
+    for (i = 0; i < sizeof(zones) / sizeof(zones[0]); i++)
+        check_zone(zones[i]);
+    test_gap_overlap();
+    test_bad();
+    test_local_time();
+
+    return shim_report("ds3231_tz");
+}
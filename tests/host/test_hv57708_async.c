@@ -0,0 +1,140 @@
+/*******************************************************************************
+* @file     test_hv57708_async.c
+* @version  1.0
+* @brief    用模拟的 timer4 中断运行 HV57708 异步移位 (HV57708_USING_ASYNC):
+*           每帧 16 拍加一次锁存, 移位期间提交的帧在锁存后接着移出,
+*           HV57708_WaitFrame 等到空闲, 异步移位期间的秒边沿推迟到空闲时锁存
+*******************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include "hv57708.h"
+#include "rtshim.h"
+
+/* Private define ------------------------------------------------------------*/
+#define FRAME_BEATS     17  // 16 拍移位, 1 拍锁存
+#define FIRE_MAX        1000
+
+/* Private functions ---------------------------------------------------------*/
+static rt_uint64_t expect_frame(const rt_uint8_t data[])
+{
+    rt_uint64_t frame = 0;
+    int t;
+
+    for (t = 0; t < HV57708_TUBE_NUM; t++)
+    {
+        if (data[t] <= 9)
+            frame |= (rt_uint64_t)1 << HV57708_CATHODE_BIT(t, data[t]);
+    }
+    return frame;
+}
+
+static rt_uint32_t latches(void)
+{
+    HV57708_SimStats stats;
+
+    HV57708_SimGetStats(&stats);
+    return stats.latches;
+}
+
+/* 提交后立即返回, 由定时器中断移出 */
+static void test_frame(void)
+{
+    rt_uint8_t data[HV57708_TUBE_NUM] = {1, 2, 3, 4, 5, 6};
+    rt_uint64_t before = HV57708_SimLatched();
+    rt_uint32_t n = latches();
+
+    HV57708_Display(data);
+    SHIM_CHECK(shim_hwtimer_running(HV57708_ASYNC_TIMER));
+    SHIM_CHECK(shim_hwtimer_period(HV57708_ASYNC_TIMER) == HV57708_ASYNC_TICK_US);
+    SHIM_CHECK(HV57708_SimLatched() == before);
+
+    SHIM_CHECK(shim_hwtimer_fire(HV57708_ASYNC_TIMER, FIRE_MAX) == FRAME_BEATS);
+    SHIM_CHECK(!shim_hwtimer_running(HV57708_ASYNC_TIMER));
+    SHIM_CHECK(HV57708_SimLatched() == expect_frame(data));
+    SHIM_CHECK(latches() - n == 1);
+}
+
+/* 移位期间提交两帧: 只保留最后一帧, 当前帧锁存后接着移出 */
+static void test_pending(void)
+{
+    rt_uint8_t a[HV57708_TUBE_NUM] = {0, 1, 0, 1, 0, 1};
+    rt_uint8_t b[HV57708_TUBE_NUM] = {7, 7, 7, 7, 7, 7};
+    rt_uint8_t c[HV57708_TUBE_NUM] = {2, 3, 5, 9, 5, 3};
+    rt_uint32_t n = latches();
+
+    HV57708_Display(a);
+    SHIM_CHECK(shim_hwtimer_fire(HV57708_ASYNC_TIMER, 5) == 5);
+    HV57708_Display(b);
+    HV57708_Display(c);
+
+    /* 余下的拍数锁存 a, 之后定时器继续运行 */
+    SHIM_CHECK(shim_hwtimer_fire(HV57708_ASYNC_TIMER, FRAME_BEATS - 5) == FRAME_BEATS - 5);
+    SHIM_CHECK(HV57708_SimLatched() == expect_frame(a));
+    SHIM_CHECK(shim_hwtimer_running(HV57708_ASYNC_TIMER));
+
+    SHIM_CHECK(shim_hwtimer_fire(HV57708_ASYNC_TIMER, FIRE_MAX) == FRAME_BEATS);
+    SHIM_CHECK(HV57708_SimLatched() == expect_frame(c));
+    SHIM_CHECK(latches() - n == 2);
+    SHIM_CHECK(!shim_hwtimer_running(HV57708_ASYNC_TIMER));
+}
+
+static void test_wait(void)
+{
+    rt_uint8_t data[HV57708_TUBE_NUM] = {8, 6, 4, 2, 0, 9};
+
+    HV57708_Display(data);
+    SHIM_CHECK(HV57708_WaitFrame(RT_WAITING_NO) == -RT_ETIMEOUT);
+    SHIM_CHECK(HV57708_WaitFrame(RT_WAITING_FOREVER) == RT_EOK);
+    SHIM_CHECK(HV57708_SimLatched() == expect_frame(data));
+    SHIM_CHECK(!shim_hwtimer_running(HV57708_ASYNC_TIMER));
+    SHIM_CHECK(HV57708_WaitFrame(RT_WAITING_NO) == RT_EOK);
+}
+
+/* 异步引擎空闲时边沿立即锁存, 忙时推迟到最后一帧锁存之后 */
+static void test_edge(void)
+{
+    rt_uint8_t f[HV57708_TUBE_NUM] = {1, 1, 5, 9, 0, 0};
+    rt_uint8_t g[HV57708_TUBE_NUM] = {4, 4, 4, 4, 4, 4};
+    rt_uint8_t h[HV57708_TUBE_NUM] = {3, 0, 0, 0, 0, 1};
+    rt_uint32_t n, last, max;
+
+    HV57708_FbRender(h);
+    SHIM_CHECK(!shim_hwtimer_running(HV57708_ASYNC_TIMER));
+    n = latches();
+    HV57708_FbEdge();
+    SHIM_CHECK(HV57708_SimLatched() == expect_frame(h));
+    SHIM_CHECK(latches() - n == 1);
+
+    HV57708_FbRender(f);
+    HV57708_Display(g);
+    n = latches();
+    HV57708_FbEdge();
+    SHIM_CHECK(latches() == n);
+    SHIM_CHECK(HV57708_SimLatched() == expect_frame(h));
+
+    /* g 锁存后在中断中补做 f: g 覆盖了预移位的内容, 需要重新移出 */
+    SHIM_CHECK(shim_hwtimer_fire(HV57708_ASYNC_TIMER, FIRE_MAX) == FRAME_BEATS);
+    SHIM_CHECK(HV57708_SimLatched() == expect_frame(f));
+    SHIM_CHECK(latches() - n == 2);
+
+    HV57708_FbGetLatency(&last, &max);
+    SHIM_CHECK(last <= max);
+
+    /* 已锁存的帧不再有待处理的边沿 */
+    n = latches();
+    HV57708_FbEdge();
+    SHIM_CHECK(latches() == n);
+}
+
+int main(void)
+{
+    HV57708_Init();
+    HV57708_TubePower(PIN_HIGH);
+
+    test_frame();
+    test_pending();
+    test_wait();
+    test_edge();
+
+    return shim_report("hv57708_async");
+}
@@ -0,0 +1,143 @@
+/*******************************************************************************
+* @file     test_hv57708_port.c
+* @version  1.0
+* @brief    比较端口寄存器移位 (HV57708_ShiftWord, BSRR/BRR) 与逐位
+*           rt_pin_write 移位 (HV57708_SendData_Pin) 在引脚上产生的序列:
+*           每个 CLK 上升沿采样 DIN4 ~ DIN1, 每个 LE 上升沿记一次锁存
+*******************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include <rtthread.h>
+#include <rtdevice.h>
+#include "rtshim.h"
+
+/* 模拟端口: 在包含驱动之前定义端口访问宏, 写入同样送到引脚监视器 */
+static void port_write(rt_base_t base, rt_uint32_t bsrr);
+static rt_uint32_t port_stray;  // 写到 DIN / CLK / LE 以外引脚的位
+
+#define HV57708_DIN_WRITE(bsrr)     port_write(HV57708_DIN_PIN_BASE, (bsrr))
+#define HV57708_CTRL_SET(mask)      port_write(HV57708_CTRL_PIN_BASE, (mask))
+#define HV57708_CTRL_RESET(mask)    port_write(HV57708_CTRL_PIN_BASE, (rt_uint32_t)(mask) << 16)
+#define HV57708_SW_WRITE(level)     rt_pin_write(HV57708_SW, level)
+#define HV57708_SW_READ()           rt_pin_read(HV57708_SW)
+
+#include "hv57708.c"
+
+/* Private define ------------------------------------------------------------*/
+#define SEQ_LATCH   0x80    // 序列中的锁存标记, 其余为移入的半字节
+#define SEQ_MAX     64
+
+/* Private variables ---------------------------------------------------------*/
+static struct
+{
+    rt_uint8_t level[64];
+    rt_uint8_t seq[SEQ_MAX];
+    rt_uint32_t num;
+} mon;
+
+/* Private functions ---------------------------------------------------------*/
+static void mon_pin(rt_base_t pin, rt_base_t value)
+{
+    rt_uint8_t old = mon.level[pin];
+
+    mon.level[pin] = (value != PIN_LOW);
+    if (old || !mon.level[pin] || mon.num >= SEQ_MAX)
+        return;
+
+    if (pin == HV57708_CLK)
+        mon.seq[mon.num++] = (mon.level[HV57708_DI4] << 3) | (mon.level[HV57708_DI3] << 2) |
+                             (mon.level[HV57708_DI2] << 1) | mon.level[HV57708_DI1];
+    else if (pin == HV57708_LE)
+        mon.seq[mon.num++] = SEQ_LATCH;
+}
+
+/* BSRR 语义: 低半字置位, 高半字复位, 同时出现时置位优先 */
+static void port_write(rt_base_t base, rt_uint32_t bsrr)
+{
+    rt_uint32_t set = bsrr & 0xFFFF;
+    rt_uint32_t reset = (bsrr >> 16) & ~set;
+    rt_uint32_t allowed = (base == HV57708_DIN_PIN_BASE) ? HV57708_DIN_MASK :
+                          (HV57708_CLK_MASK | HV57708_LE_MASK);
+    int i;
+
+    port_stray |= (set | reset) & ~allowed;
+    for (i = 0; i < 16; i++)
+    {
+        if (reset & (1 << i))
+            mon_pin(base + i, PIN_LOW);
+        else if (set & (1 << i))
+            mon_pin(base + i, PIN_HIGH);
+    }
+}
+
+static void mon_reset(void)
+{
+    rt_memset(&mon, 0, sizeof(mon));
+}
+
+/* 期望的序列: 高位在前 16 个半字节, 然后一次锁存 */
+static void expect_seq(rt_uint8_t seq[], rt_uint32_t hi, rt_uint32_t lo)
+{
+    rt_uint64_t frame = ((rt_uint64_t)hi << 32) | lo;
+    int i;
+
+    for (i = 0; i < 16; i++)
+        seq[i] = (frame >> (60 - 4 * i)) & 0xF;
+    seq[16] = SEQ_LATCH;
+}
+
+static void check_frame(rt_uint32_t hi, rt_uint32_t lo)
+{
+    rt_uint8_t expect[17], port[17];
+
+    expect_seq(expect, hi, lo);
+
+    mon_reset();
+    HV57708_ShiftWord(hi);
+    HV57708_ShiftWord(lo);
+    HV57708_OutputData();
+    SHIM_CHECK(mon.num == 17);
+    SHIM_CHECK(rt_memcmp(mon.seq, expect, sizeof(expect)) == 0);
+    SHIM_CHECK(mon.level[HV57708_CLK] == 0 && mon.level[HV57708_LE] == 0);
+    rt_memcpy(port, mon.seq, sizeof(port));
+
+    mon_reset();
+    HV57708_SendData_Pin(hi, lo);
+    HV57708_OutputData();
+    SHIM_CHECK(mon.num == 17);
+    SHIM_CHECK(rt_memcmp(mon.seq, port, sizeof(port)) == 0);
+}
+
+int main(void)
+{
+    static const rt_uint32_t fixed[][2] =
+    {
+        {0x00000000, 0x00000000},
+        {0xFFFFFFFF, 0xFFFFFFFF},
+        {0x01234567, 0x89ABCDEF},
+        {0x80000000, 0x00000001},
+        {0xA5A5A5A5, 0x5A5A5A5A},
+    };
+    rt_uint32_t seed = 1, hi, lo;
+    unsigned i;
+
+    shim_pin_hook = mon_pin;
+
+    for (i = 0; i < sizeof(fixed) / sizeof(fixed[0]); i++)
+        check_frame(fixed[i][0], fixed[i][1]);
+
+    for (i = 0; i < 200; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        hi = seed;
+        seed = seed * 1103515245 + 12345;
+        lo = seed;
+        check_frame(hi, lo);
+    }
+
+    for (i = 0; i < 16; i++)
+        SHIM_CHECK((nibble_bsrr[i] & 0xFFFF & ~HV57708_DIN_MASK) == 0);
+    SHIM_CHECK(port_stray == 0);
+
+    return shim_report("hv57708_port");
+}
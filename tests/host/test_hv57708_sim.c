@@ -0,0 +1,174 @@
+/*******************************************************************************
+* @file     test_hv57708_sim.c
+* @version  1.0
+* @brief    在软件模型上运行 HV57708 驱动 (HV57708_USING_SIM, 同步移位):
+*           检查锁存的 64 位与接线宏一致, POL 反相输出, 每帧的寄存器写入,
+*           引脚翻转和 CLK 边沿数, 相同帧不再移位, 临时画面结束后恢复
+*******************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include "hv57708.h"
+#include "rtshim.h"
+
+/* Private define ------------------------------------------------------------*/
+/* 每帧 16 拍, 每拍写一次 DIN 端口, 两次控制端口; 锁存写三次控制端口 */
+#define FRAME_STORES    (16 * 3 + 3)
+#define FRAME_CLK_EDGES 16
+
+/* Private functions ---------------------------------------------------------*/
+
+/* 按接线宏计算期望点亮的输出, 不经过驱动的编码表 */
+static rt_uint64_t expect_frame(const rt_uint8_t data[])
+{
+    rt_uint64_t frame = 0;
+    int t;
+
+    for (t = 0; t < HV57708_TUBE_NUM; t++)
+    {
+        if (data[t] <= 9)
+            frame |= (rt_uint64_t)1 << HV57708_CATHODE_BIT(t, data[t]);
+    }
+    return frame;
+}
+
+/* 移出 frame 时 DIN 引脚的翻转次数, 从当前引脚电平开始, 高位在前 */
+static rt_uint32_t expect_din_toggles(rt_uint64_t frame)
+{
+    static const rt_base_t din[4] = { HV57708_DI1, HV57708_DI2, HV57708_DI3, HV57708_DI4 };
+    rt_base_t level[4];
+    rt_uint32_t toggles = 0, nibble;
+    int beat, d;
+
+    for (d = 0; d < 4; d++)
+        level[d] = HV57708_SimRead(din[d]);
+
+    for (beat = 0; beat < 16; beat++)
+    {
+        nibble = (rt_uint32_t)(frame >> (60 - 4 * beat)) & 0xF;
+        for (d = 0; d < 4; d++)
+        {
+            /* 数据位 3 送往 DIN4, 位 0 送往 DIN1 */
+            rt_base_t bit = (nibble >> d) & 1;
+            if (bit != level[d])
+            {
+                toggles++;
+                level[d] = bit;
+            }
+        }
+    }
+    return toggles;
+}
+
+static void test_latch(void)
+{
+    static const rt_uint8_t fixed[][HV57708_TUBE_NUM] =
+    {
+        {1, 2, 3, 4, 5, 6},
+        {9, 0, 9, 0, 9, 0},
+        {0xFF, 3, 0xFF, 7, 0xFF, 0xFF},
+    };
+    rt_uint8_t data[HV57708_TUBE_NUM];
+    HV57708_SimStats before, after;
+    rt_uint64_t expect;
+    rt_uint32_t din, le;
+    int i, t, num = 10 + sizeof(fixed) / sizeof(fixed[0]);
+
+    for (i = 0; i < num; i++)
+    {
+        for (t = 0; t < HV57708_TUBE_NUM; t++)
+            data[t] = (i < 10) ? i : fixed[i - 10][t];
+        expect = expect_frame(data);
+        din = expect_din_toggles(expect);
+        /* 初始化后 LE 保持为高, 第一次锁存先拉低, 多一次翻转 */
+        le = (HV57708_SimRead(HV57708_LE) == PIN_HIGH) ? 3 : 2;
+
+        HV57708_SimGetStats(&before);
+        HV57708_Display(data);
+        HV57708_SimGetStats(&after);
+
+        SHIM_CHECK(HV57708_SimLatched() == expect);
+        SHIM_CHECK(HV57708_SimOutputs() == ~expect);    // POL 为低, 输出反相
+        SHIM_CHECK(after.stores - before.stores == FRAME_STORES);
+        SHIM_CHECK(after.clk_edges - before.clk_edges == FRAME_CLK_EDGES);
+        SHIM_CHECK(after.latches - before.latches == 1);
+        /* CLK 每拍两次, 加上 LE, 其余都是数据引脚 */
+        SHIM_CHECK(after.toggles - before.toggles == FRAME_CLK_EDGES * 2 + le + din);
+    }
+}
+
+static void test_skip(void)
+{
+    rt_uint8_t data[HV57708_TUBE_NUM] = {2, 0, 2, 6, 1, 0};
+    HV57708_SimStats before, after;
+    HV57708_Stats stats;
+
+    HV57708_Display(data);
+    HV57708_ResetStats();
+    HV57708_SimGetStats(&before);
+    HV57708_Display(data);
+    HV57708_Display(data);
+    HV57708_SimGetStats(&after);
+    HV57708_GetStats(&stats);
+
+    SHIM_CHECK(after.stores == before.stores);
+    SHIM_CHECK(after.toggles == before.toggles);
+    SHIM_CHECK(stats.submitted == 2 && stats.skipped == 2 && stats.shifted == 0);
+}
+
+static void test_raw_and_overlay(void)
+{
+    rt_uint8_t data[HV57708_TUBE_NUM] = {1, 9, 8, 4, 0, 7};
+    rt_uint64_t spare = HV57708_SPARE_BIT(0) | HV57708_SPARE_BIT(3);
+
+    HV57708_DisplayRaw(spare);
+    SHIM_CHECK(HV57708_SimLatched() == spare);
+
+    HV57708_OverlayBegin();
+    HV57708_OverlayFrame(0x5A5A5A5A5A5A5A5AULL);
+    SHIM_CHECK(HV57708_SimLatched() == 0x5A5A5A5A5A5A5A5AULL);
+    HV57708_Display(data);                          // 只记录内容
+    SHIM_CHECK(HV57708_SimLatched() == 0x5A5A5A5A5A5A5A5AULL);
+    HV57708_OverlayEnd();
+    SHIM_CHECK(HV57708_SimLatched() == expect_frame(data));
+}
+
+/* 锁存脉冲必须在第 16 个 CLK 上升沿之后 */
+static void test_trace(void)
+{
+    rt_uint8_t data[HV57708_TUBE_NUM] = {3, 1, 4, 1, 5, 9};
+    HV57708_SimEvent ev[HV57708_SIM_TRACE_NUM];
+    rt_uint32_t n, i, clk = 0, last_clk = 0, le_rise = 0;
+
+    HV57708_Display(data);
+    n = HV57708_SimTrace(ev, 40);   // 一帧: 32 个 CLK 边沿, 2 个 LE 边沿
+    for (i = 0; i < n; i++)
+    {
+        if (ev[i].pin == 4 && ev[i].level)  // SIM_CLK
+        {
+            clk++;
+            last_clk = ev[i].time;
+        }
+        if (ev[i].pin == 5 && ev[i].level)  // SIM_LE
+            le_rise = ev[i].time;
+    }
+    SHIM_CHECK(clk >= FRAME_CLK_EDGES);
+    SHIM_CHECK(le_rise > last_clk);
+}
+
+int main(void)
+{
+    HV57708_Init();
+    SHIM_CHECK(HV57708_SimLatched() == 0);
+    SHIM_CHECK(HV57708_SimRead(HV57708_POL) == PIN_LOW);
+
+    HV57708_TubePower(PIN_HIGH);
+    SHIM_CHECK(HV57708_TubePowerStatus() == PIN_HIGH);
+
+    test_latch();
+    test_skip();
+    test_raw_and_overlay();
+    test_trace();
+    HV57708_SimBench();
+
+    return shim_report("hv57708_sim");
+}